@@ -2,12 +2,20 @@
 #include <memory>
 
 #include "../engine/graphics/keyboard_movement_controller.hpp"
+#include "../engine/graphics/asset_streamer.hpp"
 #include "../engine/graphics/buffer.hpp"
 #include "../engine/graphics/camera.hpp"
+#include "../engine/graphics/hot_reloader.hpp"
 #include "../engine/graphics/imgui_layer.hpp"
+#include "../engine/graphics/pipeline_library.hpp"
+#include "../engine/graphics/texture_cache.hpp"
+#include "../engine/graphics/upload_manager.hpp"
 #include "../engine/systems/point_light_system.hpp"
 #include "../engine/systems/simple_render_system.hpp"
+#include "../engine/core/derived_data_cache.hpp"
 #include "../engine/core/discord.hpp"
+#include "../engine/core/timing_report.hpp"
+#include "../engine/core/virtual_file_system.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -23,13 +31,20 @@
 #include <stdexcept>
 #include <filesystem>
 #include <iostream>
+#include <mutex>
+#include <optional>
 
 using namespace VGED::Engine::System;
 
 namespace VGED {
 	namespace Editor {
 		EditorApp::EditorApp() {
-			globalPool = DescriptorPool::Builder(lveDevice).setMaxSets(1000).addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT).addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000).build();
+			// assets packed by tools/asset_packer take priority over loose files
+			if (std::filesystem::exists(ASSET_PACK_PATH)) {
+				VirtualFileSystem::shared().mount(ASSET_PACK_PATH);
+			}
+			// global sets hold a uniform buffer and a sampler, material sets three samplers, new pools are added as models load
+			globalAllocator = std::make_unique<DescriptorAllocator>(lveDevice, std::vector<DescriptorAllocator::PoolSizeRatio>{ { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0.5f }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3.0f } });
 			loadGameObjects();
 			Engine::RPC::init();
 		}
@@ -49,7 +64,7 @@ namespace VGED {
 
 			ImguiLayer lveImgui{lveWindow, lveDevice, lveRenderer.getSwapChainRenderPass(), static_cast<uint32_t>(lveRenderer.getImageCount())};
 
-			texture = std::make_unique<Texture>(lveDevice, "textures/meme.png");
+			texture = lveDevice.texture_cache().get("textures/meme.png");
 
 			VkDescriptorImageInfo imageInfo = {};
 			imageInfo.sampler = texture->getSampler();
@@ -66,27 +81,43 @@ namespace VGED {
 				.build();
 
 			std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
+			DescriptorBatch globalDescriptorBatch{ lveDevice };
 			for (int i = 0; i < globalDescriptorSets.size(); i++) {
-				auto bufferInfo = uboBuffers[i]->descriptor_info();
-				DescriptorWriter(*globalSetLayout, *globalPool).writeBuffer(0, &bufferInfo).writeImage(1, &imageInfo).build(globalDescriptorSets[i]);
+				if (!globalAllocator->allocateDescriptor(globalSetLayout->getDescriptorSetLayout(), globalDescriptorSets[i])) {
+					throw std::runtime_error("failed to allocate global descriptor set!");
+				}
+				globalDescriptorBatch.writeSet(*globalSetLayout, globalDescriptorSets[i]).writeBuffer(0, uboBuffers[i]->descriptor_info()).writeImage(1, imageInfo);
 			}
+			globalDescriptorBatch.flush();
 
-			SimpleRenderSystem simpleRenderSystem{ lveDevice, lveRenderer.getSwapChainRenderPass(), { globalSetLayout->getDescriptorSetLayout(), materialSetLayout->getDescriptorSetLayout() } };
+			// bindless: materials are looked up by the shaders, draws bind no descriptor sets of their own
+			SimpleRenderSystem simpleRenderSystem{ lveDevice, lveRenderer.getSwapChainRenderPass(), { globalSetLayout->getDescriptorSetLayout(), materialSetLayout->getDescriptorSetLayout() }, true };
 			PointLightSystem pointLightSystem{ lveDevice, lveRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
 
-			std::shared_ptr<Model> lveModel = std::make_shared<Model>(lveDevice, "models/Sponza/Sponza.gltf", *materialSetLayout, *globalPool);
+			// prefer the mesh cooked by tools/model_cooker, it skips the gltf parse entirely
+			std::string sponzaPath = VirtualFileSystem::shared().exists("models/Sponza/Sponza.vmesh") ? "models/Sponza/Sponza.vmesh" : "models/Sponza/Sponza.gltf";
+			// stream it in the background, the scene renders with an empty placeholder until it is ready
+			AssetStreamer assetStreamer{ lveDevice };
 			auto floor = GameObject::createGameObject();
-			floor.model = lveModel;
+			auto sponza = assetStreamer.load_model(sponzaPath, *materialSetLayout, *globalAllocator, ModelInfo{ .vertex_format = VertexFormat::COMPACT, .bindless = true },
+												   [this, id = floor.getId()](const std::shared_ptr<Model> &model) { gameObjects.at(id).model = model; });
+			floor.model = sponza->get();
 			floor.transform.translation = { 0.f, .5f, 0.f };
 			floor.transform.scale = { .01f, .01f, .01f };
 			floor.transform.rotation = { 0.0f, 0.0f, 3.14159265f };
 			gameObjects.emplace(floor.getId(), std::move(floor));
+			// edited models, textures and shaders are picked up without a restart, packed assets can't change
+			std::optional<HotReloader> hotReloader;
+			if (VirtualFileSystem::shared().mount_count() == 0) {
+				hotReloader.emplace(lveDevice, assetStreamer);
+			}
 			Camera camera{};
 
 			auto viewerObject = GameObject::createGameObject();
 			viewerObject.transform.translation.z = -2.5f;
 			KeyboardMovementController cameraController{};
 
+			bool startupReported = false;
 			auto currentTime = std::chrono::high_resolution_clock::now();
 			while (!lveWindow.should_close()) {
 				glfwPollEvents();
@@ -102,10 +133,25 @@ namespace VGED {
 				camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
 				Engine::RPC::update();
+				if (hotReloader) {
+					hotReloader->update();
+				}
+				assetStreamer.update();
+				// everything loaded at startup went through the derived data cache by now
+				if (!startupReported && assetStreamer.pending_count() == 0) {
+					TimingReport::shared().add("startup", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+					TimingReport::shared().report();
+					DerivedDataCache::shared().report();
+					// lets the next asset_packer run lay the pack out in the order startup reads it
+					VirtualFileSystem::shared().write_access_order(LOAD_ORDER_PATH);
+					startupReported = true;
+				}
+				// submit this frame's main thread uploads ahead of the frame that uses them
+				const UploadStats &uploadStats = lveDevice.upload_manager().end_frame();
 
 				if (auto commandBuffer = lveRenderer.beginFrame()) {
 					int frameIndex = lveRenderer.getFrameIndex();
-					FrameInfo frameInfo{ frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex], gameObjects };
+					FrameInfo frameInfo{ frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex], gameObjects, lveRenderer.getFrameDescriptorAllocator() };
 
 					// update
 					GlobalUbo ubo{};
@@ -123,6 +169,25 @@ namespace VGED {
 					// order here matters
 					simpleRenderSystem.renderGameObjects(frameInfo);
 					pointLightSystem.render(frameInfo);
+					const PipelineStats &pipelineStats = lveDevice.pipeline_library().end_frame();
+
+					auto &cullingStats = simpleRenderSystem.getCullingStats();
+					ImGui::Begin("Culling");
+					ImGui::Text("objects: %u / %u", cullingStats.visibleObjects, cullingStats.objects);
+					ImGui::Text("meshlets: %u / %u", cullingStats.visibleMeshlets, cullingStats.meshlets);
+					ImGui::Text("draws: %u", cullingStats.draws);
+					ImGui::End();
+
+					ImGui::Begin("Pipelines");
+					ImGui::Text("unique: %u pipelines, %u layouts for %u requests", pipelineStats.unique_pipelines, pipelineStats.unique_layouts, pipelineStats.requests);
+					ImGui::Text("set layouts: %u", pipelineStats.unique_set_layouts);
+					ImGui::Text("binds: %u (%u switches)", pipelineStats.binds, pipelineStats.bind_switches);
+					ImGui::End();
+
+					ImGui::Begin("Uploads");
+					ImGui::Text("last frame: %.1f KiB in %u submits (%u copies)", uploadStats.bytes / 1024.0, uploadStats.submits, uploadStats.copies);
+					ImGui::Text("total: %.1f MiB in %u submits", lveDevice.upload_manager().total_stats().bytes / (1024.0 * 1024.0), lveDevice.upload_manager().total_stats().submits);
+					ImGui::End();
 					lveImgui.runExample();
 					lveImgui.render(commandBuffer);
 
@@ -131,6 +196,7 @@ namespace VGED {
 				}
 			}
 
+			std::lock_guard<std::mutex> lock{ lveDevice.queue_mutex() };
 			vkDeviceWaitIdle(lveDevice.device());
 		}
 
@@ -8,6 +8,7 @@
 #include "../engine/graphics/texture.hpp"
 
 // std
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -19,6 +20,8 @@ namespace VGED {
         public:
             static constexpr int WIDTH = 1280;
             static constexpr int HEIGHT = 720;
+            static constexpr const char *ASSET_PACK_PATH = "assets.vpak";
+            static constexpr const char *LOAD_ORDER_PATH = "cache/load_order.txt";
 
             EditorApp();
             ~EditorApp();
@@ -31,12 +34,14 @@ namespace VGED {
         private:
             void loadGameObjects();
 
+            // initialized first so the startup time includes creating the window and device
+            std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
             VGED::Engine::Window lveWindow{ WIDTH, HEIGHT, "VGED Engine" };
             Device lveDevice{ lveWindow };
             Renderer lveRenderer{ lveWindow, lveDevice };
 
-            std::unique_ptr<DescriptorPool> globalPool{};
-            std::unique_ptr<Texture> texture{};
+            std::unique_ptr<DescriptorAllocator> globalAllocator{};
+            std::shared_ptr<Texture> texture{};
             GameObject::Map gameObjects;
         };
     }
@@ -0,0 +1,117 @@
+#include "derived_data_cache.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            DerivedDataCache::DerivedDataCache(const std::filesystem::path &_root) : root{ _root } {}
+
+            DerivedDataCache &DerivedDataCache::shared() {
+                static DerivedDataCache cache{};
+                return cache;
+            }
+
+            std::filesystem::path DerivedDataCache::entry_path(std::string_view kind, u64 key) const {
+                char name[32];
+                std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+                return root / std::string{ kind } / name;
+            }
+
+            void DerivedDataCache::count(std::string_view kind, bool hit, u64 bytes_read, u64 bytes_written) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto &entry = counters[std::string{ kind }];
+                if (hit) {
+                    entry.hits++;
+                } else if (bytes_written == 0) {
+                    entry.misses++;
+                }
+                entry.bytes_read += bytes_read;
+                entry.bytes_written += bytes_written;
+            }
+
+            std::optional<std::filesystem::path> DerivedDataCache::find(std::string_view kind, u64 key) {
+                if (!enabled) {
+                    return std::nullopt;
+                }
+                std::filesystem::path path = entry_path(kind, key);
+                std::error_code error;
+                u64 size = std::filesystem::file_size(path, error);
+                if (error || size == 0) {
+                    count(kind, false, 0, 0);
+                    return std::nullopt;
+                }
+                count(kind, true, size, 0);
+                return path;
+            }
+
+            bool DerivedDataCache::read(std::string_view kind, u64 key, std::vector<u8> &data) {
+                auto path = find(kind, key);
+                if (!path) {
+                    return false;
+                }
+                try {
+                    MappedFile file{ path->string() };
+                    data.assign(file.data(), file.data() + file.size());
+                    return true;
+                } catch (const std::exception &e) {
+                    std::cerr << "derived data cache: failed to read " << path->string() << ": " << e.what() << std::endl;
+                    return false;
+                }
+            }
+
+            void DerivedDataCache::write(std::string_view kind, u64 key, const void *data, usize size) {
+                if (!enabled) {
+                    return;
+                }
+                std::filesystem::path path = entry_path(kind, key);
+                std::error_code error;
+                std::filesystem::create_directories(path.parent_path(), error);
+
+                // readers only ever see complete entries
+                std::filesystem::path temp = path;
+                temp += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + "_" + std::to_string(temp_counter++);
+                {
+                    std::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+                    out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+                    if (!out) {
+                        std::cerr << "derived data cache: failed to write " << temp.string() << std::endl;
+                        out.close();
+                        std::filesystem::remove(temp, error);
+                        return;
+                    }
+                }
+                std::filesystem::rename(temp, path, error);
+                if (error) {
+                    std::cerr << "derived data cache: failed to store " << path.string() << ": " << error.message() << std::endl;
+                    std::filesystem::remove(temp, error);
+                    return;
+                }
+                count(kind, false, 0, size);
+            }
+
+            std::map<std::string, DerivedDataStats> DerivedDataCache::stats() {
+                std::lock_guard<std::mutex> lock{ mutex };
+                return counters;
+            }
+
+            void DerivedDataCache::report() {
+                auto all = stats();
+                if (all.empty()) {
+                    std::cout << "derived data cache (" << root.string() << "): unused" << std::endl;
+                    return;
+                }
+                for (auto &[kind, entry] : all) {
+                    std::cout << "derived data cache " << kind << ": " << entry.hits << " hits, " << entry.misses << " misses, " << entry.bytes_read / 1024 << " KiB read, "
+                              << entry.bytes_written / 1024 << " KiB written" << std::endl;
+                }
+            }
+        }
+    }
+}
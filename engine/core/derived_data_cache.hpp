@@ -0,0 +1,71 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            struct DerivedDataStats {
+                u32 hits = 0;
+                u32 misses = 0;
+                u64 bytes_read = 0;
+                u64 bytes_written = 0;
+            };
+
+            /**
+             * @brief Content addressed store for the results of expensive imports. Entries live at
+             * <root>/<kind>/<key>.bin where key hashes the source bytes, the importer version and its settings,
+             * so a changed source or importer simply misses and stale entries are never read.
+             * Safe to use from any thread, entries are written to a temporary file and renamed into place.
+             */
+            class DerivedDataCache {
+            public:
+                static constexpr const char *DEFAULT_ROOT = "cache/derived";
+
+                DerivedDataCache(const std::filesystem::path &_root = DEFAULT_ROOT);
+
+                DerivedDataCache(const DerivedDataCache &) = delete;
+                DerivedDataCache &operator=(const DerivedDataCache &) = delete;
+
+                /**
+                 * @brief Path of the entry when it exists, counted as a hit or miss for kind.
+                 */
+                std::optional<std::filesystem::path> find(std::string_view kind, u64 key);
+                bool read(std::string_view kind, u64 key, std::vector<u8> &data);
+                // failures only cost the next launch a miss, they are logged and otherwise ignored
+                void write(std::string_view kind, u64 key, const void *data, usize size);
+
+                void set_enabled(bool _enabled) { enabled = _enabled; }
+                bool is_enabled() const { return enabled; }
+
+                std::map<std::string, DerivedDataStats> stats();
+                // one line per kind of hits and misses so far, printed to stdout
+                void report();
+
+                /**
+                 * @brief Engine wide cache rooted at DEFAULT_ROOT in the working directory
+                 */
+                static DerivedDataCache &shared();
+
+            private:
+                std::filesystem::path entry_path(std::string_view kind, u64 key) const;
+                void count(std::string_view kind, bool hit, u64 bytes_read, u64 bytes_written);
+
+                std::filesystem::path root;
+                std::atomic<bool> enabled = true;
+                std::atomic<u64> temp_counter = 0;
+                std::mutex mutex = {};
+                std::map<std::string, DerivedDataStats> counters = {};
+            };
+        }
+    }
+}
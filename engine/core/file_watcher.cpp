@@ -0,0 +1,131 @@
+#include "file_watcher.hpp"
+#include "pack_file.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+#ifdef __linux__
+            static constexpr u32 WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+            FileWatcher::FileWatcher(const std::vector<std::string> &directories, std::chrono::milliseconds _settle_time) : settle_time{ _settle_time } {
+                fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if (fd == -1) {
+                    std::cerr << "failed to initialize inotify, file changes won't be picked up" << std::endl;
+                    return;
+                }
+                for (auto &directory : directories) {
+                    watch_recursive(directory);
+                }
+            }
+
+            FileWatcher::~FileWatcher() {
+                if (fd != -1) {
+                    close(fd);
+                }
+            }
+
+            void FileWatcher::watch_recursive(const std::string &directory) {
+                std::error_code error;
+                if (!std::filesystem::is_directory(directory, error)) {
+                    return;
+                }
+
+                std::vector<std::string> directories{ PackFile::normalize(directory) };
+                for (auto it = std::filesystem::recursive_directory_iterator(directory, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+                    if (it->is_directory(error)) {
+                        directories.push_back(PackFile::normalize(it->path().string()));
+                    }
+                }
+
+                for (auto &watched : directories) {
+                    int wd = inotify_add_watch(fd, watched.c_str(), WATCH_MASK);
+                    if (wd == -1) {
+                        std::cerr << "failed to watch " << watched << std::endl;
+                        continue;
+                    }
+                    watched_directories[wd] = watched;
+                }
+            }
+
+            void FileWatcher::read_events() {
+                alignas(inotify_event) char buffer[4096];
+                for (;;) {
+                    ssize_t length = read(fd, buffer, sizeof(buffer));
+                    if (length <= 0) {
+                        // EAGAIN, everything queued so far has been read
+                        return;
+                    }
+
+                    auto now = std::chrono::steady_clock::now();
+                    for (ssize_t offset = 0; offset < length;) {
+                        const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+                        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                        auto directory = watched_directories.find(event->wd);
+                        if (directory == watched_directories.end() || event->len == 0) {
+                            continue;
+                        }
+                        std::string path = directory->second + "/" + event->name;
+                        if (event->mask & IN_ISDIR) {
+                            // directories created or moved in later are watched too, files copied along are picked up below
+                            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                                watch_recursive(path);
+                            }
+                            continue;
+                        }
+                        // a created file is reported once it is closed after writing
+                        if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                            changed[path] = now;
+                        }
+                    }
+                }
+            }
+
+            std::vector<std::string> FileWatcher::poll() {
+                std::vector<std::string> settled;
+                if (fd == -1) {
+                    return settled;
+                }
+                read_events();
+
+                auto now = std::chrono::steady_clock::now();
+                for (auto it = changed.begin(); it != changed.end();) {
+                    if (now - it->second >= settle_time) {
+                        // temporary files that were renamed over the real one are gone by now
+                        std::error_code error;
+                        if (std::filesystem::is_regular_file(it->first, error)) {
+                            settled.push_back(it->first);
+                        }
+                        it = changed.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                std::sort(settled.begin(), settled.end());
+                return settled;
+            }
+#else
+            FileWatcher::FileWatcher(const std::vector<std::string> &, std::chrono::milliseconds _settle_time) : settle_time{ _settle_time } {
+                std::cerr << "file watching is only implemented on linux, file changes won't be picked up" << std::endl;
+            }
+
+            FileWatcher::~FileWatcher() {}
+
+            void FileWatcher::watch_recursive(const std::string &) {}
+
+            void FileWatcher::read_events() {}
+
+            std::vector<std::string> FileWatcher::poll() { return {}; }
+#endif
+        }
+    }
+}
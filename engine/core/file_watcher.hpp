@@ -0,0 +1,46 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            /**
+             * @brief Reports files written under a set of directories, subdirectories included. Uses inotify on linux,
+             * elsewhere nothing is ever reported. Editors tend to save in several writes or through a rename, so a
+             * path is only reported once it has been left alone for settle_time.
+             *
+             */
+            class FileWatcher {
+            public:
+                FileWatcher(const std::vector<std::string> &directories, std::chrono::milliseconds _settle_time = std::chrono::milliseconds{ 100 });
+                ~FileWatcher();
+
+                FileWatcher(const FileWatcher &) = delete;
+                FileWatcher &operator=(const FileWatcher &) = delete;
+
+                /**
+                 * @brief Never blocks, cheap enough to call every frame. Paths are normalized like the VirtualFileSystem's
+                 * and relative when the watched directory was given relative.
+                 */
+                std::vector<std::string> poll();
+
+                bool is_active() const { return fd != -1; }
+
+            private:
+                void watch_recursive(const std::string &directory);
+                void read_events();
+
+                int fd = -1;
+                std::unordered_map<int, std::string> watched_directories = {};
+                std::unordered_map<std::string, std::chrono::steady_clock::time_point> changed = {};
+                std::chrono::milliseconds settle_time;
+            };
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <string_view>
+#include <type_traits>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            /**
+             * @brief XXH64 of size bytes, fast enough to hash whole source files on every load.
+             */
+            u64 xxh64(const void *data, usize size, u64 seed = 0);
+
+            /**
+             * @brief Chains xxh64 over several inputs, each one seeds the next. Used to build content keys
+             * from source bytes plus importer versions and settings.
+             */
+            class HashBuilder {
+            public:
+                HashBuilder &add(const void *data, usize size) {
+                    value = xxh64(data, size, value);
+                    // the length keeps ("ab", "c") and ("a", "bc") apart
+                    value = xxh64(&size, sizeof(size), value);
+                    return *this;
+                }
+                HashBuilder &add(std::string_view text) { return add(text.data(), text.size()); }
+
+                template <typename T>
+                    requires std::is_trivially_copyable_v<T>
+                HashBuilder &add_value(const T &data) { return add(&data, sizeof(T)); }
+
+                u64 get() const { return value; }
+
+            private:
+                u64 value = 0;
+            };
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#include "lz4.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            static constexpr usize MIN_MATCH = 4;
+            // the format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+            static constexpr usize LAST_LITERALS = 5;
+            static constexpr usize MATCH_FIND_LIMIT = 12;
+            static constexpr usize MAX_OFFSET = 65535;
+            static constexpr u32 HASH_BITS = 16;
+            static constexpr u32 NO_POSITION = ~0u;
+
+            static inline u32 read32(const u8 *p) {
+                u32 v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+
+            static inline u32 hash32(u32 sequence) { return (sequence * 2654435761u) >> (32 - HASH_BITS); }
+
+            // 15 in the token nibble, then runs of 255 and a final byte
+            static inline bool write_length(u8 *&op, const u8 *end, usize length) {
+                while (length >= 255) {
+                    if (op >= end) {
+                        return false;
+                    }
+                    *op++ = 255;
+                    length -= 255;
+                }
+                if (op >= end) {
+                    return false;
+                }
+                *op++ = static_cast<u8>(length);
+                return true;
+            }
+
+            static bool write_sequence(u8 *&op, const u8 *end, const u8 *literals, usize literal_count, usize offset, usize match_length) {
+                if (op >= end) {
+                    return false;
+                }
+                u8 *token = op++;
+                *token = static_cast<u8>((literal_count >= 15 ? 15 : literal_count) << 4);
+                if (literal_count >= 15 && !write_length(op, end, literal_count - 15)) {
+                    return false;
+                }
+                if (static_cast<usize>(end - op) < literal_count) {
+                    return false;
+                }
+                std::memcpy(op, literals, literal_count);
+                op += literal_count;
+
+                // the last sequence carries literals only
+                if (match_length == 0) {
+                    return true;
+                }
+                if (end - op < 2) {
+                    return false;
+                }
+                *op++ = static_cast<u8>(offset & 0xff);
+                *op++ = static_cast<u8>(offset >> 8);
+                usize extra = match_length - MIN_MATCH;
+                *token |= static_cast<u8>(extra >= 15 ? 15 : extra);
+                return extra < 15 || write_length(op, end, extra - 15);
+            }
+
+            usize lz4_compress(const u8 *src, usize size, u8 *dst, usize capacity) {
+                u8 *op = dst;
+                const u8 *end = dst + capacity;
+                usize anchor = 0;
+
+                if (size > MATCH_FIND_LIMIT) {
+                    std::vector<u32> table(usize{ 1 } << HASH_BITS, NO_POSITION);
+                    usize match_limit = size - LAST_LITERALS;
+                    usize ip = 0;
+                    while (ip + MATCH_FIND_LIMIT < size) {
+                        u32 sequence = read32(src + ip);
+                        u32 &slot = table[hash32(sequence)];
+                        usize candidate = slot;
+                        slot = static_cast<u32>(ip);
+                        if (candidate == NO_POSITION || ip - candidate > MAX_OFFSET || read32(src + candidate) != sequence) {
+                            ip++;
+                            continue;
+                        }
+
+                        usize length = MIN_MATCH;
+                        while (ip + length < match_limit && src[candidate + length] == src[ip + length]) {
+                            length++;
+                        }
+                        if (!write_sequence(op, end, src + anchor, ip - anchor, ip - candidate, length)) {
+                            return 0;
+                        }
+                        ip += length;
+                        anchor = ip;
+                        // keep the position just before the jump findable for the next match
+                        if (ip >= 2 && ip + MATCH_FIND_LIMIT < size) {
+                            table[hash32(read32(src + ip - 2))] = static_cast<u32>(ip - 2);
+                        }
+                    }
+                }
+
+                if (!write_sequence(op, end, src + anchor, size - anchor, 0, 0)) {
+                    return 0;
+                }
+                return static_cast<usize>(op - dst);
+            }
+
+            bool lz4_decompress(const u8 *src, usize src_size, u8 *dst, usize size) {
+                const u8 *ip = src;
+                const u8 *ip_end = src + src_size;
+                u8 *op = dst;
+                u8 *op_end = dst + size;
+
+                auto read_length = [&](usize &length) {
+                    u8 byte;
+                    do {
+                        if (ip >= ip_end) {
+                            return false;
+                        }
+                        byte = *ip++;
+                        length += byte;
+                    } while (byte == 255);
+                    return true;
+                };
+
+                while (ip < ip_end) {
+                    u8 token = *ip++;
+                    usize literal_count = token >> 4;
+                    if (literal_count == 15 && !read_length(literal_count)) {
+                        return false;
+                    }
+                    if (static_cast<usize>(ip_end - ip) < literal_count || static_cast<usize>(op_end - op) < literal_count) {
+                        return false;
+                    }
+                    std::memcpy(op, ip, literal_count);
+                    ip += literal_count;
+                    op += literal_count;
+
+                    if (ip == ip_end) {
+                        break;
+                    }
+                    if (ip_end - ip < 2) {
+                        return false;
+                    }
+                    usize offset = ip[0] | (static_cast<usize>(ip[1]) << 8);
+                    ip += 2;
+                    if (offset == 0 || offset > static_cast<usize>(op - dst)) {
+                        return false;
+                    }
+
+                    usize length = token & 15;
+                    if (length == 15 && !read_length(length)) {
+                        return false;
+                    }
+                    length += MIN_MATCH;
+                    if (static_cast<usize>(op_end - op) < length) {
+                        return false;
+                    }
+
+                    const u8 *match = op - offset;
+                    if (offset >= length) {
+                        std::memcpy(op, match, length);
+                        op += length;
+                    } else {
+                        // overlapping copies repeat the pattern, byte by byte
+                        for (usize i = 0; i < length; i++) {
+                            *op++ = match[i];
+                        }
+                    }
+                }
+                return op == op_end;
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "types.hpp"
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            /**
+             * @brief Worst case size of lz4_compress output for size input bytes
+             */
+            constexpr usize lz4_compress_bound(usize size) { return size + size / 255 + 16; }
+
+            /**
+             * @brief Compress into the LZ4 block format, readable by any LZ4 implementation.
+             * @return compressed size, 0 when it doesn't fit into capacity
+             */
+            usize lz4_compress(const u8 *src, usize size, u8 *dst, usize capacity);
+
+            /**
+             * @brief Decompress an LZ4 block that expands to exactly size bytes. Malformed input is rejected
+             * instead of reading or writing out of bounds.
+             */
+            bool lz4_decompress(const u8 *src, usize src_size, u8 *dst, usize size);
+        }
+    }
+}
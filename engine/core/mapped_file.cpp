@@ -0,0 +1,98 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+#ifdef _WIN32
+            MappedFile::MappedFile(const std::string &path) {
+                std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+                if (!in) {
+                    throw std::runtime_error("failed to open file: " + path);
+                }
+                fallback.resize(static_cast<usize>(in.tellg()));
+                in.seekg(0, std::ios::beg);
+                in.read(reinterpret_cast<char *>(fallback.data()), fallback.size());
+                mapped = fallback.data();
+                mapped_size = fallback.size();
+            }
+
+            void MappedFile::close() {
+                fallback.clear();
+                mapped = nullptr;
+                mapped_size = 0;
+            }
+
+            MappedFile::MappedFile(MappedFile &&other) noexcept : mapped{ std::exchange(other.mapped, nullptr) }, mapped_size{ std::exchange(other.mapped_size, 0) }, fallback{ std::move(other.fallback) } {}
+
+            MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+                if (this != &other) {
+                    close();
+                    mapped = std::exchange(other.mapped, nullptr);
+                    mapped_size = std::exchange(other.mapped_size, 0);
+                    fallback = std::move(other.fallback);
+                }
+                return *this;
+            }
+#else
+            MappedFile::MappedFile(const std::string &path) {
+                int fd = open(path.c_str(), O_RDONLY);
+                if (fd == -1) {
+                    throw std::runtime_error("failed to open file: " + path);
+                }
+
+                struct stat file_stat = {};
+                if (fstat(fd, &file_stat) == -1) {
+                    ::close(fd);
+                    throw std::runtime_error("failed to stat file: " + path);
+                }
+
+                mapped_size = static_cast<usize>(file_stat.st_size);
+                if (mapped_size > 0) {
+                    void *address = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (address == MAP_FAILED) {
+                        ::close(fd);
+                        throw std::runtime_error("failed to map file: " + path);
+                    }
+                    mapped = static_cast<const u8 *>(address);
+                }
+
+                // the mapping keeps its own reference to the file
+                ::close(fd);
+            }
+
+            void MappedFile::close() {
+                if (mapped != nullptr) {
+                    munmap(const_cast<u8 *>(mapped), mapped_size);
+                }
+                mapped = nullptr;
+                mapped_size = 0;
+            }
+
+            MappedFile::MappedFile(MappedFile &&other) noexcept : mapped{ std::exchange(other.mapped, nullptr) }, mapped_size{ std::exchange(other.mapped_size, 0) } {}
+
+            MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+                if (this != &other) {
+                    close();
+                    mapped = std::exchange(other.mapped, nullptr);
+                    mapped_size = std::exchange(other.mapped_size, 0);
+                }
+                return *this;
+            }
+#endif
+
+            MappedFile::~MappedFile() { close(); }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <string>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            /**
+             * @brief Read-only view of a whole file. Uses mmap where available, so pages are only
+             * faulted in when touched and no copy into a user buffer is made.
+             *
+             */
+            class MappedFile {
+            public:
+                MappedFile() = default;
+                MappedFile(const std::string &path);
+                ~MappedFile();
+
+                MappedFile(const MappedFile &) = delete;
+                MappedFile &operator=(const MappedFile &) = delete;
+                MappedFile(MappedFile &&other) noexcept;
+                MappedFile &operator=(MappedFile &&other) noexcept;
+
+                const u8 *data() const { return mapped; }
+                usize size() const { return mapped_size; }
+                bool is_open() const { return mapped != nullptr; }
+
+            private:
+                void close();
+
+                const u8 *mapped = nullptr;
+                usize mapped_size = 0;
+#ifdef _WIN32
+                std::vector<u8> fallback = {};
+#endif
+            };
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#include "pack_file.hpp"
+#include "lz4.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            static_assert(std::is_trivially_copyable_v<PackEntry>, "pack entries are copied as raw bytes");
+
+            static constexpr u64 ENTRY_ALIGNMENT = 16;
+
+            static u64 align_entry(u64 offset) { return (offset + ENTRY_ALIGNMENT - 1) & ~(ENTRY_ALIGNMENT - 1); }
+
+            PackFile::PackFile(const std::string &path) : pack_path{ path }, file{ path } {
+                if (file.size() < sizeof(PackHeader)) {
+                    throw std::runtime_error("pack file is truncated: " + path);
+                }
+                PackHeader h{};
+                std::memcpy(&h, file.data(), sizeof(h));
+                if (h.magic != PackHeader::MAGIC || h.version != PackHeader::VERSION) {
+                    throw std::runtime_error("pack file has an unsupported format, repack it: " + path);
+                }
+
+                auto in_bounds = [&](u64 offset, u64 size) { return offset <= file.size() && size <= file.size() - offset; };
+                if (!in_bounds(h.table_offset, u64(h.entry_count) * sizeof(PackEntry)) || !in_bounds(h.strings_offset, h.strings_size)) {
+                    throw std::runtime_error("pack file is truncated: " + path);
+                }
+
+                entries.resize(h.entry_count);
+                std::memcpy(entries.data(), file.data() + h.table_offset, entries.size() * sizeof(PackEntry));
+                const char *strings = reinterpret_cast<const char *>(file.data() + h.strings_offset);
+                lookup.reserve(entries.size());
+                for (u32 i = 0; i < entries.size(); i++) {
+                    const PackEntry &entry = entries[i];
+                    // stored entries are read and mapped with size, it has to be the stored_size that was bounds checked
+                    bool size_mismatch = !(entry.flags & PackEntry::COMPRESSED) && entry.size != entry.stored_size;
+                    if (!in_bounds(entry.offset, entry.stored_size) || size_mismatch || u64(entry.path_offset) + entry.path_length > h.strings_size) {
+                        throw std::runtime_error("pack file entry table is corrupt: " + path);
+                    }
+                    lookup.emplace(std::string_view{ strings + entry.path_offset, entry.path_length }, i);
+                }
+            }
+
+            const PackEntry *PackFile::find(std::string_view path) const {
+                auto it = lookup.find(path);
+                return it != lookup.end() ? &entries[it->second] : nullptr;
+            }
+
+            bool PackFile::read(const PackEntry &entry, std::vector<u8> &data) const {
+                data.resize(entry.size);
+                if (!(entry.flags & PackEntry::COMPRESSED)) {
+                    std::memcpy(data.data(), stored_data(entry), entry.size);
+                    return true;
+                }
+                return lz4_decompress(stored_data(entry), entry.stored_size, data.data(), data.size());
+            }
+
+            std::string PackFile::normalize(std::string_view path) {
+                std::string normal = std::filesystem::path{ path }.lexically_normal().generic_string();
+                while (normal.rfind("./", 0) == 0) {
+                    normal.erase(0, 2);
+                }
+                return normal;
+            }
+
+            void PackFile::write(const std::vector<PackInput> &inputs, const std::string &path, bool compress) {
+                std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("failed to open file for writing: " + path);
+                }
+
+                PackHeader h{};
+                h.entry_count = static_cast<u32>(inputs.size());
+                std::vector<PackEntry> entries(inputs.size());
+                std::string strings;
+
+                // entries are streamed out one by one, the header is patched at the end
+                u64 offset = align_entry(sizeof(PackHeader));
+                out.seekp(static_cast<std::streamoff>(offset));
+                std::vector<u8> compressed;
+                for (usize i = 0; i < inputs.size(); i++) {
+                    const PackInput &input = inputs[i];
+                    std::string normal = normalize(input.path);
+                    PackEntry &entry = entries[i];
+                    entry.path_offset = static_cast<u32>(strings.size());
+                    entry.path_length = static_cast<u32>(normal.size());
+                    strings += normal;
+                    entry.offset = offset;
+                    entry.size = input.data.size();
+
+                    const u8 *stored = input.data.data();
+                    entry.stored_size = input.data.size();
+                    if (compress && !input.data.empty()) {
+                        compressed.resize(lz4_compress_bound(input.data.size()));
+                        usize compressed_size = lz4_compress(input.data.data(), input.data.size(), compressed.data(), compressed.size());
+                        if (compressed_size > 0 && compressed_size < input.data.size() - input.data.size() / 8) {
+                            stored = compressed.data();
+                            entry.stored_size = compressed_size;
+                            entry.flags |= PackEntry::COMPRESSED;
+                        }
+                    }
+
+                    out.write(reinterpret_cast<const char *>(stored), static_cast<std::streamsize>(entry.stored_size));
+                    u64 next = align_entry(offset + entry.stored_size);
+                    for (u64 pad = offset + entry.stored_size; pad < next; pad++) {
+                        out.put(0);
+                    }
+                    offset = next;
+                }
+
+                h.table_offset = offset;
+                out.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackEntry)));
+                h.strings_offset = h.table_offset + entries.size() * sizeof(PackEntry);
+                h.strings_size = strings.size();
+                out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+                out.seekp(0);
+                out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+                if (!out) {
+                    throw std::runtime_error("failed to write pack file: " + path);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "types.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            /**
+             * @brief On-disk layout of an asset archive (.vpak), written by the asset_packer tool.
+             *
+             * [header][entry data, 16 byte aligned, in load order][entry table][path strings]
+             * Entries are LZ4 blocks or stored as is when compression doesn't pay off (jpg, png, ...),
+             * stored entries are read straight from the mapping without a copy.
+             */
+            struct PackHeader {
+                static constexpr u32 MAGIC = 0x4b415056; // "VPAK"
+                static constexpr u32 VERSION = 1;
+
+                u32 magic = MAGIC;
+                u32 version = VERSION;
+                u32 entry_count = 0;
+                u32 reserved = 0;
+                u64 table_offset = 0;
+                u64 strings_offset = 0;
+                u64 strings_size = 0;
+            };
+
+            struct PackEntry {
+                static constexpr u32 COMPRESSED = 1; // lz4 block
+
+                u64 offset = 0;
+                u64 stored_size = 0;
+                u64 size = 0;
+                u32 path_offset = 0; // into the path strings
+                u32 path_length = 0;
+                u32 flags = 0;
+                u32 reserved = 0;
+            };
+
+            struct PackInput {
+                std::string path;            // as it will be looked up, relative to the working directory
+                std::vector<u8> data = {};
+            };
+
+            /**
+             * @brief Memory mapped .vpak. Lookups take normalized relative paths, see PackFile::normalize.
+             *
+             */
+            class PackFile {
+            public:
+                static constexpr const char *EXTENSION = ".vpak";
+
+                PackFile(const std::string &path);
+
+                PackFile(const PackFile &) = delete;
+                PackFile &operator=(const PackFile &) = delete;
+
+                const PackEntry *find(std::string_view path) const;
+                // pointer into the mapping, only the raw bytes for compressed entries
+                const u8 *stored_data(const PackEntry &entry) const { return file.data() + entry.offset; }
+                // decompresses when needed
+                bool read(const PackEntry &entry, std::vector<u8> &data) const;
+
+                const std::string &path() const { return pack_path; }
+                usize entry_count() const { return entries.size(); }
+
+                // forward slashes, no "." or ".." segments, no leading "./"
+                static std::string normalize(std::string_view path);
+
+                /**
+                 * @brief Write inputs in the given order, which should be the order they are loaded in so a cold
+                 * start reads the archive front to back. Entries are compressed unless that saves less than an eighth.
+                 */
+                static void write(const std::vector<PackInput> &inputs, const std::string &path, bool compress = true);
+
+            private:
+                std::string pack_path;
+                MappedFile file;
+                std::vector<PackEntry> entries = {};
+                std::unordered_map<std::string_view, u32> lookup = {};
+            };
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#include "thread_pool.hpp"
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            static thread_local bool is_pool_worker = false;
+
+            ThreadPool::ThreadPool(usize thread_count) {
+                thread_count = std::max<usize>(thread_count, 1);
+                workers.reserve(thread_count);
+                for (usize i = 0; i < thread_count; ++i) {
+                    workers.emplace_back([this]() { worker_loop(); });
+                }
+            }
+
+            ThreadPool::~ThreadPool() {
+                {
+                    std::lock_guard<std::mutex> lock{ mutex };
+                    stopping = true;
+                }
+                condition.notify_all();
+                for (auto &worker : workers) {
+                    worker.join();
+                }
+            }
+
+            void ThreadPool::worker_loop() {
+                is_pool_worker = true;
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock{ mutex };
+                        condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                        if (stopping && tasks.empty()) {
+                            return;
+                        }
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                    }
+                    task();
+                }
+            }
+
+            bool ThreadPool::is_worker_thread() { return is_pool_worker; }
+
+            usize ThreadPool::default_thread_count() {
+                usize count = std::thread::hardware_concurrency();
+                return count > 0 ? count : 4;
+            }
+
+            ThreadPool &ThreadPool::shared() {
+                static ThreadPool pool{};
+                return pool;
+            }
+        }
+    }
+}
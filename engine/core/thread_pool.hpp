@@ -0,0 +1,106 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            /**
+             * @brief Fixed size pool of worker threads executing submitted tasks in FIFO order
+             *
+             */
+            class ThreadPool {
+            public:
+                ThreadPool(usize thread_count = default_thread_count());
+                ~ThreadPool();
+
+                ThreadPool(const ThreadPool &) = delete;
+                ThreadPool &operator=(const ThreadPool &) = delete;
+                ThreadPool(ThreadPool &&) = delete;
+                ThreadPool &operator=(ThreadPool &&) = delete;
+
+                /**
+                 * @brief Queue a task on the pool
+                 *
+                 * @param task callable without arguments
+                 * @return std::future holding the result (or exception) of the task
+                 */
+                template <typename F>
+                auto submit(F &&task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+                    using R = std::invoke_result_t<std::decay_t<F>>;
+                    auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+                    std::future<R> future = packaged->get_future();
+                    {
+                        std::lock_guard<std::mutex> lock{ mutex };
+                        tasks.emplace([packaged]() { (*packaged)(); });
+                    }
+                    condition.notify_one();
+                    return future;
+                }
+
+                /**
+                 * @brief Run body(i) for every i in [0, count) across the pool and wait for completion.
+                 * Runs inline when called from one of the pool's own workers to avoid deadlocking it.
+                 */
+                template <typename F>
+                void parallel_for(usize count, F &&body) {
+                    if (count == 0) {
+                        return;
+                    }
+                    if (is_worker_thread() || workers.size() <= 1 || count == 1) {
+                        for (usize i = 0; i < count; ++i) {
+                            body(i);
+                        }
+                        return;
+                    }
+
+                    usize chunk_count = std::min(count, workers.size() * 4);
+                    usize chunk_size = (count + chunk_count - 1) / chunk_count;
+                    std::vector<std::future<void>> chunks;
+                    chunks.reserve(chunk_count);
+                    for (usize begin = 0; begin < count; begin += chunk_size) {
+                        usize end = std::min(count, begin + chunk_size);
+                        chunks.push_back(submit([&body, begin, end]() {
+                            for (usize i = begin; i < end; ++i) {
+                                body(i);
+                            }
+                        }));
+                    }
+                    for (auto &chunk : chunks) {
+                        chunk.get();
+                    }
+                }
+
+                usize thread_count() const { return workers.size(); }
+
+                static usize default_thread_count();
+
+                /**
+                 * @brief Engine wide pool sized to the hardware concurrency
+                 */
+                static ThreadPool &shared();
+
+            private:
+                void worker_loop();
+                static bool is_worker_thread();
+
+                std::vector<std::thread> workers = {};
+                std::queue<std::function<void()>> tasks = {};
+                std::mutex mutex = {};
+                std::condition_variable condition = {};
+                bool stopping = false;
+            };
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#include "timing_report.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            void TimingReport::add(std::string_view category, f64 milliseconds, u32 count) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto it = timings.find(category);
+                if (it == timings.end()) {
+                    it = timings.emplace(std::string{ category }, TimingEntry{}).first;
+                }
+                it->second.count += count;
+                it->second.milliseconds += milliseconds;
+            }
+
+            std::map<std::string, TimingEntry> TimingReport::entries() {
+                std::lock_guard<std::mutex> lock{ mutex };
+                return { timings.begin(), timings.end() };
+            }
+
+            void TimingReport::report() {
+                for (auto &[category, entry] : entries()) {
+                    std::cout << std::left << std::setw(24) << category << std::right << std::fixed << std::setprecision(2) << std::setw(10) << entry.milliseconds << " ms (" << entry.count << ")"
+                              << std::defaultfloat << std::endl;
+                }
+            }
+
+            TimingReport &TimingReport::shared() {
+                static TimingReport report{};
+                return report;
+            }
+        }
+    }
+}
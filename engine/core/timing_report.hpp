@@ -0,0 +1,58 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            struct TimingEntry {
+                u32 count = 0;
+                f64 milliseconds = 0.0;
+            };
+
+            /**
+             * @brief Accumulates wall time per category, e.g. how long startup spent compiling shaders.
+             * Safe to use from any thread, times measured on several threads at once add up.
+             */
+            class TimingReport {
+            public:
+                class Scope {
+                public:
+                    Scope(TimingReport &_report, std::string_view _category) : report{ _report }, category{ _category }, start{ std::chrono::steady_clock::now() } {}
+                    ~Scope() { report.add(category, std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count()); }
+
+                    Scope(const Scope &) = delete;
+                    Scope &operator=(const Scope &) = delete;
+
+                private:
+                    TimingReport &report;
+                    std::string category;
+                    std::chrono::steady_clock::time_point start;
+                };
+
+                void add(std::string_view category, f64 milliseconds, u32 count = 1);
+                // adds the time until the returned scope ends to category
+                Scope measure(std::string_view category) { return Scope{ *this, category }; }
+
+                std::map<std::string, TimingEntry> entries();
+                // one line per category, printed to stdout
+                void report();
+
+                /**
+                 * @brief Engine wide report, filled by the engine's own loaders
+                 */
+                static TimingReport &shared();
+
+            private:
+                std::mutex mutex = {};
+                std::map<std::string, TimingEntry, std::less<>> timings = {};
+            };
+        }
+    }
+}
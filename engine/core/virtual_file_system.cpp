@@ -0,0 +1,133 @@
+#include "virtual_file_system.hpp"
+#include "lz4.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            FileView FileView::map(const std::string &path) {
+                FileView view{};
+                view.mapped = MappedFile{ path };
+                view.view_data = view.mapped.data();
+                view.view_size = view.mapped.size();
+                return view;
+            }
+
+            FileView FileView::adopt(std::vector<u8> bytes) {
+                FileView view{};
+                view.decompressed = std::move(bytes);
+                view.view_data = view.decompressed.data();
+                view.view_size = view.decompressed.size();
+                return view;
+            }
+
+            void VirtualFileSystem::mount(const std::string &pack_path) {
+                auto pack = std::make_shared<const PackFile>(pack_path);
+                std::cout << "Mounted " << pack_path << " (" << pack->entry_count() << " files)" << std::endl;
+                std::unique_lock lock{ mutex };
+                packs.push_back(std::move(pack));
+            }
+
+            void VirtualFileSystem::unmount_all() {
+                std::unique_lock lock{ mutex };
+                packs.clear();
+            }
+
+            usize VirtualFileSystem::mount_count() {
+                std::shared_lock lock{ mutex };
+                return packs.size();
+            }
+
+            const PackEntry *VirtualFileSystem::find(const std::string &normal, std::shared_ptr<const PackFile> &pack) {
+                std::shared_lock lock{ mutex };
+                for (auto it = packs.rbegin(); it != packs.rend(); ++it) {
+                    if (const PackEntry *entry = (*it)->find(normal)) {
+                        pack = *it;
+                        return entry;
+                    }
+                }
+                return nullptr;
+            }
+
+            bool VirtualFileSystem::exists(const std::string &path) {
+                std::shared_ptr<const PackFile> pack;
+                if (find(PackFile::normalize(path), pack)) {
+                    return true;
+                }
+                std::error_code error;
+                return std::filesystem::is_regular_file(path, error);
+            }
+
+            FileView VirtualFileSystem::open(const std::string &path) {
+                std::string normal = PackFile::normalize(path);
+                record_access(normal);
+
+                std::shared_ptr<const PackFile> pack;
+                const PackEntry *entry = find(normal, pack);
+                if (!entry) {
+                    return FileView::map(path);
+                }
+
+                FileView view{};
+                view.from_pack = true;
+                view.view_size = entry->size;
+                if (entry->flags & PackEntry::COMPRESSED) {
+                    if (!pack->read(*entry, view.decompressed)) {
+                        throw std::runtime_error("failed to decompress " + normal + " from " + pack->path());
+                    }
+                    view.view_data = view.decompressed.data();
+                } else {
+                    view.view_data = pack->stored_data(*entry);
+                    view.pack = std::move(pack);
+                }
+                return view;
+            }
+
+            bool VirtualFileSystem::read(const std::string &path, std::vector<u8> &data) {
+                if (!exists(path)) {
+                    return false;
+                }
+                FileView view = open(path);
+                data.assign(view.data(), view.data() + view.size());
+                return true;
+            }
+
+            void VirtualFileSystem::record_access(const std::string &normal) {
+                std::lock_guard<std::mutex> lock{ access_mutex };
+                if (accessed.insert(normal).second) {
+                    accessed_order.push_back(normal);
+                }
+            }
+
+            std::vector<std::string> VirtualFileSystem::access_order() {
+                std::lock_guard<std::mutex> lock{ access_mutex };
+                return accessed_order;
+            }
+
+            void VirtualFileSystem::write_access_order(const std::string &path) {
+                std::error_code error;
+                std::filesystem::path parent = std::filesystem::path{ path }.parent_path();
+                if (!parent.empty()) {
+                    std::filesystem::create_directories(parent, error);
+                }
+                std::ofstream out(path, std::ios::out | std::ios::trunc);
+                if (!out) {
+                    std::cerr << "failed to write load order to " << path << std::endl;
+                    return;
+                }
+                for (auto &file : access_order()) {
+                    out << file << '\n';
+                }
+            }
+
+            VirtualFileSystem &VirtualFileSystem::shared() {
+                static VirtualFileSystem file_system{};
+                return file_system;
+            }
+        }
+    }
+}
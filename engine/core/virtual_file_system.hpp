@@ -0,0 +1,93 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "pack_file.hpp"
+#include "types.hpp"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Core {
+            /**
+             * @brief Read-only bytes of a file, either a view into a mounted pack, its decompressed
+             * contents or a loose file mapped from disk. Valid for as long as the view lives.
+             *
+             */
+            class FileView {
+            public:
+                FileView() = default;
+
+                const u8 *data() const { return view_data; }
+                usize size() const { return view_size; }
+                bool is_open() const { return view_data != nullptr || from_pack; }
+                std::string_view string() const { return { reinterpret_cast<const char *>(view_data), view_size }; }
+
+                static FileView map(const std::string &path);
+                // owns bytes built in memory, for readers that take a FileView
+                static FileView adopt(std::vector<u8> bytes);
+
+            private:
+                friend class VirtualFileSystem;
+
+                std::shared_ptr<const PackFile> pack = {}; // keeps the mapping alive for stored entries
+                MappedFile mapped = {};
+                std::vector<u8> decompressed = {};
+                const u8 *view_data = nullptr;
+                usize view_size = 0;
+                bool from_pack = false;
+            };
+
+            /**
+             * @brief Resolves asset paths against mounted .vpak archives before falling back to loose files
+             * relative to the working directory, so shipping a pack needs no changes to the asset paths used in code.
+             * Safe to use from any thread.
+             */
+            class VirtualFileSystem {
+            public:
+                VirtualFileSystem() = default;
+
+                VirtualFileSystem(const VirtualFileSystem &) = delete;
+                VirtualFileSystem &operator=(const VirtualFileSystem &) = delete;
+
+                // packs mounted later take priority over earlier ones
+                void mount(const std::string &pack_path);
+                void unmount_all();
+                usize mount_count();
+
+                bool exists(const std::string &path);
+                // throws when the file is neither in a pack nor on disk
+                FileView open(const std::string &path);
+                bool read(const std::string &path, std::vector<u8> &data);
+
+                /**
+                 * @brief Every path opened so far in the order it was first opened, feed it to the asset_packer
+                 * so the next pack is laid out in load order.
+                 */
+                std::vector<std::string> access_order();
+                void write_access_order(const std::string &path);
+
+                /**
+                 * @brief Engine wide file system, nothing mounted until mount is called
+                 */
+                static VirtualFileSystem &shared();
+
+            private:
+                const PackEntry *find(const std::string &normal, std::shared_ptr<const PackFile> &pack);
+                void record_access(const std::string &normal);
+
+                std::shared_mutex mutex = {};
+                std::vector<std::shared_ptr<const PackFile>> packs = {};
+                std::mutex access_mutex = {};
+                std::unordered_set<std::string> accessed = {};
+                std::vector<std::string> accessed_order = {};
+            };
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#include "asset_streamer.hpp"
+
+#include "device.hpp"
+#include "swap_chain.hpp"
+#include "texture_cache.hpp"
+#include "../core/pack_file.hpp"
+
+// std
+#include <chrono>
+#include <iostream>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            AssetStreamer::AssetStreamer(Device &_device, usize thread_count) : device{ _device }, workers{ thread_count } {
+                empty_model = std::make_shared<Model>(device);
+                white_texture = device.texture_cache().get("textures/white.png");
+            }
+
+            AssetStreamer::~AssetStreamer() {
+                for (auto &load : pending) {
+                    load.done.wait();
+                }
+            }
+
+            template <typename T>
+            void AssetStreamer::track(const std::string &filepath, std::future<void> done, const std::shared_ptr<StreamedAsset<T>> &handle, const std::shared_ptr<std::shared_ptr<T>> &result,
+                                      std::function<void(const std::shared_ptr<T> &)> on_ready) {
+                pending.push_back({ filepath, std::move(done),
+                                    [this, handle, result, on_ready = std::move(on_ready)]() {
+                                        retire(std::move(handle->resource));
+                                        handle->resource = std::move(*result);
+                                        handle->ready = true;
+                                        if (on_ready) {
+                                            on_ready(handle->resource);
+                                        }
+                                    },
+                                    [handle]() { handle->failed = true; } });
+            }
+
+            AssetStreamer::ModelHandle AssetStreamer::load_model(const std::string &filepath, DescriptorSetLayout &set_layout, DescriptorAllocator &allocator, const ModelInfo &info,
+                                                                  std::function<void(const std::shared_ptr<Model> &)> on_ready) {
+                auto handle = std::make_shared<StreamedAsset<Model>>();
+                handle->resource = empty_model;
+
+                auto result = std::make_shared<std::shared_ptr<Model>>();
+                auto done = workers.submit([this, result, filepath, &set_layout, &allocator, info]() {
+                    *result = std::make_shared<Model>(device, filepath, set_layout, allocator, info);
+                });
+
+                track(filepath, std::move(done), handle, result, std::move(on_ready));
+                models.push_back({ handle, filepath, &set_layout, &allocator, info });
+                return handle;
+            }
+
+            AssetStreamer::TextureHandle AssetStreamer::load_texture(const std::string &filepath, const TextureInfo &info, std::function<void(const std::shared_ptr<Texture> &)> on_ready) {
+                auto handle = std::make_shared<StreamedAsset<Texture>>();
+                handle->resource = white_texture;
+
+                auto result = std::make_shared<std::shared_ptr<Texture>>();
+                auto done = workers.submit([this, result, filepath, info]() { *result = device.texture_cache().get(filepath, info); });
+
+                textures.push_back({ handle, filepath, info, on_ready });
+                track(filepath, std::move(done), handle, result, std::move(on_ready));
+                return handle;
+            }
+
+            usize AssetStreamer::reload(const std::string &path) {
+                std::string normal = PackFile::normalize(path);
+                usize started = 0;
+
+                // whatever is loaded next from path has to come from the file, not from the cache
+                device.texture_cache().invalidate(path);
+
+                std::erase_if(models, [](const StreamedModel &model) { return model.handle.expired(); });
+                for (auto &model : models) {
+                    auto handle = model.handle.lock();
+                    // a model still streaming in picks the change up by itself
+                    if (!handle->ready || !handle->resource->dependsOn(normal)) {
+                        continue;
+                    }
+                    auto fresh = std::make_shared<std::shared_ptr<Model>>();
+                    auto done = workers.submit([this, fresh, filepath = model.filepath, set_layout = model.set_layout, allocator = model.allocator, info = model.info]() {
+                        *fresh = std::make_shared<Model>(device, filepath, *set_layout, *allocator, info);
+                    });
+                    pending.push_back({ model.filepath, std::move(done),
+                                        [this, handle, fresh]() {
+                                            handle->resource->swap(**fresh);
+                                            // now holds the replaced buffers and descriptor sets
+                                            retire(std::move(*fresh));
+                                        },
+                                        []() {} });
+                    started++;
+                }
+
+                std::erase_if(textures, [](const StreamedTexture &texture) { return texture.handle.expired(); });
+                for (auto &texture : textures) {
+                    auto handle = texture.handle.lock();
+                    if (!handle->ready || PackFile::normalize(texture.filepath) != normal) {
+                        continue;
+                    }
+                    auto result = std::make_shared<std::shared_ptr<Texture>>();
+                    auto done = workers.submit([this, result, filepath = texture.filepath, info = texture.info]() { *result = device.texture_cache().get(filepath, info); });
+                    track(texture.filepath, std::move(done), handle, result, texture.on_ready);
+                    started++;
+                }
+                return started;
+            }
+
+            void AssetStreamer::update() {
+                frame++;
+
+                for (auto it = pending.begin(); it != pending.end();) {
+                    if (it->done.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready) {
+                        ++it;
+                        continue;
+                    }
+
+                    try {
+                        it->done.get();
+                        it->swap();
+                    } catch (const std::exception &e) {
+                        // keep the placeholder, a broken asset should not take the whole scene down
+                        std::cerr << "failed to stream " << it->filepath << ": " << e.what() << std::endl;
+                        it->fail();
+                    }
+                    it = pending.erase(it);
+                }
+
+                // the previous resource may still be referenced by command buffers of frames in flight
+                std::erase_if(retired, [this](const RetiredResource &resource) { return frame - resource.frame > SwapChain::MAX_FRAMES_IN_FLIGHT; });
+            }
+        }
+    }
+}
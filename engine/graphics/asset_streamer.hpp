@@ -0,0 +1,135 @@
+#pragma once
+
+#include "descriptors.hpp"
+#include "model.hpp"
+#include "texture.hpp"
+#include "../core/thread_pool.hpp"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            /**
+             * @brief Handle to an asset that is loaded in the background. Holds a placeholder until
+             * AssetStreamer::update swaps the real resource in.
+             */
+            template <typename T>
+            class StreamedAsset {
+            public:
+                const std::shared_ptr<T> &get() const { return resource; }
+                bool is_ready() const { return ready; }
+                bool has_failed() const { return failed; }
+
+            private:
+                friend class AssetStreamer;
+
+                std::shared_ptr<T> resource = {};
+                bool ready = false;
+                bool failed = false;
+            };
+
+            /**
+             * @brief Loads models and textures on background threads and hands back placeholders right away:
+             * an empty model that draws nothing, or the white texture. Decode and upload run on the streamer's
+             * own workers, finished assets are swapped in by update() on the main thread between frames.
+             * Replaced resources are kept alive until the frames that might still reference them have retired.
+             * Assets it loaded can be reloaded when their files change, see reload.
+             */
+            class AssetStreamer {
+            public:
+                using ModelHandle = std::shared_ptr<StreamedAsset<Model>>;
+                using TextureHandle = std::shared_ptr<StreamedAsset<Texture>>;
+
+                AssetStreamer(Device &_device, usize thread_count = 2);
+                // waits for loads still in flight, the layouts and pools they use must outlive the streamer
+                ~AssetStreamer();
+
+                AssetStreamer(const AssetStreamer &) = delete;
+                AssetStreamer &operator=(const AssetStreamer &) = delete;
+
+                /**
+                 * @brief Start loading a model. on_ready runs inside update() once the model is swapped in.
+                 */
+                ModelHandle load_model(const std::string &filepath, DescriptorSetLayout &set_layout, DescriptorAllocator &allocator, const ModelInfo &info = {},
+                                       std::function<void(const std::shared_ptr<Model> &)> on_ready = {});
+
+                /**
+                 * @brief Start loading a texture through the device's TextureCache. on_ready runs inside update() once it is swapped in,
+                 * and again whenever a reload replaces it, so descriptors can be pointed at the new texture.
+                 */
+                TextureHandle load_texture(const std::string &filepath, const TextureInfo &info = {}, std::function<void(const std::shared_ptr<Texture> &)> on_ready = {});
+
+                /**
+                 * @brief Swap finished loads in and release resources retired long enough ago.
+                 * Call once per frame on the main thread, outside of command buffer recording.
+                 */
+                void update();
+
+                /**
+                 * @brief Re-import in the background every loaded asset that depends on the file at path. Models are swapped
+                 * into the existing Model object by update(), so everything holding the model keeps drawing the new one.
+                 * A failed reload keeps the current asset.
+                 * @return number of reloads started
+                 */
+                usize reload(const std::string &path);
+
+                usize pending_count() const { return pending.size(); }
+
+            private:
+                struct PendingLoad {
+                    std::string filepath;
+                    std::future<void> done;       // the background load, rethrows its exception
+                    std::function<void()> swap;   // publishes the result, runs on the main thread
+                    std::function<void()> fail;
+                };
+
+                struct StreamedModel {
+                    std::weak_ptr<StreamedAsset<Model>> handle;
+                    std::string filepath;
+                    DescriptorSetLayout *set_layout;
+                    DescriptorAllocator *allocator;
+                    ModelInfo info;
+                };
+
+                struct StreamedTexture {
+                    std::weak_ptr<StreamedAsset<Texture>> handle;
+                    std::string filepath;
+                    TextureInfo info;
+                    std::function<void(const std::shared_ptr<Texture> &)> on_ready;
+                };
+
+                struct RetiredResource {
+                    u64 frame;
+                    std::shared_ptr<void> resource;
+                };
+
+                template <typename T>
+                void track(const std::string &filepath, std::future<void> done, const std::shared_ptr<StreamedAsset<T>> &handle, const std::shared_ptr<std::shared_ptr<T>> &result,
+                           std::function<void(const std::shared_ptr<T> &)> on_ready);
+
+                template <typename T>
+                void retire(std::shared_ptr<T> resource) {
+                    retired.push_back({ frame, std::move(resource) });
+                }
+
+                Device &device;
+                std::shared_ptr<Model> empty_model;
+                std::shared_ptr<Texture> white_texture;
+
+                std::vector<PendingLoad> pending = {};
+                std::vector<StreamedModel> models = {};
+                std::vector<StreamedTexture> textures = {};
+                std::vector<RetiredResource> retired = {};
+                u64 frame = 0;
+
+                // declared last so its workers are joined before the members above go away
+                ThreadPool workers;
+            };
+        }
+    }
+}
@@ -0,0 +1,138 @@
+#include "bindless_materials.hpp"
+#include "texture.hpp"
+
+#include <stdexcept>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            BindlessMaterials::BindlessMaterials(Device &_device) : device{ _device } {
+                // slots are written while frames using other slots are in flight
+                constexpr VkDescriptorBindingFlags TEXTURE_FLAGS = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+                set_layout = DescriptorSetLayout::Builder(device)
+                                 .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, MAX_TEXTURES, TEXTURE_FLAGS)
+                                 .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+                                 .build();
+                pool = DescriptorPool::Builder(device)
+                           .setMaxSets(1)
+                           .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TEXTURES)
+                           .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1)
+                           .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+                           .build();
+
+                // written from the CPU as materials are added, read in place by the shaders
+                material_buffer = std::make_unique<Buffer>(device.device(), device.allocator(),
+                                                           BufferInfo{
+                                                               .instance_size = sizeof(BindlessMaterial),
+                                                               .instance_count = MAX_MATERIALS,
+                                                               .memory_flags = MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
+                                                           });
+                material_buffer->map();
+
+                auto buffer_info = material_buffer->descriptor_info();
+                if (!DescriptorWriter(*set_layout, *pool).writeBuffer(1, &buffer_info).build(vk_descriptor_set)) {
+                    throw std::runtime_error("failed to allocate the bindless descriptor set!");
+                }
+            }
+
+            BindlessMaterials::~BindlessMaterials() {}
+
+            u32 BindlessMaterials::add_texture(Texture &texture) {
+                TextureSlot &slot = texture_slots[&texture];
+                if (slot.references++ > 0) {
+                    return slot.index;
+                }
+
+                if (!free_textures.empty()) {
+                    slot.index = free_textures.back();
+                    free_textures.pop_back();
+                    slot_textures[slot.index] = &texture;
+                } else {
+                    if (slot_textures.size() == MAX_TEXTURES) {
+                        texture_slots.erase(&texture);
+                        throw std::runtime_error("bindless texture array is full!");
+                    }
+                    slot.index = static_cast<u32>(slot_textures.size());
+                    slot_textures.push_back(&texture);
+                }
+
+                VkDescriptorImageInfo image_info = {
+                    .sampler = texture.getSampler(),
+                    .imageView = texture.getImageView(),
+                    .imageLayout = texture.getImageLayout(),
+                };
+                VkWriteDescriptorSet write = {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = vk_descriptor_set,
+                    .dstBinding = 0,
+                    .dstArrayElement = slot.index,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .pImageInfo = &image_info,
+                };
+                vkUpdateDescriptorSets(device.device(), 1, &write, 0, nullptr);
+                return slot.index;
+            }
+
+            void BindlessMaterials::release_texture(u32 index) {
+                Texture *texture = slot_textures[index];
+                auto it = texture_slots.find(texture);
+                if (--it->second.references > 0) {
+                    return;
+                }
+                // a partially bound slot nobody indexes may keep pointing at the destroyed image
+                texture_slots.erase(it);
+                slot_textures[index] = nullptr;
+                free_textures.push_back(index);
+            }
+
+            u32 BindlessMaterials::add_material(const BindlessMaterialInfo &info) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                if (free_materials.empty() && materials.size() == MAX_MATERIALS) {
+                    throw std::runtime_error("bindless material buffer is full!");
+                }
+
+                BindlessMaterial material = {
+                    .albedo_texture = add_texture(*info.albedo),
+                    .normal_texture = add_texture(*info.normal),
+                    .metallic_roughness_texture = add_texture(*info.metallic_roughness),
+                    .features = info.features,
+                };
+
+                u32 index = 0;
+                if (!free_materials.empty()) {
+                    index = free_materials.back();
+                    free_materials.pop_back();
+                    materials[index] = material;
+                } else {
+                    index = static_cast<u32>(materials.size());
+                    materials.push_back(material);
+                }
+
+                VkDeviceSize offset = static_cast<VkDeviceSize>(index) * sizeof(BindlessMaterial);
+                material_buffer->write_to_buffer(&material, sizeof(BindlessMaterial), offset);
+                material_buffer->flush(sizeof(BindlessMaterial), offset);
+                return index;
+            }
+
+            void BindlessMaterials::release_material(u32 index) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                const BindlessMaterial &material = materials[index];
+                release_texture(material.albedo_texture);
+                release_texture(material.normal_texture);
+                release_texture(material.metallic_roughness_texture);
+                free_materials.push_back(index);
+            }
+
+            u32 BindlessMaterials::texture_count() {
+                std::lock_guard<std::mutex> lock{ mutex };
+                return static_cast<u32>(texture_slots.size());
+            }
+
+            u32 BindlessMaterials::material_count() {
+                std::lock_guard<std::mutex> lock{ mutex };
+                return static_cast<u32>(materials.size() - free_materials.size());
+            }
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "descriptors.hpp"
+#include "device.hpp"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            class Texture;
+
+            // std430 Material of simple_shader.frag, indices into the texture array
+            struct BindlessMaterial {
+                u32 albedo_texture = 0;
+                u32 normal_texture = 0;
+                u32 metallic_roughness_texture = 0;
+                u32 features = 0; // MaterialFeatureBits
+            };
+
+            struct BindlessMaterialInfo {
+                Texture *albedo = nullptr;
+                Texture *normal = nullptr;
+                Texture *metallic_roughness = nullptr;
+                u32 features = 0;
+            };
+
+            /**
+             * @brief One descriptor set holding every texture in an array and every material in a storage buffer.
+             * Bound once per frame, a draw selects its material through the instance index, so primitives need
+             * no descriptor binds of their own. Slots are written with update after bind, partially bound
+             * descriptors leave unused slots undefined.
+             */
+            class BindlessMaterials {
+            public:
+                static constexpr u32 MAX_TEXTURES = 4096;
+                static constexpr u32 MAX_MATERIALS = 16384;
+
+                BindlessMaterials(Device &_device);
+                ~BindlessMaterials();
+
+                BindlessMaterials(const BindlessMaterials &) = delete;
+                BindlessMaterials &operator=(const BindlessMaterials &) = delete;
+
+                // binding 0 sampler2D textures[MAX_TEXTURES], binding 1 Material materials[]
+                VkDescriptorSetLayout descriptor_set_layout() const { return set_layout->getDescriptorSetLayout(); }
+                VkDescriptorSet descriptor_set() const { return vk_descriptor_set; }
+
+                /**
+                 * @brief Register a material, its textures share slots with every other material using them.
+                 * Safe to call from any thread, the textures have to stay alive until the material is released.
+                 * @return index of the material in the storage buffer, the firstInstance to draw it with
+                 */
+                u32 add_material(const BindlessMaterialInfo &info);
+                void release_material(u32 index);
+
+                u32 texture_count();
+                u32 material_count();
+
+            private:
+                struct TextureSlot {
+                    u32 index = 0;
+                    u32 references = 0;
+                };
+
+                u32 add_texture(Texture &texture);
+                void release_texture(u32 index);
+
+                Device &device;
+                std::shared_ptr<DescriptorSetLayout> set_layout;
+                std::unique_ptr<DescriptorPool> pool;
+                VkDescriptorSet vk_descriptor_set = VK_NULL_HANDLE;
+                std::unique_ptr<Buffer> material_buffer;
+
+                std::mutex mutex;
+                std::unordered_map<Texture *, TextureSlot> texture_slots;
+                std::vector<Texture *> slot_textures; // texture of every slot handed out, nullptr once free
+                std::vector<u32> free_textures;
+                std::vector<BindlessMaterial> materials; // CPU copy, to release the textures of a material
+                std::vector<u32> free_materials;
+            };
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#include "cooked_mesh.hpp"
+
+// std
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            static_assert(std::is_trivially_copyable_v<Model::Vertex>, "cooked vertices are copied as raw bytes");
+            static_assert(std::is_trivially_copyable_v<MeshPrimitiveData>, "cooked primitives are copied as raw bytes");
+            static_assert(std::is_trivially_copyable_v<MeshMeshletData>, "cooked meshlets are copied as raw bytes");
+            static_assert(std::is_trivially_copyable_v<MeshInstanceData>, "cooked instances are copied as raw bytes");
+            static_assert(std::is_trivially_copyable_v<MeshMaterialData>, "cooked materials are copied as raw bytes");
+
+            static constexpr u64 STREAM_ALIGNMENT = 16;
+
+            static u64 align_stream(u64 offset) { return (offset + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1); }
+
+            CookedMesh::CookedMesh(const std::string &path) : file{ VirtualFileSystem::shared().open(path) } {
+                if (file.size() < sizeof(CookedMeshHeader)) {
+                    throw std::runtime_error("cooked mesh is truncated: " + path);
+                }
+
+                const CookedMeshHeader &h = header();
+                if (h.magic != CookedMeshHeader::MAGIC || h.version != CookedMeshHeader::VERSION) {
+                    throw std::runtime_error("cooked mesh has an unsupported format, recook it: " + path);
+                }
+                if (h.vertex_stride != sizeof(Model::Vertex)) {
+                    throw std::runtime_error("cooked mesh vertex layout does not match the engine, recook it: " + path);
+                }
+
+                auto in_bounds = [&](u64 offset, u64 size) { return offset <= file.size() && size <= file.size() - offset; };
+                if (!in_bounds(h.vertex_offset, u64(h.vertex_count) * sizeof(Model::Vertex)) || !in_bounds(h.index_offset, u64(h.index_count) * sizeof(u32)) ||
+                    !in_bounds(h.primitive_offset, u64(h.primitive_count) * sizeof(MeshPrimitiveData)) || !in_bounds(h.meshlet_offset, u64(h.meshlet_count) * sizeof(MeshMeshletData)) ||
+                    !in_bounds(h.instance_offset, u64(h.instance_count) * sizeof(MeshInstanceData)) || !in_bounds(h.material_offset, u64(h.material_count) * sizeof(MeshMaterialData)) ||
+                    !in_bounds(h.image_table_offset, h.image_table_size)) {
+                    throw std::runtime_error("cooked mesh is truncated: " + path);
+                }
+
+                const u8 *table = file.data() + h.image_table_offset;
+                const u8 *table_end = table + h.image_table_size;
+                uris.reserve(h.image_count);
+                for (u32 i = 0; i < h.image_count; i++) {
+                    u32 length = 0;
+                    if (table_end - table < static_cast<std::ptrdiff_t>(sizeof(length))) {
+                        throw std::runtime_error("cooked mesh image table is corrupt: " + path);
+                    }
+                    std::memcpy(&length, table, sizeof(length));
+                    table += sizeof(length);
+                    if (table_end - table < static_cast<std::ptrdiff_t>(length)) {
+                        throw std::runtime_error("cooked mesh image table is corrupt: " + path);
+                    }
+                    uris.emplace_back(reinterpret_cast<const char *>(table), length);
+                    table += length;
+                }
+            }
+
+            std::vector<u8> CookedMesh::serialize(const MeshData &mesh) {
+                std::vector<u8> image_table;
+                for (auto &uri : mesh.image_uris) {
+                    u32 length = static_cast<u32>(uri.size());
+                    image_table.insert(image_table.end(), reinterpret_cast<const u8 *>(&length), reinterpret_cast<const u8 *>(&length) + sizeof(length));
+                    image_table.insert(image_table.end(), uri.begin(), uri.end());
+                }
+
+                CookedMeshHeader h{};
+                h.vertex_count = static_cast<u32>(mesh.vertices.size());
+                h.index_count = static_cast<u32>(mesh.indices.size());
+                h.primitive_count = static_cast<u32>(mesh.primitives.size());
+                h.material_count = static_cast<u32>(mesh.materials.size());
+                h.image_count = static_cast<u32>(mesh.image_uris.size());
+                h.meshlet_count = static_cast<u32>(mesh.meshlets.size());
+                h.instance_count = static_cast<u32>(mesh.instances.size());
+                h.vertex_offset = align_stream(sizeof(CookedMeshHeader));
+                h.index_offset = align_stream(h.vertex_offset + mesh.vertices.size() * sizeof(Model::Vertex));
+                h.primitive_offset = align_stream(h.index_offset + mesh.indices.size() * sizeof(u32));
+                h.meshlet_offset = align_stream(h.primitive_offset + mesh.primitives.size() * sizeof(MeshPrimitiveData));
+                h.instance_offset = align_stream(h.meshlet_offset + mesh.meshlets.size() * sizeof(MeshMeshletData));
+                h.material_offset = align_stream(h.instance_offset + mesh.instances.size() * sizeof(MeshInstanceData));
+                h.image_table_offset = align_stream(h.material_offset + mesh.materials.size() * sizeof(MeshMaterialData));
+                h.image_table_size = image_table.size();
+                std::memcpy(h.bounds_min, &mesh.bounds_min, sizeof(h.bounds_min));
+                std::memcpy(h.bounds_max, &mesh.bounds_max, sizeof(h.bounds_max));
+
+                std::vector<u8> blob(h.image_table_offset + h.image_table_size, 0);
+                std::memcpy(blob.data(), &h, sizeof(h));
+                std::memcpy(blob.data() + h.vertex_offset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Model::Vertex));
+                std::memcpy(blob.data() + h.index_offset, mesh.indices.data(), mesh.indices.size() * sizeof(u32));
+                std::memcpy(blob.data() + h.primitive_offset, mesh.primitives.data(), mesh.primitives.size() * sizeof(MeshPrimitiveData));
+                std::memcpy(blob.data() + h.meshlet_offset, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(MeshMeshletData));
+                std::memcpy(blob.data() + h.instance_offset, mesh.instances.data(), mesh.instances.size() * sizeof(MeshInstanceData));
+                std::memcpy(blob.data() + h.material_offset, mesh.materials.data(), mesh.materials.size() * sizeof(MeshMaterialData));
+                std::memcpy(blob.data() + h.image_table_offset, image_table.data(), image_table.size());
+                return blob;
+            }
+
+            void CookedMesh::write(const MeshData &mesh, const std::string &path) {
+                std::vector<u8> blob = serialize(mesh);
+
+                std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("failed to open file for writing: " + path);
+                }
+                out.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+                if (!out) {
+                    throw std::runtime_error("failed to write cooked mesh: " + path);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "mesh_data.hpp"
+#include "../core/virtual_file_system.hpp"
+
+#include <string>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            /**
+             * @brief On-disk layout of a cooked mesh (.vmesh). All streams are stored in the engine's runtime layout
+             * and aligned to 16 bytes, so loading is a bounds check plus one memcpy per stream.
+             *
+             * [header][vertices][indices][primitives][meshlets][instances][materials][image uri table]
+             * The uri table is a sequence of u32 length + characters, one entry per image.
+             */
+            struct CookedMeshHeader {
+                static constexpr u32 MAGIC = 0x48534d56; // "VMSH"
+                static constexpr u32 VERSION = 4;
+
+                u32 magic = MAGIC;
+                u32 version = VERSION;
+                u32 vertex_stride = sizeof(Model::Vertex);
+                u32 vertex_count = 0;
+                u32 index_count = 0;
+                u32 primitive_count = 0;
+                u32 material_count = 0;
+                u32 image_count = 0;
+                u32 meshlet_count = 0;
+                u32 instance_count = 0;
+                u64 vertex_offset = 0;
+                u64 index_offset = 0;
+                u64 primitive_offset = 0;
+                u64 meshlet_offset = 0;
+                u64 instance_offset = 0;
+                u64 material_offset = 0;
+                u64 image_table_offset = 0;
+                u64 image_table_size = 0;
+                f32 bounds_min[3] = {};
+                f32 bounds_max[3] = {};
+            };
+
+            /**
+             * @brief Memory mapped (or packed, see VirtualFileSystem) cooked mesh. The stream pointers stay valid for the lifetime of the object.
+             *
+             */
+            class CookedMesh {
+            public:
+                static constexpr const char *EXTENSION = ".vmesh";
+
+                CookedMesh(const std::string &path);
+
+                const CookedMeshHeader &header() const { return *reinterpret_cast<const CookedMeshHeader *>(file.data()); }
+
+                const Model::Vertex *vertices() const { return reinterpret_cast<const Model::Vertex *>(file.data() + header().vertex_offset); }
+                const u32 *indices() const { return reinterpret_cast<const u32 *>(file.data() + header().index_offset); }
+                const MeshPrimitiveData *primitives() const { return reinterpret_cast<const MeshPrimitiveData *>(file.data() + header().primitive_offset); }
+                const MeshMeshletData *meshlets() const { return reinterpret_cast<const MeshMeshletData *>(file.data() + header().meshlet_offset); }
+                const MeshInstanceData *instances() const { return reinterpret_cast<const MeshInstanceData *>(file.data() + header().instance_offset); }
+                const MeshMaterialData *materials() const { return reinterpret_cast<const MeshMaterialData *>(file.data() + header().material_offset); }
+                const std::vector<std::string> &image_uris() const { return uris; }
+
+                /**
+                 * @brief Serialize mesh to path. Image uris are written as they are, callers rebase them if the cooked
+                 * file does not end up next to the source.
+                 */
+                static void write(const MeshData &mesh, const std::string &path);
+                static std::vector<u8> serialize(const MeshData &mesh);
+
+            private:
+                FileView file;
+                std::vector<std::string> uris = {};
+            };
+        }
+    }
+}
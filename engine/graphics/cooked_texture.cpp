@@ -0,0 +1,85 @@
+#include "cooked_texture.hpp"
+
+// std
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            static constexpr u64 LEVEL_ALIGNMENT = 16;
+
+            static u64 align_level(u64 offset) { return (offset + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1); }
+
+            CookedTexture::CookedTexture(const std::string &path) : file{ VirtualFileSystem::shared().open(path) } { validate(path); }
+
+            CookedTexture::CookedTexture(std::vector<u8> blob, const std::string &name) : file{ FileView::adopt(std::move(blob)) } { validate(name); }
+
+            void CookedTexture::validate(const std::string &path) const {
+                if (file.size() < sizeof(CookedTextureHeader)) {
+                    throw std::runtime_error("cooked texture is truncated: " + path);
+                }
+
+                const CookedTextureHeader &h = header();
+                if (h.magic != CookedTextureHeader::MAGIC || h.version != CookedTextureHeader::VERSION) {
+                    throw std::runtime_error("cooked texture has an unsupported format, recook it: " + path);
+                }
+                if (h.level_count == 0 || h.level_count > CookedTextureHeader::MAX_LEVELS) {
+                    throw std::runtime_error("cooked texture has an invalid mip chain: " + path);
+                }
+
+                for (u32 level = 0; level < h.level_count; level++) {
+                    auto &l = h.levels[level];
+                    if (l.offset > file.size() || l.size > file.size() - l.offset || l.offset % LEVEL_ALIGNMENT != 0) {
+                        throw std::runtime_error("cooked texture is truncated: " + path);
+                    }
+                }
+            }
+
+            u64 CookedTexture::data_size() const {
+                const CookedTextureHeader &h = header();
+                auto &last = h.levels[h.level_count - 1];
+                return last.offset + last.size - h.levels[0].offset;
+            }
+
+            std::vector<u8> CookedTexture::serialize(const CookedTextureData &texture) {
+                if (texture.levels.empty() || texture.levels.size() > CookedTextureHeader::MAX_LEVELS) {
+                    throw std::runtime_error("texture has an unsupported number of mip levels");
+                }
+
+                CookedTextureHeader h{};
+                h.format = static_cast<u32>(texture.format);
+                h.width = texture.width;
+                h.height = texture.height;
+                h.level_count = static_cast<u32>(texture.levels.size());
+
+                u64 offset = align_level(sizeof(CookedTextureHeader));
+                for (u32 level = 0; level < h.level_count; level++) {
+                    auto &source = texture.levels[level];
+                    h.levels[level] = { .offset = offset, .size = source.data.size(), .width = source.width, .height = source.height };
+                    offset = align_level(offset + source.data.size());
+                }
+
+                std::vector<u8> blob(offset, 0);
+                std::memcpy(blob.data(), &h, sizeof(h));
+                for (u32 level = 0; level < h.level_count; level++) {
+                    std::memcpy(blob.data() + h.levels[level].offset, texture.levels[level].data.data(), texture.levels[level].data.size());
+                }
+                return blob;
+            }
+
+            void CookedTexture::write(const CookedTextureData &texture, const std::string &path) {
+                std::vector<u8> blob = serialize(texture);
+                std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                if (!out) {
+                    throw std::runtime_error("failed to open file for writing: " + path);
+                }
+                out.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+                if (!out) {
+                    throw std::runtime_error("failed to write cooked texture: " + path);
+                }
+            }
+        }
+    }
+}
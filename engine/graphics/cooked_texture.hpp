@@ -0,0 +1,66 @@
+#pragma once
+
+#include "texture_compressor.hpp"
+#include "../core/virtual_file_system.hpp"
+
+#include <string>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            /**
+             * @brief On-disk layout of a cooked texture (.vtex), modelled after KTX2: a fixed header followed by
+             * every mip level in the image's final GPU format, largest first, each aligned to 16 bytes.
+             * Levels are stored back to back so the whole chain uploads with one staging copy.
+             */
+            struct CookedTextureHeader {
+                static constexpr u32 MAGIC = 0x58455456; // "VTEX"
+                static constexpr u32 VERSION = 1;
+                static constexpr u32 MAX_LEVELS = 16;
+
+                struct Level {
+                    u64 offset = 0;
+                    u64 size = 0;
+                    u32 width = 0;
+                    u32 height = 0;
+                };
+
+                u32 magic = MAGIC;
+                u32 version = VERSION;
+                u32 format = 0; // VkFormat
+                u32 width = 0;
+                u32 height = 0;
+                u32 level_count = 0;
+                Level levels[MAX_LEVELS] = {};
+            };
+
+            /**
+             * @brief Memory mapped (or packed, see VirtualFileSystem) cooked texture. The level pointers stay valid for the lifetime of the object.
+             *
+             */
+            class CookedTexture {
+            public:
+                static constexpr const char *EXTENSION = ".vtex";
+
+                CookedTexture(const std::string &path);
+                // a blob from serialize, name is only used in errors
+                CookedTexture(std::vector<u8> blob, const std::string &name);
+
+                const CookedTextureHeader &header() const { return *reinterpret_cast<const CookedTextureHeader *>(file.data()); }
+                const u8 *level_data(u32 level) const { return file.data() + header().levels[level].offset; }
+
+                // every level from the start of level 0 to the end of the last one
+                const u8 *data() const { return level_data(0); }
+                u64 data_size() const;
+
+                static std::vector<u8> serialize(const CookedTextureData &texture);
+                static void write(const CookedTextureData &texture, const std::string &path);
+
+            private:
+                void validate(const std::string &name) const;
+
+                FileView file;
+            };
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include "descriptors.hpp"
+#include "pipeline_library.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -8,7 +10,8 @@ namespace VGED {
         inline namespace Graphics {
             // *************** Descriptor Set Layout Builder *********************
 
-            DescriptorSetLayout::Builder &DescriptorSetLayout::Builder::addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count) {
+            DescriptorSetLayout::Builder &DescriptorSetLayout::Builder::addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count,
+                                                                                 VkDescriptorBindingFlags flags) {
                 assert(bindings.count(binding) == 0 && "Binding already in use");
                 VkDescriptorSetLayoutBinding layoutBinding{};
                 layoutBinding.binding = binding;
@@ -16,30 +19,91 @@ namespace VGED {
                 layoutBinding.descriptorCount = count;
                 layoutBinding.stageFlags = stageFlags;
                 bindings[binding] = layoutBinding;
+                if (flags != 0) {
+                    bindingFlags[binding] = flags;
+                }
                 return *this;
             }
 
-            std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const { return std::make_unique<DescriptorSetLayout>(device, bindings); }
+            std::shared_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const { return device.pipeline_library().descriptor_set_layout(bindings, bindingFlags); }
 
             // *************** Descriptor Set Layout *********************
 
-            DescriptorSetLayout::DescriptorSetLayout(Device &_device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings) : device{ _device }, bindings{ bindings } {
+            DescriptorSetLayout::DescriptorSetLayout(Device &_device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings, const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags)
+                : device{ _device }, bindings{ bindings } {
                 std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+                std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+                VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
                 for (auto kv : bindings) {
                     setLayoutBindings.push_back(kv.second);
+                    auto flags = bindingFlags.find(kv.first);
+                    setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+                    if (setLayoutBindingFlags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) {
+                        layoutFlags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+                    }
                 }
 
+                VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+                bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+                bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+                bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
                 VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
                 descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+                descriptorSetLayoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+                descriptorSetLayoutInfo.flags = layoutFlags;
                 descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
                 descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
                 if (vkCreateDescriptorSetLayout(device.device(), &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
                     throw std::runtime_error("failed to create descriptor set layout!");
                 }
+                createUpdateTemplate();
             }
 
-            DescriptorSetLayout::~DescriptorSetLayout() { vkDestroyDescriptorSetLayout(device.device(), descriptorSetLayout, nullptr); }
+            DescriptorSetLayout::~DescriptorSetLayout() {
+                if (updateTemplate != VK_NULL_HANDLE) {
+                    vkDestroyDescriptorUpdateTemplate(device.device(), updateTemplate, nullptr);
+                }
+                vkDestroyDescriptorSetLayout(device.device(), descriptorSetLayout, nullptr);
+            }
+
+            void DescriptorSetLayout::createUpdateTemplate() {
+                // DescriptorBatch tracks the written bindings of a set in a 64 bit mask
+                if (bindings.empty() || bindings.size() > 64) {
+                    return;
+                }
+                std::vector<VkDescriptorUpdateTemplateEntry> entries{};
+                for (auto &[binding, layoutBinding] : bindings) {
+                    if (layoutBinding.descriptorCount != 1) {
+                        return;
+                    }
+                    VkDescriptorUpdateTemplateEntry entry{};
+                    entry.dstBinding = binding;
+                    entry.descriptorCount = 1;
+                    entry.descriptorType = layoutBinding.descriptorType;
+                    entries.push_back(entry);
+                }
+                std::sort(entries.begin(), entries.end(), [](const VkDescriptorUpdateTemplateEntry &a, const VkDescriptorUpdateTemplateEntry &b) { return a.dstBinding < b.dstBinding; });
+                for (uint32_t i = 0; i < entries.size(); i++) {
+                    entries[i].offset = i * sizeof(DescriptorInfo);
+                    entries[i].stride = sizeof(DescriptorInfo);
+                    templateSlots[entries[i].dstBinding] = i;
+                }
+
+                VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+                templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+                templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+                templateInfo.pDescriptorUpdateEntries = entries.data();
+                templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+                templateInfo.descriptorSetLayout = descriptorSetLayout;
+
+                if (vkCreateDescriptorUpdateTemplate(device.device(), &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+                    // plain writes still work
+                    updateTemplate = VK_NULL_HANDLE;
+                    templateSlots.clear();
+                }
+            }
 
             // *************** Descriptor Pool Builder *********************
 
@@ -85,19 +149,104 @@ namespace VGED {
 
                 // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
                 // a new pool whenever an old pool fills up. But this is beyond our current scope
+                std::lock_guard<std::mutex> lock{ mutex };
                 if (vkAllocateDescriptorSets(device.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
                     return false;
                 }
                 return true;
             }
 
-            void DescriptorPool::freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const { vkFreeDescriptorSets(device.device(), descriptorPool, static_cast<uint32_t>(descriptors.size()), descriptors.data()); }
+            void DescriptorPool::freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const {
+                std::lock_guard<std::mutex> lock{ mutex };
+                vkFreeDescriptorSets(device.device(), descriptorPool, static_cast<uint32_t>(descriptors.size()), descriptors.data());
+            }
+
+            void DescriptorPool::resetPool() {
+                std::lock_guard<std::mutex> lock{ mutex };
+                vkResetDescriptorPool(device.device(), descriptorPool, 0);
+            }
+
+            // *************** Descriptor Allocator *********************
 
-            void DescriptorPool::resetPool() { vkResetDescriptorPool(device.device(), descriptorPool, 0); }
+            DescriptorAllocator::DescriptorAllocator(Device &_device, std::vector<PoolSizeRatio> _ratios, uint32_t initialSets, VkDescriptorPoolCreateFlags _poolFlags)
+                : device{ _device }, ratios{ std::move(_ratios) }, poolFlags{ _poolFlags }, setsPerPool{ initialSets } {
+                readyPools.push_back(createPool(setsPerPool));
+            }
+
+            DescriptorAllocator::~DescriptorAllocator() {
+                for (VkDescriptorPool pool : readyPools) {
+                    vkDestroyDescriptorPool(device.device(), pool, nullptr);
+                }
+                for (VkDescriptorPool pool : fullPools) {
+                    vkDestroyDescriptorPool(device.device(), pool, nullptr);
+                }
+            }
+
+            VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount) {
+                std::vector<VkDescriptorPoolSize> poolSizes{};
+                for (auto &ratio : ratios) {
+                    poolSizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio * setCount)) });
+                }
+
+                VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+                descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+                descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+                descriptorPoolInfo.pPoolSizes = poolSizes.data();
+                descriptorPoolInfo.maxSets = setCount;
+                descriptorPoolInfo.flags = poolFlags;
+
+                VkDescriptorPool pool;
+                if (vkCreateDescriptorPool(device.device(), &descriptorPoolInfo, nullptr, &pool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create descriptor pool!");
+                }
+                return pool;
+            }
+
+            VkDescriptorPool DescriptorAllocator::nextPool() {
+                fullPools.push_back(readyPools.back());
+                readyPools.pop_back();
+                if (readyPools.empty()) {
+                    setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+                    readyPools.push_back(createPool(setsPerPool));
+                }
+                return readyPools.back();
+            }
+
+            bool DescriptorAllocator::allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                VkDescriptorSetAllocateInfo allocInfo{};
+                allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+                allocInfo.descriptorPool = readyPools.back();
+                allocInfo.pSetLayouts = &descriptorSetLayout;
+                allocInfo.descriptorSetCount = 1;
+
+                VkResult result = vkAllocateDescriptorSets(device.device(), &allocInfo, &descriptor);
+                if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+                    allocInfo.descriptorPool = nextPool();
+                    result = vkAllocateDescriptorSets(device.device(), &allocInfo, &descriptor);
+                }
+                return result == VK_SUCCESS;
+            }
+
+            void DescriptorAllocator::resetPools() {
+                std::lock_guard<std::mutex> lock{ mutex };
+                readyPools.insert(readyPools.begin(), fullPools.begin(), fullPools.end());
+                fullPools.clear();
+                for (VkDescriptorPool pool : readyPools) {
+                    vkResetDescriptorPool(device.device(), pool, 0);
+                }
+            }
+
+            uint32_t DescriptorAllocator::getPoolCount() const {
+                std::lock_guard<std::mutex> lock{ mutex };
+                return static_cast<uint32_t>(readyPools.size() + fullPools.size());
+            }
 
             // *************** Descriptor Writer *********************
 
-            DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool) : setLayout{ setLayout }, pool{ pool } {}
+            DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool) : setLayout{ setLayout }, pool{ &pool } {}
+
+            DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorAllocator &allocator) : setLayout{ setLayout }, allocator{ &allocator } {}
 
             DescriptorWriter &DescriptorWriter::writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo) {
                 assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
@@ -136,7 +285,7 @@ namespace VGED {
             }
 
             bool DescriptorWriter::build(VkDescriptorSet &set) {
-                bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
+                bool success = pool ? pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set) : allocator->allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
                 if (!success) {
                     return false;
                 }
@@ -148,7 +297,84 @@ namespace VGED {
                 for (auto &write : writes) {
                     write.dstSet = set;
                 }
-                vkUpdateDescriptorSets(pool.device.device(), writes.size(), writes.data(), 0, nullptr);
+                vkUpdateDescriptorSets(setLayout.device.device(), writes.size(), writes.data(), 0, nullptr);
+            }
+
+            // *************** Descriptor Batch *********************
+
+            DescriptorBatch::~DescriptorBatch() { flush(); }
+
+            DescriptorBatch &DescriptorBatch::writeSet(DescriptorSetLayout &setLayout, VkDescriptorSet set) {
+                sets.push_back({ &setLayout, set, static_cast<uint32_t>(infos.size()), 0 });
+                return *this;
+            }
+
+            DescriptorBatch &DescriptorBatch::write(uint32_t binding, const DescriptorInfo &info) {
+                assert(!sets.empty() && "writeSet has to come before the writes");
+                assert(sets.back().setLayout->bindings.count(binding) == 1 && "Layout does not contain specified binding");
+                assert(sets.back().setLayout->bindings[binding].descriptorCount == 1 && "Binding single descriptor info, but binding expects multiple");
+                bindings.push_back(binding);
+                infos.push_back(info);
+                sets.back().writeCount++;
+                return *this;
+            }
+
+            DescriptorBatch &DescriptorBatch::writeBuffer(uint32_t binding, const VkDescriptorBufferInfo &bufferInfo) {
+                DescriptorInfo info{};
+                info.buffer = bufferInfo;
+                return write(binding, info);
+            }
+
+            DescriptorBatch &DescriptorBatch::writeImage(uint32_t binding, const VkDescriptorImageInfo &imageInfo) {
+                DescriptorInfo info{};
+                info.image = imageInfo;
+                return write(binding, info);
+            }
+
+            void DescriptorBatch::flush() {
+                std::vector<VkWriteDescriptorSet> writes{};
+                std::vector<DescriptorInfo> templateData{};
+                for (auto &pending : sets) {
+                    DescriptorSetLayout &setLayout = *pending.setLayout;
+
+                    // a template writes every binding, so it only fits sets that write all of them
+                    if (setLayout.updateTemplate != VK_NULL_HANDLE && pending.writeCount == setLayout.bindings.size()) {
+                        templateData.assign(setLayout.bindings.size(), DescriptorInfo{});
+                        uint64_t written = 0;
+                        for (uint32_t i = pending.firstWrite; i < pending.firstWrite + pending.writeCount; i++) {
+                            uint32_t slot = setLayout.templateSlots[bindings[i]];
+                            templateData[slot] = infos[i];
+                            written |= 1ull << slot;
+                        }
+                        if (written == (~0ull >> (64 - setLayout.bindings.size()))) {
+                            vkUpdateDescriptorSetWithTemplate(device.device(), pending.set, setLayout.updateTemplate, templateData.data());
+                            continue;
+                        }
+                    }
+
+                    for (uint32_t i = pending.firstWrite; i < pending.firstWrite + pending.writeCount; i++) {
+                        VkWriteDescriptorSet write{};
+                        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                        write.dstSet = pending.set;
+                        write.dstBinding = bindings[i];
+                        write.descriptorCount = 1;
+                        write.descriptorType = setLayout.bindings[bindings[i]].descriptorType;
+                        // infos doesn't grow during the flush, the pointers stay valid until the update
+                        if (write.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || write.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+                            write.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || write.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) {
+                            write.pBufferInfo = &infos[i].buffer;
+                        } else {
+                            write.pImageInfo = &infos[i].image;
+                        }
+                        writes.push_back(write);
+                    }
+                }
+                if (!writes.empty()) {
+                    vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+                }
+                sets.clear();
+                bindings.clear();
+                infos.clear();
             }
         }
     }
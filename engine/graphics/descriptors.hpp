@@ -3,39 +3,56 @@
 #include "device.hpp"
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
 namespace VGED {
     namespace Engine {
         inline namespace Graphics {
+            // one descriptor in the data of an update template, images and buffers share the stride
+            union DescriptorInfo {
+                VkDescriptorImageInfo image;
+                VkDescriptorBufferInfo buffer;
+            };
+
             class DescriptorSetLayout {
             public:
                 class Builder {
                 public:
                     Builder(Device &_device) : device{ _device } {}
 
-                    Builder &addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count = 1);
-                    std::unique_ptr<DescriptorSetLayout> build() const;
+                    // UPDATE_AFTER_BIND flags also put the layout into update after bind pools
+                    Builder &addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count = 1, VkDescriptorBindingFlags bindingFlags = 0);
+                    // identical bindings share one layout through the device's pipeline library
+                    std::shared_ptr<DescriptorSetLayout> build() const;
 
                 private:
                     Device &device;
                     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+                    std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
                 };
 
-                DescriptorSetLayout(Device &_device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+                DescriptorSetLayout(Device &_device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings, const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags = {});
                 ~DescriptorSetLayout();
                 DescriptorSetLayout(const DescriptorSetLayout &) = delete;
                 DescriptorSetLayout &operator=(const DescriptorSetLayout &) = delete;
 
                 VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+                // writes every binding from DescriptorInfo[binding count] in binding order, VK_NULL_HANDLE when a binding is an array
+                VkDescriptorUpdateTemplate getUpdateTemplate() const { return updateTemplate; }
 
             private:
+                void createUpdateTemplate();
+
                 Device &device;
                 VkDescriptorSetLayout descriptorSetLayout;
+                VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
                 std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+                std::unordered_map<uint32_t, uint32_t> templateSlots; // binding to its DescriptorInfo in the template data
 
                 friend class DescriptorWriter;
+                friend class DescriptorBatch;
             };
 
             class DescriptorPool {
@@ -68,13 +85,56 @@ namespace VGED {
             private:
                 Device &device;
                 VkDescriptorPool descriptorPool;
+                // descriptor pools are externally synchronized, models allocate from streaming threads
+                mutable std::mutex mutex;
 
                 friend class DescriptorWriter;
             };
 
+            /**
+             * @brief Hands out descriptor sets from a chain of pools, a pool that runs out is retired and the next one
+             * is created twice as large, up to MAX_SETS_PER_POOL. Pools don't allow freeing single sets, so an
+             * allocation is a bump inside the current pool and resetPools() releases everything at once.
+             */
+            class DescriptorAllocator {
+            public:
+                // descriptors of type reserved per set in every pool
+                struct PoolSizeRatio {
+                    VkDescriptorType type;
+                    float ratio;
+                };
+
+                static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+                DescriptorAllocator(Device &_device, std::vector<PoolSizeRatio> _ratios, uint32_t initialSets = 64, VkDescriptorPoolCreateFlags _poolFlags = 0);
+                ~DescriptorAllocator();
+                DescriptorAllocator(const DescriptorAllocator &) = delete;
+                DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+                // only fails when a freshly created pool can't hold the set either
+                bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor);
+                // every set handed out so far becomes invalid, the pools are kept for the next allocations
+                void resetPools();
+                uint32_t getPoolCount() const;
+
+            private:
+                VkDescriptorPool createPool(uint32_t setCount);
+                VkDescriptorPool nextPool();
+
+                Device &device;
+                std::vector<PoolSizeRatio> ratios;
+                VkDescriptorPoolCreateFlags poolFlags;
+                uint32_t setsPerPool;
+                std::vector<VkDescriptorPool> readyPools; // back() is the one allocated from
+                std::vector<VkDescriptorPool> fullPools;
+                // models allocate from streaming threads
+                mutable std::mutex mutex;
+            };
+
             class DescriptorWriter {
             public:
                 DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool);
+                DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorAllocator &allocator);
 
                 DescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
                 DescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
@@ -84,9 +144,47 @@ namespace VGED {
 
             private:
                 DescriptorSetLayout &setLayout;
-                DescriptorPool &pool;
+                DescriptorPool *pool = nullptr;
+                DescriptorAllocator *allocator = nullptr;
                 std::vector<VkWriteDescriptorSet> writes;
             };
+
+            /**
+             * @brief Gathers the writes of many sets, every material of a model or every per frame set, and applies
+             * them in flush(). Sets writing each binding of a layout with an update template go through the template,
+             * the rest share a single vkUpdateDescriptorSets. Infos are copied, they don't have to outlive the call.
+             */
+            class DescriptorBatch {
+            public:
+                DescriptorBatch(Device &_device) : device{ _device } {}
+                // pending writes are flushed
+                ~DescriptorBatch();
+                DescriptorBatch(const DescriptorBatch &) = delete;
+                DescriptorBatch &operator=(const DescriptorBatch &) = delete;
+
+                // following writes go to set, each binding at most once
+                DescriptorBatch &writeSet(DescriptorSetLayout &setLayout, VkDescriptorSet set);
+                DescriptorBatch &writeBuffer(uint32_t binding, const VkDescriptorBufferInfo &bufferInfo);
+                DescriptorBatch &writeImage(uint32_t binding, const VkDescriptorImageInfo &imageInfo);
+
+                void flush();
+                uint32_t getSetCount() const { return static_cast<uint32_t>(sets.size()); }
+
+            private:
+                struct PendingSet {
+                    DescriptorSetLayout *setLayout;
+                    VkDescriptorSet set;
+                    uint32_t firstWrite;
+                    uint32_t writeCount;
+                };
+
+                DescriptorBatch &write(uint32_t binding, const DescriptorInfo &info);
+
+                Device &device;
+                std::vector<PendingSet> sets;
+                std::vector<uint32_t> bindings; // binding of every info
+                std::vector<DescriptorInfo> infos;
+            };
         }
     }
 }
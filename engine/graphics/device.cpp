@@ -1,7 +1,14 @@
 #include "device.hpp"
 #include "../core/window.hpp"
+#include "bindless_materials.hpp"
+#include "pipeline_library.hpp"
+#include "texture_cache.hpp"
+#include "upload_manager.hpp"
+#include "../core/mapped_file.hpp"
 
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <set>
@@ -46,14 +53,48 @@ namespace VGED {
                 create_logical_device();
                 create_vma_allocator();
                 create_command_pool();
+                create_pipeline_cache();
+                main_thread_id = std::this_thread::get_id();
 
                 gpu_resource_manager = new GPUResourceManager();
+                uploads = new UploadManager(*this);
+                textures = new TextureCache(*this);
+                pipelines = new PipelineLibrary(*this);
+                bindless = new BindlessMaterials(*this);
             }
 
             Device::~Device() {
+                // pipelines still being built use the pipeline cache
+                delete pipelines;
+                delete bindless;
+                delete uploads;
+                delete textures;
+
+                // every texture has released its image and sampler by now, whatever is left was leaked by its owner
+                auto release_leaked = [](auto &pool, const char *kind) {
+                    std::vector<GPUResourceID> leaked = pool.live_ids();
+                    if (!leaked.empty()) {
+                        std::cerr << leaked.size() << " " << kind << " still alive at device teardown" << std::endl;
+                    }
+                    for (GPUResourceID id : leaked) {
+                        pool.delete_slot(id);
+                    }
+                };
+                release_leaked(gpu_resource_manager->buffer_pool, "buffers");
+                release_leaked(gpu_resource_manager->image_pool, "images");
+                release_leaked(gpu_resource_manager->sampler_pool, "samplers");
                 delete gpu_resource_manager;
 
+                save_pipeline_cache();
+                vkDestroyPipelineCache(vk_device, vk_pipeline_cache, nullptr);
+
                 vmaDestroyAllocator(vma_allocator);
+                for (auto &[thread_id, thread_pool] : vk_thread_command_pools) {
+                    vkDestroyCommandPool(vk_device, thread_pool, nullptr);
+                }
+                for (auto &[thread_id, fence] : vk_thread_fences) {
+                    vkDestroyFence(vk_device, fence, nullptr);
+                }
                 vkDestroyCommandPool(vk_device, vk_command_pool, nullptr);
                 vkDestroyDevice(vk_device, nullptr);
 
@@ -152,8 +193,14 @@ namespace VGED {
                     queueCreateInfos.push_back(queueCreateInfo);
                 }
 
+                VkPhysicalDeviceFeatures supported_features = {};
+                vkGetPhysicalDeviceFeatures(vk_physical_device, &supported_features);
+                bc_texture_support = supported_features.textureCompressionBC == VK_TRUE;
+
                 VkPhysicalDeviceFeatures device_features = {};
                 device_features.samplerAnisotropy = VK_TRUE;
+                // textures cooked by tools/texture_cooker, most mobile GPUs have no BC formats
+                device_features.textureCompressionBC = bc_texture_support ? VK_TRUE : VK_FALSE;
 
                 VkPhysicalDeviceDynamicRenderingFeatures dynamic_rendering_features = {
                     .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
@@ -161,9 +208,16 @@ namespace VGED {
                     .dynamicRendering = true
                 };
 
+                // UploadManager tracks its submits with a timeline semaphore
+                VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features = {
+                    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+                    .pNext = &dynamic_rendering_features,
+                    .timelineSemaphore = VK_TRUE
+                };
+
                 VkPhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features = {
                     .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
-                    .pNext = &dynamic_rendering_features,
+                    .pNext = &timeline_semaphore_features,
                     .shaderInputAttachmentArrayDynamicIndexing = VK_FALSE, // no render passes
                     .shaderUniformTexelBufferArrayDynamicIndexing = VK_TRUE,
                     .shaderStorageTexelBufferArrayDynamicIndexing = VK_TRUE,
@@ -239,7 +293,9 @@ namespace VGED {
                 vmaCreateAllocator(&vma_allocator_create_info, &this->vma_allocator);
             }
 
-            void Device::create_command_pool() {
+            void Device::create_command_pool() { vk_command_pool = create_transient_command_pool(); }
+
+            VkCommandPool Device::create_transient_command_pool() {
                 QueueFamilyIndices queue_family_indices = find_physical_queue_families();
 
                 VkCommandPoolCreateInfo vk_command_pool_create_info = {
@@ -249,9 +305,123 @@ namespace VGED {
                     .queueFamilyIndex = queue_family_indices.graphics_family
                 };
 
-                if (vkCreateCommandPool(vk_device, &vk_command_pool_create_info, nullptr, &vk_command_pool) != VK_SUCCESS) {
+                VkCommandPool pool;
+                if (vkCreateCommandPool(vk_device, &vk_command_pool_create_info, nullptr, &pool) != VK_SUCCESS) {
                     throw std::runtime_error("failed to create command pool!");
                 }
+                return pool;
+            }
+
+            // command pools are externally synchronized, so worker threads get a pool of their own
+            VkCommandPool Device::thread_command_pool() {
+                auto thread_id = std::this_thread::get_id();
+                if (thread_id == main_thread_id) {
+                    return vk_command_pool;
+                }
+
+                std::lock_guard<std::mutex> lock{ vk_command_pools_mutex };
+                auto it = vk_thread_command_pools.find(thread_id);
+                if (it == vk_thread_command_pools.end()) {
+                    it = vk_thread_command_pools.emplace(thread_id, create_transient_command_pool()).first;
+                }
+                return it->second;
+            }
+
+            // one reusable fence per thread for single time commands, reset after every wait
+            VkFence Device::thread_fence() {
+                std::lock_guard<std::mutex> lock{ vk_command_pools_mutex };
+                auto it = vk_thread_fences.find(std::this_thread::get_id());
+                if (it == vk_thread_fences.end()) {
+                    VkFenceCreateInfo vk_fence_create_info = {
+                        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                        .pNext = nullptr,
+                        .flags = {}
+                    };
+                    VkFence vk_fence;
+                    if (vkCreateFence(vk_device, &vk_fence_create_info, nullptr, &vk_fence) != VK_SUCCESS) {
+                        throw std::runtime_error("failed to create fence!");
+                    }
+                    it = vk_thread_fences.emplace(std::this_thread::get_id(), vk_fence).first;
+                }
+                return it->second;
+            }
+
+            void Device::create_pipeline_cache() {
+                // a cache from another driver or GPU would at best be ignored by the driver, so it is checked up front
+                MappedFile file;
+                std::error_code error;
+                if (std::filesystem::is_regular_file(PIPELINE_CACHE_PATH, error)) {
+                    try {
+                        file = MappedFile{ PIPELINE_CACHE_PATH };
+                    } catch (const std::exception &e) {
+                        std::cerr << "ignoring pipeline cache: " << e.what() << std::endl;
+                    }
+                }
+
+                const char *rejected = nullptr;
+                VkPipelineCacheHeaderVersionOne header{};
+                if (file.is_open()) {
+                    if (file.size() < sizeof(header)) {
+                        rejected = "truncated";
+                    } else {
+                        std::memcpy(&header, file.data(), sizeof(header));
+                        if (header.headerSize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+                            rejected = "unknown header";
+                        } else if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID) {
+                            rejected = "written for another GPU";
+                        } else if (std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+                            rejected = "written by another driver version";
+                        }
+                    }
+                }
+                if (rejected) {
+                    std::cout << "pipeline cache " << PIPELINE_CACHE_PATH << " is " << rejected << ", starting empty" << std::endl;
+                }
+                bool load = file.is_open() && !rejected;
+
+                VkPipelineCacheCreateInfo vk_pipeline_cache_create_info = {
+                    .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                    .pNext = nullptr,
+                    .flags = {},
+                    .initialDataSize = load ? file.size() : 0,
+                    .pInitialData = load ? file.data() : nullptr,
+                };
+                if (vkCreatePipelineCache(vk_device, &vk_pipeline_cache_create_info, nullptr, &vk_pipeline_cache) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create pipeline cache!");
+                }
+                if (load) {
+                    std::cout << "pipeline cache: loaded " << file.size() / 1024 << " KiB" << std::endl;
+                }
+            }
+
+            void Device::save_pipeline_cache() {
+                size_t size = 0;
+                if (vkGetPipelineCacheData(vk_device, vk_pipeline_cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+                    return;
+                }
+                std::vector<u8> data(size);
+                if (vkGetPipelineCacheData(vk_device, vk_pipeline_cache, &size, data.data()) != VK_SUCCESS) {
+                    return;
+                }
+
+                // written next to the target and renamed, a crash while saving leaves the previous cache intact
+                std::error_code error;
+                std::filesystem::path path{ PIPELINE_CACHE_PATH };
+                std::filesystem::create_directories(path.parent_path(), error);
+                std::filesystem::path temp = path;
+                temp += ".tmp";
+                {
+                    std::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+                    out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(size));
+                    if (!out) {
+                        std::cerr << "failed to write pipeline cache " << temp.string() << std::endl;
+                        return;
+                    }
+                }
+                std::filesystem::rename(temp, path, error);
+                if (error) {
+                    std::cerr << "failed to store pipeline cache " << path.string() << ": " << error.message() << std::endl;
+                }
             }
 
             void Device::create_surface() { window.create_window_surface(vk_instance, &vk_surface_khr); }
@@ -456,7 +626,7 @@ namespace VGED {
                 VkCommandBufferAllocateInfo vk_command_buffer_allocate_info = {
                     .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
                     .pNext = nullptr,
-                    .commandPool = vk_command_pool,
+                    .commandPool = thread_command_pool(),
                     .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
                     .commandBufferCount = 1
                 };
@@ -490,10 +660,16 @@ namespace VGED {
                     .pSignalSemaphores = nullptr
                 };
 
-                vkQueueSubmit(vk_graphics_queue, 1, &vk_submit_info, VK_NULL_HANDLE);
-                vkQueueWaitIdle(vk_graphics_queue);
+                // wait on a fence rather than the whole queue so an upload does not stall on in-flight frames
+                VkFence vk_fence = thread_fence();
+                {
+                    std::lock_guard<std::mutex> lock{ vk_queue_mutex };
+                    vkQueueSubmit(vk_graphics_queue, 1, &vk_submit_info, vk_fence);
+                }
+                vkWaitForFences(vk_device, 1, &vk_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+                vkResetFences(vk_device, 1, &vk_fence);
 
-                vkFreeCommandBuffers(vk_device, vk_command_pool, 1, &vk_command_buffer);
+                vkFreeCommandBuffers(vk_device, thread_command_pool(), 1, &vk_command_buffer);
             }
 
             void Device::copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
@@ -530,32 +706,28 @@ namespace VGED {
                 end_single_time_commands(vk_command_buffer);
             }
 
-            std::pair<std::unique_ptr<Image> &, u32> Device::create_image(const ImageInfo &info) {
-                auto [image, image_id] = gpu_resource_manager->image_pool.create_slot();
-                image = std::make_unique<Image>(vk_device, vma_allocator, info);
-                return { image, image_id };
+            std::pair<std::unique_ptr<Image> &, GPUResourceID> Device::create_image(const ImageInfo &info) {
+                return gpu_resource_manager->image_pool.create_slot(std::make_unique<Image>(vk_device, vma_allocator, info));
             }
 
-            std::pair<std::unique_ptr<Sampler> &, u32> Device::create_sampler(const SamplerInfo &info) {
-                auto [sampler, sampler_id] = gpu_resource_manager->sampler_pool.create_slot();
-                sampler = std::make_unique<Sampler>(vk_device, info);
-                return { sampler, sampler_id };
+            std::pair<std::unique_ptr<Sampler> &, GPUResourceID> Device::create_sampler(const SamplerInfo &info) {
+                return gpu_resource_manager->sampler_pool.create_slot(std::make_unique<Sampler>(vk_device, info));
             }
 
-            void Device::destroy_image(u32 image_id) {
+            void Device::destroy_image(GPUResourceID image_id) {
                 gpu_resource_manager->image_pool.delete_slot(image_id);
             }
 
-            void Device::destroy_sampler(u32 sampler_id) {
+            void Device::destroy_sampler(GPUResourceID sampler_id) {
                 gpu_resource_manager->sampler_pool.delete_slot(sampler_id);
             }
 
-            std::unique_ptr<Image> &Device::get_image(u32 index) {
-                return gpu_resource_manager->image_pool.get_slot(index);
+            std::unique_ptr<Image> &Device::get_image(GPUResourceID image_id) {
+                return gpu_resource_manager->image_pool.get_slot(image_id);
             }
 
-            std::unique_ptr<Sampler> &Device::get_sampler(u32 index) {
-                return gpu_resource_manager->sampler_pool.get_slot(index);
+            std::unique_ptr<Sampler> &Device::get_sampler(GPUResourceID sampler_id) {
+                return gpu_resource_manager->sampler_pool.get_slot(sampler_id);
             }
         }
     }
@@ -10,7 +10,10 @@
 #define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
 #include <vk_mem_alloc.h>
 
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "vk_types.hpp"
@@ -20,6 +23,11 @@
 namespace VGED {
     namespace Engine {
         inline namespace Graphics {
+            class BindlessMaterials;
+            class PipelineLibrary;
+            class TextureCache;
+            class UploadManager;
+
             struct SwapChainSupportDetails {
                 VkSurfaceCapabilitiesKHR capabilities;
                 std::vector<VkSurfaceFormatKHR> formats;
@@ -42,6 +50,8 @@ namespace VGED {
                 const bool enable_validation_layers = true;
 #endif
 
+                static constexpr const char *PIPELINE_CACHE_PATH = "cache/pipeline_cache.bin";
+
                 Device(Window &_window);
                 ~Device();
 
@@ -60,13 +70,25 @@ namespace VGED {
                 VkPhysicalDevice physical_device() { return vk_physical_device; }
                 uint32_t graphics_queue_family() { return find_physical_queue_families().graphics_family; }
                 VmaAllocator &allocator() { return vma_allocator; }
+                // shared by every pipeline, loaded from PIPELINE_CACHE_PATH and written back when the device is destroyed
+                VkPipelineCache pipeline_cache() { return vk_pipeline_cache; }
+                // every pipeline and pipeline layout, shared between systems asking for the same state
+                PipelineLibrary &pipeline_library() { return *pipelines; }
+                TextureCache &texture_cache() { return *textures; }
+                // every material's textures in one descriptor set, for pipelines drawing without per primitive binds
+                BindlessMaterials &bindless_materials() { return *bindless; }
+                UploadManager &upload_manager() { return *uploads; }
+                // textureCompressionBC, BC cooked textures can't be sampled without it
+                bool supports_bc_textures() const { return bc_texture_support; }
+                // every vkQueueSubmit / vkQueuePresentKHR / vkDeviceWaitIdle has to hold this lock
+                std::mutex &queue_mutex() { return vk_queue_mutex; }
 
                 SwapChainSupportDetails get_swap_chain_support() { return query_swap_chain_support(vk_physical_device); }
                 uint32_t find_memory_type(uint32_t typeFilter, VkMemoryPropertyFlags properties);
                 QueueFamilyIndices find_physical_queue_families() { return find_queue_families(vk_physical_device); }
                 VkFormat find_supported_format(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
-                // Buffer Helper Functions
+                // Buffer Helper Functions, safe to call from any thread (each thread records into its own command pool)
                 VkCommandBuffer begin_single_time_commands();
                 void end_single_time_commands(VkCommandBuffer commandBuffer);
                 void copy_buffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -74,15 +96,15 @@ namespace VGED {
 
                 VkPhysicalDeviceProperties properties;
 
-                // std::pair<std::unique_ptr<Buffer>&, u32> create_buffer(const BufferInfo& info);
-                std::pair<std::unique_ptr<Image> &, u32> create_image(const ImageInfo &info);
-                std::pair<std::unique_ptr<Sampler> &, u32> create_sampler(const SamplerInfo &info);
+                // std::pair<std::unique_ptr<Buffer>&, GPUResourceID> create_buffer(const BufferInfo& info);
+                std::pair<std::unique_ptr<Image> &, GPUResourceID> create_image(const ImageInfo &info);
+                std::pair<std::unique_ptr<Sampler> &, GPUResourceID> create_sampler(const SamplerInfo &info);
 
-                void destroy_image(u32 image_id);
-                void destroy_sampler(u32 sampler_id);
+                void destroy_image(GPUResourceID image_id);
+                void destroy_sampler(GPUResourceID sampler_id);
 
-                std::unique_ptr<Image> &get_image(u32 index);
-                std::unique_ptr<Sampler> &get_sampler(u32 index);
+                std::unique_ptr<Image> &get_image(GPUResourceID image_id);
+                std::unique_ptr<Sampler> &get_sampler(GPUResourceID sampler_id);
 
             private:
                 void create_instance();
@@ -92,6 +114,11 @@ namespace VGED {
                 void create_logical_device();
                 void create_vma_allocator();
                 void create_command_pool();
+                void create_pipeline_cache();
+                void save_pipeline_cache();
+                VkCommandPool create_transient_command_pool();
+                VkCommandPool thread_command_pool();
+                VkFence thread_fence();
 
                 // helper functions
                 bool is_device_suitable(VkPhysicalDevice device);
@@ -108,8 +135,18 @@ namespace VGED {
                 VkPhysicalDevice vk_physical_device = {};
                 Window &window;
                 VkCommandPool vk_command_pool = {};
+                std::thread::id main_thread_id = {};
+                bool bc_texture_support = false;
+                std::unordered_map<std::thread::id, VkCommandPool> vk_thread_command_pools = {};
+                std::unordered_map<std::thread::id, VkFence> vk_thread_fences = {};
+                std::mutex vk_command_pools_mutex = {};
+                std::mutex vk_queue_mutex = {};
 
                 GPUResourceManager *gpu_resource_manager;
+                PipelineLibrary *pipelines;
+                TextureCache *textures;
+                BindlessMaterials *bindless;
+                UploadManager *uploads;
 
                 VkDevice vk_device = {};
                 VkSurfaceKHR vk_surface_khr = {};
@@ -117,6 +154,7 @@ namespace VGED {
                 VkQueue vk_present_queue = {};
                 // VolkDeviceTable volk_device_table = {};
                 VmaAllocator vma_allocator = {};
+                VkPipelineCache vk_pipeline_cache = {};
 
                 const std::vector<const char *> validation_layers = { "VK_LAYER_KHRONOS_validation" };
                 const std::vector<const char *> device_extensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
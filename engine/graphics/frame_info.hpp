@@ -1,6 +1,7 @@
 #pragma once
 
 #include "camera.hpp"
+#include "descriptors.hpp"
 #include "game_object.hpp"
 
 #define MAX_LIGHTS 10
@@ -26,4 +27,5 @@ struct FrameInfo {
     VGED::Engine::Camera &camera;
     VkDescriptorSet globalDescriptorSet;
     VGED::Engine::GameObject::Map &gameObjects;
+    VGED::Engine::DescriptorAllocator &frameDescriptors; // sets allocated here are released once the frame completed
 };
@@ -48,6 +48,7 @@ namespace VGED {
 
                 glm::vec3 color{};
                 TransformComponent transform{};
+                uint32_t lodLevel = 0; // last lod drawn, kept for hysteresis
 
                 // Optional pointer components
                 std::shared_ptr<Model> model{};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "../core/result.hpp"
@@ -14,46 +16,135 @@
 namespace VGED {
     namespace Engine {
         inline namespace Graphics {
-            template <typename Resource, usize size = 1000>
+            /**
+             * @brief Handle of a pool slot, the index in the low bits and the generation of the slot in the high bits.
+             * Deleting a slot bumps its generation, so ids kept past a delete no longer match once the slot is reused.
+             * Generations start at 1, the default id is never handed out.
+             */
+            struct GPUResourceID {
+                static constexpr u32 INDEX_BITS = 20;
+                static constexpr u32 INDEX_MASK = (1u << INDEX_BITS) - 1;
+                static constexpr u32 GENERATION_MASK = ~0u >> INDEX_BITS;
+
+                u32 value = 0;
+
+                u32 index() const { return value & INDEX_MASK; }
+                u32 generation() const { return value >> INDEX_BITS; }
+                bool is_empty() const { return value == 0; }
+
+                bool operator==(const GPUResourceID &) const = default;
+            };
+
+            /**
+             * @brief Slots live in fixed size pages allocated as the pool grows, a slot never moves, so references
+             * handed out stay valid while other threads create resources. Lookups read the page table and the slot
+             * generations atomically and take no lock. The ids of the live resources are kept packed in one array
+             * for iteration.
+             */
+            template <typename Resource>
             class GPUResourcePool {
             public:
-                std::pair<std::unique_ptr<Resource> &, u32> create_slot() {
-                    if (next_index + 1 == max_resources && free_indices.empty()) {
-                        THROW("reached limit of resources!");
-                    }
+                static constexpr u32 PAGE_SIZE = 256;
+                static constexpr u32 MAX_RESOURCES = 1u << GPUResourceID::INDEX_BITS;
+                static constexpr u32 MAX_PAGES = MAX_RESOURCES / PAGE_SIZE;
 
+                // takes a constructed resource, so a failed construction leaves no half filled slot behind
+                std::pair<std::unique_ptr<Resource> &, GPUResourceID> create_slot(std::unique_ptr<Resource> resource) {
+                    std::lock_guard<std::mutex> lock{ mutex };
                     u32 index = {};
                     if (free_indices.empty()) {
+                        if (next_index == MAX_RESOURCES) {
+                            THROW("reached limit of resources!");
+                        }
                         index = next_index;
+                        if (pages[index / PAGE_SIZE].load(std::memory_order_relaxed) == nullptr) {
+                            owned_pages.push_back(std::make_unique<Page>());
+                            pages[index / PAGE_SIZE].store(owned_pages.back().get(), std::memory_order_release);
+                        }
                         next_index++;
                     } else {
                         index = free_indices.back();
                         free_indices.pop_back();
                     }
 
-                    auto &resource = pool[index];
-
-                    return { resource, index };
+                    Slot &slot = slot_at(index);
+                    slot.resource = std::move(resource);
+                    slot.live_index = static_cast<u32>(live.size());
+                    GPUResourceID id = { (slot.generation.load(std::memory_order_relaxed) << GPUResourceID::INDEX_BITS) | index };
+                    live.push_back(id);
+                    return { slot.resource, id };
                 }
 
-                void delete_slot(u32 index) {
-                    free_indices.push_back(index);
+                // destroys the resource, the id and every copy of it become stale
+                void delete_slot(GPUResourceID id) {
+                    std::unique_ptr<Resource> resource = {};
+                    {
+                        std::lock_guard<std::mutex> lock{ mutex };
+                        if (!verify_id(id)) {
+                            THROW("deleting a stale resource id!");
+                        }
+                        Slot &slot = slot_at(id.index());
+                        resource = std::move(slot.resource);
+                        u32 generation = (slot.generation.load(std::memory_order_relaxed) + 1) & GPUResourceID::GENERATION_MASK;
+                        slot.generation.store(generation != 0 ? generation : 1, std::memory_order_release);
+
+                        // swap the last live id into the hole
+                        GPUResourceID moved = live.back();
+                        live[slot.live_index] = moved;
+                        slot_at(moved.index()).live_index = slot.live_index;
+                        live.pop_back();
+                        free_indices.push_back(id.index());
+                    }
+                    // destroyed outside the lock, freeing memory can take a while
                 }
 
-                bool verify_slot(u32 index) {
-                    return pool[index] != nullptr;
+                bool verify_slot(GPUResourceID id) const {
+                    return verify_id(id) && slot_at(id.index()).resource != nullptr;
                 };
 
-                std::unique_ptr<Resource> &get_slot(u32 index) {
-                    auto &resource = pool[index];
-                    return resource;
+                std::unique_ptr<Resource> &get_slot(GPUResourceID id) {
+                    if (!verify_id(id)) {
+                        THROW("stale or invalid resource id!");
+                    }
+                    return slot_at(id.index()).resource;
+                }
+
+                // ids of every live resource, copied so resources can be created and deleted while iterating
+                std::vector<GPUResourceID> live_ids() const {
+                    std::lock_guard<std::mutex> lock{ mutex };
+                    return live;
+                }
+
+                u32 size() const {
+                    std::lock_guard<std::mutex> lock{ mutex };
+                    return static_cast<u32>(live.size());
                 }
 
             private:
-                std::array<std::unique_ptr<Resource>, size> pool;
+                struct Slot {
+                    std::unique_ptr<Resource> resource = {};
+                    std::atomic<u32> generation = 1;
+                    u32 live_index = 0;
+                };
+                using Page = std::array<Slot, PAGE_SIZE>;
+
+                Slot &slot_at(u32 index) { return (*pages[index / PAGE_SIZE].load(std::memory_order_acquire))[index % PAGE_SIZE]; }
+                const Slot &slot_at(u32 index) const { return (*pages[index / PAGE_SIZE].load(std::memory_order_acquire))[index % PAGE_SIZE]; }
+
+                // the page table has a fixed size and pages are never freed before the pool, so lookups need no lock
+                bool verify_id(GPUResourceID id) const {
+                    u32 index = id.index();
+                    return !id.is_empty() && pages[index / PAGE_SIZE].load(std::memory_order_acquire) != nullptr &&
+                           slot_at(index).generation.load(std::memory_order_acquire) == id.generation();
+                }
+
+                std::array<std::atomic<Page *>, MAX_PAGES> pages = {};
+                std::vector<std::unique_ptr<Page>> owned_pages = {};
+                std::vector<GPUResourceID> live = {};
                 std::vector<u32> free_indices = {};
                 u32 next_index = 0;
-                u32 max_resources = size;
+                // slots are handed out to streaming threads as well as the main thread
+                mutable std::mutex mutex = {};
             };
 
             struct GPUResourceManager {
@@ -63,4 +154,4 @@ namespace VGED {
             };
         }
     }
-}
\ No newline at end of file
+}
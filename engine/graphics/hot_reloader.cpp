@@ -0,0 +1,48 @@
+#include "hot_reloader.hpp"
+
+#include "pipeline.hpp"
+#include "swap_chain.hpp"
+
+// std
+#include <iostream>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            HotReloader::HotReloader(Device &_device, AssetStreamer &_streamer, const HotReloadInfo &info) : device{ _device }, streamer{ _streamer }, watcher{ info.directories, info.settle_time } {}
+
+            HotReloader::~HotReloader() {
+                for (auto &pipeline : retired) {
+                    vkDestroyPipeline(device.device(), pipeline.pipeline, nullptr);
+                }
+            }
+
+            void HotReloader::update() {
+                frame++;
+
+                for (auto &path : watcher.poll()) {
+                    usize reloaded = streamer.reload(path);
+                    for (RasterPipeline *pipeline : RasterPipeline::dependents_of(path)) {
+                        VkPipeline previous = VK_NULL_HANDLE;
+                        if (pipeline->reload(previous)) {
+                            retired.push_back({ frame, previous });
+                            reloaded++;
+                        }
+                    }
+                    if (reloaded > 0) {
+                        std::cout << "Reloading " << reloaded << " asset(s) using " << path << std::endl;
+                    }
+                }
+
+                // same rule as the streamer, frames in flight may still have the old pipeline bound
+                std::erase_if(retired, [this](const RetiredPipeline &pipeline) {
+                    if (frame - pipeline.frame <= SwapChain::MAX_FRAMES_IN_FLIGHT) {
+                        return false;
+                    }
+                    vkDestroyPipeline(device.device(), pipeline.pipeline, nullptr);
+                    return true;
+                });
+            }
+        }
+    }
+}
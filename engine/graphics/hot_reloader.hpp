@@ -0,0 +1,54 @@
+#pragma once
+
+#include "asset_streamer.hpp"
+#include "device.hpp"
+#include "../core/file_watcher.hpp"
+
+#include <string>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            struct HotReloadInfo {
+                std::vector<std::string> directories = { "models", "textures", "shaders" };
+                std::chrono::milliseconds settle_time{ 100 };
+            };
+
+            /**
+             * @brief Watches the asset directories and reloads what changed while the editor runs: models and textures
+             * loaded through the AssetStreamer are re-imported in the background, pipelines built from a changed shader or
+             * include are rebuilt. Only loose files are watched, files served from a mounted pack are not.
+             */
+            class HotReloader {
+            public:
+                HotReloader(Device &_device, AssetStreamer &_streamer, const HotReloadInfo &info = {});
+                // the device must be idle, retired pipelines are destroyed right away
+                ~HotReloader();
+
+                HotReloader(const HotReloader &) = delete;
+                HotReloader &operator=(const HotReloader &) = delete;
+
+                /**
+                 * @brief Start reloads for files that changed since the last call. Call once per frame on the main thread,
+                 * before AssetStreamer::update and outside of command buffer recording.
+                 */
+                void update();
+
+                bool is_active() const { return watcher.is_active(); }
+
+            private:
+                struct RetiredPipeline {
+                    u64 frame;
+                    VkPipeline pipeline;
+                };
+
+                Device &device;
+                AssetStreamer &streamer;
+                FileWatcher watcher;
+                std::vector<RetiredPipeline> retired = {};
+                u64 frame = 0;
+            };
+        }
+    }
+}
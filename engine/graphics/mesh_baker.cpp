@@ -0,0 +1,126 @@
+#include "mesh_baker.hpp"
+
+// std
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            static void append_primitive(const MeshData &source, const MeshPrimitiveData &primitive, MeshData &target) {
+                MeshPrimitiveData copy = primitive;
+                copy.first_vertex = static_cast<u32>(target.vertices.size());
+                copy.first_index = static_cast<u32>(target.indices.size());
+                target.vertices.insert(target.vertices.end(), source.vertices.begin() + primitive.first_vertex, source.vertices.begin() + primitive.first_vertex + primitive.vertex_count);
+                target.indices.insert(target.indices.end(), source.indices.begin() + primitive.first_index, source.indices.begin() + primitive.first_index + primitive.index_count);
+                target.primitives.push_back(copy);
+            }
+
+            static void append_baked_primitive(const MeshData &source, const MeshPrimitiveData &primitive, const glm::mat4 &transform, MeshData &target) {
+                glm::mat3 linear = glm::mat3(transform);
+                glm::mat3 normal_matrix = glm::transpose(glm::inverse(linear));
+                // mirroring transforms flip the winding and the bitangent
+                bool mirrored = glm::determinant(linear) < 0.0f;
+
+                MeshPrimitiveData baked = primitive;
+                baked.first_vertex = static_cast<u32>(target.vertices.size());
+                baked.first_index = static_cast<u32>(target.indices.size());
+                baked.bounds_min = glm::vec3(std::numeric_limits<f32>::max());
+                baked.bounds_max = glm::vec3(std::numeric_limits<f32>::lowest());
+
+                for (u32 v = primitive.first_vertex; v < primitive.first_vertex + primitive.vertex_count; v++) {
+                    Model::Vertex vertex = source.vertices[v];
+                    vertex.position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+                    if (vertex.normal != glm::vec3(0.0f)) {
+                        vertex.normal = glm::normalize(normal_matrix * vertex.normal);
+                    }
+                    if (glm::vec3(vertex.tangent) != glm::vec3(0.0f)) {
+                        vertex.tangent = glm::vec4(glm::normalize(linear * glm::vec3(vertex.tangent)), mirrored ? -vertex.tangent.w : vertex.tangent.w);
+                    }
+                    baked.bounds_min = glm::min(baked.bounds_min, vertex.position);
+                    baked.bounds_max = glm::max(baked.bounds_max, vertex.position);
+                    target.vertices.push_back(vertex);
+                }
+
+                for (u32 i = 0; i < primitive.index_count; i += 3) {
+                    const u32 *triangle = &source.indices[primitive.first_index + i];
+                    target.indices.push_back(triangle[0]);
+                    target.indices.push_back(mirrored ? triangle[2] : triangle[1]);
+                    target.indices.push_back(mirrored ? triangle[1] : triangle[2]);
+                }
+                target.primitives.push_back(baked);
+            }
+
+            TransformBakeStats bake_transforms(MeshData &mesh, const TransformBakeInfo &info) {
+                if (!mesh.meshlets.empty()) {
+                    throw std::runtime_error("bake transforms before building lods and meshlets");
+                }
+                for (auto &primitive : mesh.primitives) {
+                    if (primitive.lod_count > 1 || primitive.index_count % 3 != 0) {
+                        throw std::runtime_error("bake transforms before building lods and meshlets");
+                    }
+                }
+
+                TransformBakeStats stats{};
+                stats.instances_before = static_cast<u32>(mesh.instances.size());
+
+                std::unordered_map<u32, u32> uses;
+                for (auto &instance : mesh.instances) {
+                    uses[instance.first_primitive]++;
+                }
+
+                MeshData baked{};
+                baked.vertices.reserve(mesh.vertices.size());
+                baked.indices.reserve(mesh.indices.size());
+                baked.primitives.reserve(mesh.primitives.size());
+
+                // everything baked lands in one identity instance at the front
+                std::vector<const MeshInstanceData *> kept;
+                std::unordered_map<u32, u32> baked_meshes;
+                for (auto &instance : mesh.instances) {
+                    bool shared = uses[instance.first_primitive] > 1;
+                    if (shared && !info.bake_shared) {
+                        kept.push_back(&instance);
+                        continue;
+                    }
+                    // every bake of a mesh after its first one duplicates all of its vertices
+                    bool duplicate = baked_meshes[instance.first_primitive]++ > 0;
+                    for (u32 p = instance.first_primitive; p < instance.first_primitive + instance.primitive_count; p++) {
+                        append_baked_primitive(mesh, mesh.primitives[p], instance.transform, baked);
+                        if (duplicate) {
+                            stats.duplicated_vertices += mesh.primitives[p].vertex_count;
+                        }
+                    }
+                    stats.baked_instances++;
+                }
+                if (stats.baked_instances > 0) {
+                    baked.instances.push_back(MeshInstanceData{ .transform = glm::mat4{ 1.0f }, .first_primitive = 0, .primitive_count = static_cast<u32>(baked.primitives.size()) });
+                }
+
+                // shared meshes keep one copy of their geometry
+                std::unordered_map<u32, u32> remap;
+                for (const MeshInstanceData *instance : kept) {
+                    auto [it, inserted] = remap.try_emplace(instance->first_primitive, static_cast<u32>(baked.primitives.size()));
+                    if (inserted) {
+                        for (u32 p = instance->first_primitive; p < instance->first_primitive + instance->primitive_count; p++) {
+                            append_primitive(mesh, mesh.primitives[p], baked);
+                        }
+                    }
+                    baked.instances.push_back(MeshInstanceData{ .transform = instance->transform, .first_primitive = it->second, .primitive_count = instance->primitive_count });
+                }
+
+                mesh.vertices = std::move(baked.vertices);
+                mesh.indices = std::move(baked.indices);
+                mesh.primitives = std::move(baked.primitives);
+                mesh.instances = std::move(baked.instances);
+                mesh.update_bounds();
+
+                stats.instances_after = static_cast<u32>(mesh.instances.size());
+                return stats;
+            }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "mesh_data.hpp"
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            struct TransformBakeInfo {
+                bool bake_shared = false; // also bake meshes placed by several nodes, one copy of the geometry per instance
+            };
+
+            struct TransformBakeStats {
+                u32 instances_before = 0;
+                u32 instances_after = 0;
+                u32 baked_instances = 0;
+                u64 duplicated_vertices = 0; // copies made for shared meshes with bake_shared
+            };
+
+            /**
+             * @brief Bake static node transforms into the vertices, so a model draws with the object's transform alone.
+             * Meshes placed by a single node are transformed and merged into one identity instance at the front,
+             * shared meshes stay instanced unless info.bake_shared. Run before generate_lods and build_meshlets.
+             */
+            TransformBakeStats bake_transforms(MeshData &mesh, const TransformBakeInfo &info = {});
+        }
+    }
+}
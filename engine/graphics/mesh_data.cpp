@@ -0,0 +1,476 @@
+#include "mesh_data.hpp"
+#include "../core/hash.hpp"
+#include "../core/virtual_file_system.hpp"
+
+// libs
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+// external images are decoded by the texture loader on the thread pool, tinygltf doesn't need to read them
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#define STBI_MSC_SECURE_CRT
+//#define TINYGLTF_NO_STB_IMAGE
+#include <tinygltf/tiny_gltf.h>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            // strided view of an accessor's elements in the loaded buffer
+            struct AccessorView {
+                const u8 *data = nullptr;
+                usize stride = 0;
+                u32 count = 0;
+                int component_type = 0;
+                int components = 0;
+                bool normalized = false;
+            };
+
+            static AccessorView view_accessor(const tinygltf::Model &GltfModel, int index) {
+                const tinygltf::Accessor &accessor = GltfModel.accessors[index];
+                if (accessor.sparse.isSparse) {
+                    throw std::runtime_error("sparse accessors are not supported!");
+                }
+                if (accessor.bufferView == -1) {
+                    throw std::runtime_error("accessors without a buffer view are not supported!");
+                }
+                const tinygltf::BufferView &view = GltfModel.bufferViews[accessor.bufferView];
+                const tinygltf::Buffer &buffer = GltfModel.buffers[view.buffer];
+
+                // byteStride 0 means tightly packed, ByteStride resolves that to the element size
+                int stride = accessor.ByteStride(view);
+                if (stride <= 0) {
+                    throw std::runtime_error("invalid accessor stride!");
+                }
+                usize elementSize = static_cast<usize>(tinygltf::GetComponentSizeInBytes(accessor.componentType)) * tinygltf::GetNumComponentsInType(accessor.type);
+                usize offset = view.byteOffset + accessor.byteOffset;
+                if (accessor.count > 0 && offset + (accessor.count - 1) * static_cast<usize>(stride) + elementSize > buffer.data.size()) {
+                    throw std::runtime_error("accessor reads past the end of its buffer!");
+                }
+
+                AccessorView result{};
+                result.data = buffer.data.data() + offset;
+                result.stride = static_cast<usize>(stride);
+                result.count = static_cast<u32>(accessor.count);
+                result.component_type = accessor.componentType;
+                result.components = tinygltf::GetNumComponentsInType(accessor.type);
+                result.normalized = accessor.normalized;
+                return result;
+            }
+
+            static int find_attribute(const tinygltf::Primitive &GltfPrimitive, const char *name) {
+                auto attribute = GltfPrimitive.attributes.find(name);
+                return attribute != GltfPrimitive.attributes.end() ? attribute->second : -1;
+            }
+
+            template <typename T>
+            static f32 read_component(const u8 *element, int component, bool normalized, f32 scale) {
+                T value;
+                std::memcpy(&value, element + component * sizeof(T), sizeof(T));
+                return normalized ? std::max(static_cast<f32>(value) * scale, -1.0f) : static_cast<f32>(value);
+            }
+
+            // float data is copied as is, integer data (KHR_mesh_quantization, normalized uvs) is converted
+            template <int N>
+            static glm::vec<N, f32> read_element(const AccessorView &view, u32 index) {
+                const u8 *element = view.data + index * view.stride;
+                glm::vec<N, f32> value{ 0.0f };
+                int components = std::min(N, view.components);
+                switch (view.component_type) {
+                case TINYGLTF_COMPONENT_TYPE_FLOAT: std::memcpy(&value, element, sizeof(f32) * components); break;
+                case TINYGLTF_COMPONENT_TYPE_BYTE:
+                    for (int c = 0; c < components; c++) value[c] = read_component<i8>(element, c, view.normalized, 1.0f / 127.0f);
+                    break;
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                    for (int c = 0; c < components; c++) value[c] = read_component<u8>(element, c, view.normalized, 1.0f / 255.0f);
+                    break;
+                case TINYGLTF_COMPONENT_TYPE_SHORT:
+                    for (int c = 0; c < components; c++) value[c] = read_component<i16>(element, c, view.normalized, 1.0f / 32767.0f);
+                    break;
+                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                    for (int c = 0; c < components; c++) value[c] = read_component<u16>(element, c, view.normalized, 1.0f / 65535.0f);
+                    break;
+                default: throw std::runtime_error("attribute component type " + std::to_string(view.component_type) + " not supported!");
+                }
+                return value;
+            }
+
+            static i32 texture_image(const tinygltf::Model &GltfModel, int textureIndex) {
+                if (textureIndex == -1) {
+                    return -1;
+                }
+                return GltfModel.textures[textureIndex].source;
+            }
+
+            // matrix, or translation * rotation * scale when the node has no matrix
+            static glm::mat4 node_transform(const tinygltf::Node &node) {
+                if (node.matrix.size() == 16) {
+                    glm::dmat4 matrix = glm::make_mat4(node.matrix.data());
+                    return glm::mat4(matrix);
+                }
+                glm::mat4 transform{ 1.0f };
+                if (node.translation.size() == 3) {
+                    transform = glm::translate(transform, glm::vec3(glm::make_vec3(node.translation.data())));
+                }
+                if (node.rotation.size() == 4) {
+                    // glTF stores x, y, z, w
+                    glm::quat rotation{ static_cast<f32>(node.rotation[3]), static_cast<f32>(node.rotation[0]), static_cast<f32>(node.rotation[1]), static_cast<f32>(node.rotation[2]) };
+                    transform *= glm::mat4_cast(rotation);
+                }
+                if (node.scale.size() == 3) {
+                    transform = glm::scale(transform, glm::vec3(glm::make_vec3(node.scale.data())));
+                }
+                return transform;
+            }
+
+            void transform_bounds(const glm::mat4 &transform, glm::vec3 &bounds_min, glm::vec3 &bounds_max) {
+                // Arvo: each output axis takes the smaller and larger product per input axis
+                glm::vec3 result_min = glm::vec3(transform[3]);
+                glm::vec3 result_max = result_min;
+                for (int column = 0; column < 3; column++) {
+                    glm::vec3 a = glm::vec3(transform[column]) * bounds_min[column];
+                    glm::vec3 b = glm::vec3(transform[column]) * bounds_max[column];
+                    result_min += glm::min(a, b);
+                    result_max += glm::max(a, b);
+                }
+                bounds_min = result_min;
+                bounds_max = result_max;
+            }
+
+            void MeshData::update_bounds() {
+                bounds_min = glm::vec3(std::numeric_limits<float>::max());
+                bounds_max = glm::vec3(std::numeric_limits<float>::lowest());
+                for (auto &instance : instances) {
+                    for (u32 p = instance.first_primitive; p < instance.first_primitive + instance.primitive_count; p++) {
+                        glm::vec3 primitive_min = primitives[p].bounds_min;
+                        glm::vec3 primitive_max = primitives[p].bounds_max;
+                        transform_bounds(instance.transform, primitive_min, primitive_max);
+                        bounds_min = glm::min(bounds_min, primitive_min);
+                        bounds_max = glm::max(bounds_max, primitive_max);
+                    }
+                }
+            }
+
+            GltfImporter::GltfImporter(const std::string &filepath) : name{ std::filesystem::path{ filepath }.filename().generic_string() }, model{ std::make_unique<tinygltf::Model>() } {
+                std::string warn, err;
+                tinygltf::TinyGLTF GltfLoader;
+                // nothing is decoded here, embedded images are only captured for the texture loader
+                GltfLoader.SetImageLoader(
+                    [](tinygltf::Image *, const int imageIndex, std::string *, std::string *, int, int, const unsigned char *bytes, int size, void *userData) {
+                        auto &captured = *static_cast<std::vector<std::vector<u8>> *>(userData);
+                        if (captured.size() <= static_cast<usize>(imageIndex)) {
+                            captured.resize(imageIndex + 1);
+                        }
+                        captured[imageIndex].assign(bytes, bytes + size);
+                        return true;
+                    },
+                    &images);
+
+                // external buffers and images resolve through the virtual file system as well, so packed scenes load
+                tinygltf::FsCallbacks fileSystem{};
+                fileSystem.FileExists = [](const std::string &path, void *) { return VirtualFileSystem::shared().exists(path); };
+                fileSystem.ExpandFilePath = &tinygltf::ExpandFilePath;
+                fileSystem.ReadWholeFile = [](std::vector<unsigned char> *out, std::string *error, const std::string &path, void *userData) {
+                    if (!VirtualFileSystem::shared().read(path, *out)) {
+                        if (error) {
+                            *error += "file not found: " + path + "\n";
+                        }
+                        return false;
+                    }
+                    static_cast<std::vector<std::string> *>(userData)->push_back(PackFile::normalize(path));
+                    return true;
+                };
+                fileSystem.WriteWholeFile = &tinygltf::WriteWholeFile;
+                fileSystem.GetFileSizeInBytes = [](size_t *size, std::string *error, const std::string &path, void *) {
+                    if (!VirtualFileSystem::shared().exists(path)) {
+                        if (error) {
+                            *error += "file not found: " + path + "\n";
+                        }
+                        return false;
+                    }
+                    *size = VirtualFileSystem::shared().open(path).size();
+                    return true;
+                };
+                fileSystem.user_data = &external_files;
+                GltfLoader.SetFsCallbacks(fileSystem);
+
+                // one view of the whole file, a .glb carries its buffers and images in the same file
+                FileView file = VirtualFileSystem::shared().open(filepath);
+                std::string baseDir = std::filesystem::path{ filepath }.parent_path().string();
+                bool binary = file.size() >= 4 && std::memcmp(file.data(), "glTF", 4) == 0;
+                bool loaded = binary ? GltfLoader.LoadBinaryFromMemory(model.get(), &err, &warn, file.data(), static_cast<unsigned int>(file.size()), baseDir)
+                                     : GltfLoader.LoadASCIIFromString(model.get(), &err, &warn, reinterpret_cast<const char *>(file.data()), static_cast<unsigned int>(file.size()), baseDir);
+                if (!loaded) {
+                    throw std::runtime_error("failed to load gltf file " + filepath + ": " + err);
+                }
+
+                // only images without a file of their own are embedded
+                images.resize(model->images.size());
+                for (usize i = 0; i < model->images.size(); i++) {
+                    const std::string &uri = model->images[i].uri;
+                    if (!uri.empty() && uri.rfind("data:", 0) != 0) {
+                        images[i].clear();
+                    }
+                }
+
+                // every mesh is imported once however many nodes place it, presized from the accessor counts
+                std::vector<i32> meshFirstPrimitive(model->meshes.size(), -1);
+                std::vector<u32> meshPrimitiveCount(model->meshes.size(), 0);
+                auto addMesh = [&](int meshIndex) {
+                    if (meshFirstPrimitive[meshIndex] != -1) {
+                        return;
+                    }
+                    meshFirstPrimitive[meshIndex] = static_cast<i32>(sources.size());
+                    for (auto &GltfPrimitive : model->meshes[meshIndex].primitives) {
+                        int position = find_attribute(GltfPrimitive, "POSITION");
+                        if (position == -1) {
+                            continue;
+                        }
+
+                        PrimitiveSource source{};
+                        source.primitive = &GltfPrimitive;
+                        source.first_vertex = total_vertices;
+                        source.first_index = total_indices;
+                        source.vertex_count = static_cast<u32>(model->accessors[position].count);
+                        source.index_count = GltfPrimitive.indices != -1 ? static_cast<u32>(model->accessors[GltfPrimitive.indices].count) : source.vertex_count;
+                        total_vertices += source.vertex_count;
+                        total_indices += source.index_count;
+                        sources.push_back(source);
+                        meshPrimitiveCount[meshIndex]++;
+                    }
+                };
+
+                // depth first, the depth limit stops malformed files with cycles
+                auto visit = [&](auto &self, int nodeIndex, const glm::mat4 &parent, usize depth) -> void {
+                    if (nodeIndex < 0 || static_cast<usize>(nodeIndex) >= model->nodes.size() || depth > model->nodes.size()) {
+                        throw std::runtime_error("invalid node hierarchy in " + filepath);
+                    }
+                    const tinygltf::Node &node = model->nodes[nodeIndex];
+                    glm::mat4 transform = parent * node_transform(node);
+                    if (node.mesh != -1) {
+                        addMesh(node.mesh);
+                        if (meshPrimitiveCount[node.mesh] > 0) {
+                            instances.push_back(MeshInstanceData{
+                                .transform = transform,
+                                .first_primitive = static_cast<u32>(meshFirstPrimitive[node.mesh]),
+                                .primitive_count = meshPrimitiveCount[node.mesh],
+                            });
+                        }
+                    }
+                    for (int child : node.children) {
+                        self(self, child, transform, depth + 1);
+                    }
+                };
+
+                // the default scene, files without scenes show every root node
+                std::vector<int> roots;
+                if (!model->scenes.empty()) {
+                    roots = model->scenes[model->defaultScene >= 0 ? model->defaultScene : 0].nodes;
+                } else {
+                    std::vector<bool> isChild(model->nodes.size(), false);
+                    for (auto &node : model->nodes) {
+                        for (int child : node.children) {
+                            if (child >= 0 && static_cast<usize>(child) < isChild.size()) {
+                                isChild[child] = true;
+                            }
+                        }
+                    }
+                    for (usize i = 0; i < model->nodes.size(); i++) {
+                        if (!isChild[i]) {
+                            roots.push_back(static_cast<int>(i));
+                        }
+                    }
+                }
+                for (int root : roots) {
+                    visit(visit, root, glm::mat4{ 1.0f }, 0);
+                }
+            }
+
+            GltfImporter::~GltfImporter() {}
+
+            void GltfImporter::read_layout(MeshData &mesh) {
+                mesh.image_uris.resize(model->images.size());
+                mesh.embedded_images.resize(model->images.size());
+                for (usize i = 0; i < model->images.size(); i++) {
+                    if (images[i].empty()) {
+                        mesh.image_uris[i] = model->images[i].uri;
+                    } else {
+                        mesh.image_uris[i] = name + "#" + std::to_string(i);
+                        mesh.embedded_images[i] = std::move(images[i]);
+                    }
+                }
+
+                mesh.materials.reserve(model->materials.size());
+                for (auto &GltfMaterial : model->materials) {
+                    mesh.materials.push_back(MeshMaterialData{
+                        .albedo_image = texture_image(*model, GltfMaterial.pbrMetallicRoughness.baseColorTexture.index),
+                        .normal_image = texture_image(*model, GltfMaterial.normalTexture.index),
+                        .metallic_roughness_image = texture_image(*model, GltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index),
+                        .double_sided = GltfMaterial.doubleSided ? 1u : 0u,
+                    });
+                }
+
+                mesh.primitives.reserve(sources.size());
+                for (auto &source : sources) {
+                    MeshPrimitiveData primitive{};
+                    primitive.first_vertex = source.first_vertex;
+                    primitive.first_index = source.first_index;
+                    primitive.vertex_count = source.vertex_count;
+                    primitive.index_count = source.index_count;
+                    primitive.material = source.primitive->material;
+
+                    // min and max are required on float positions, anything else is scanned
+                    int position = find_attribute(*source.primitive, "POSITION");
+                    const tinygltf::Accessor &accessor = model->accessors[position];
+                    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && accessor.minValues.size() == 3 && accessor.maxValues.size() == 3) {
+                        primitive.bounds_min = glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]);
+                        primitive.bounds_max = glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]);
+                    } else {
+                        AccessorView positions = view_accessor(*model, position);
+                        primitive.bounds_min = glm::vec3(std::numeric_limits<float>::max());
+                        primitive.bounds_max = glm::vec3(std::numeric_limits<float>::lowest());
+                        for (u32 v = 0; v < positions.count; v++) {
+                            glm::vec3 p = read_element<3>(positions, v);
+                            primitive.bounds_min = glm::min(primitive.bounds_min, p);
+                            primitive.bounds_max = glm::max(primitive.bounds_max, p);
+                        }
+                    }
+
+                    mesh.primitives.push_back(primitive);
+                }
+
+                mesh.instances = instances;
+                mesh.update_bounds();
+            }
+
+            void GltfImporter::read_vertices(Model::Vertex *vertices) const {
+                for (auto &source : sources) {
+                    AccessorView positions = view_accessor(*model, find_attribute(*source.primitive, "POSITION"));
+                    int normalIndex = find_attribute(*source.primitive, "NORMAL");
+                    int tangentIndex = find_attribute(*source.primitive, "TANGENT");
+                    int uvIndex = find_attribute(*source.primitive, "TEXCOORD_0");
+                    AccessorView normals = normalIndex != -1 ? view_accessor(*model, normalIndex) : AccessorView{};
+                    AccessorView tangents = tangentIndex != -1 ? view_accessor(*model, tangentIndex) : AccessorView{};
+                    AccessorView uvs = uvIndex != -1 ? view_accessor(*model, uvIndex) : AccessorView{};
+
+                    // whole vertices are assembled and stored in order, the destination may be write combined
+                    Model::Vertex *dst = vertices + source.first_vertex;
+                    for (u32 v = 0; v < source.vertex_count; v++) {
+                        Model::Vertex vertex{};
+                        vertex.position = read_element<3>(positions, v);
+                        vertex.color = glm::vec3(1.0);
+                        vertex.normal = normals.data ? glm::normalize(read_element<3>(normals, v)) : glm::vec3(0.0f);
+                        vertex.tangent = tangents.data ? read_element<4>(tangents, v) : glm::vec4(0.0f);
+                        vertex.uv = uvs.data ? read_element<2>(uvs, v) : glm::vec2(0.0f);
+                        dst[v] = vertex;
+                    }
+                }
+            }
+
+            void GltfImporter::read_indices(u32 *indices) const {
+                for (auto &source : sources) {
+                    u32 *dst = indices + source.first_index;
+                    if (source.primitive->indices == -1) {
+                        std::iota(dst, dst + source.index_count, 0u);
+                        continue;
+                    }
+
+                    AccessorView view = view_accessor(*model, source.primitive->indices);
+                    switch (view.component_type) {
+                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+                        if (view.stride == sizeof(u32)) {
+                            std::memcpy(dst, view.data, sizeof(u32) * view.count);
+                            break;
+                        }
+                        for (u32 i = 0; i < view.count; i++) {
+                            std::memcpy(&dst[i], view.data + i * view.stride, sizeof(u32));
+                        }
+                        break;
+                    }
+                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+                        for (u32 i = 0; i < view.count; i++) {
+                            u16 index;
+                            std::memcpy(&index, view.data + i * view.stride, sizeof(u16));
+                            dst[i] = index;
+                        }
+                        break;
+                    }
+                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+                        for (u32 i = 0; i < view.count; i++) {
+                            dst[i] = view.data[i * view.stride];
+                        }
+                        break;
+                    }
+                    default: throw std::runtime_error("index component type " + std::to_string(view.component_type) + " not supported!");
+                    }
+                }
+            }
+
+            u64 GltfImporter::hash_sources(const std::string &filepath, std::vector<std::string> *dependencies) {
+                FileView file = VirtualFileSystem::shared().open(filepath);
+                HashBuilder hash{};
+                hash.add(file.data(), file.size());
+
+                // only the json is parsed, a .glb keeps it in the first chunk
+                const char *json_begin = reinterpret_cast<const char *>(file.data());
+                const char *json_end = json_begin + file.size();
+                if (file.size() >= 20 && std::memcmp(file.data(), "glTF", 4) == 0) {
+                    u32 chunk_length = 0;
+                    std::memcpy(&chunk_length, file.data() + 12, sizeof(chunk_length));
+                    json_begin += 20;
+                    json_end = json_begin + std::min<usize>(chunk_length, file.size() - 20);
+                }
+
+                // external buffers are part of the source, external images are cached on their own
+                nlohmann::json json = nlohmann::json::parse(json_begin, json_end, nullptr, false);
+                if (json.is_discarded() || !json.contains("buffers") || !json["buffers"].is_array()) {
+                    return hash.get();
+                }
+                for (auto &buffer : json["buffers"]) {
+                    if (!buffer.contains("uri") || !buffer["uri"].is_string()) {
+                        continue;
+                    }
+                    std::string uri = buffer["uri"].get<std::string>();
+                    if (uri.rfind("data:", 0) == 0) {
+                        continue;
+                    }
+                    hash.add(uri);
+                    std::string dependencyPath = std::filesystem::path{ filepath }.parent_path().append(uri).string();
+                    if (dependencies) {
+                        dependencies->push_back(PackFile::normalize(dependencyPath));
+                    }
+                    try {
+                        FileView dependency = VirtualFileSystem::shared().open(dependencyPath);
+                        hash.add(dependency.data(), dependency.size());
+                    } catch (const std::exception &) {
+                        // the import reports the missing buffer
+                    }
+                }
+                return hash.get();
+            }
+
+            MeshData MeshData::import_gltf(const std::string &filepath) {
+                GltfImporter importer{ filepath };
+
+                MeshData mesh{};
+                importer.read_layout(mesh);
+                mesh.vertices.resize(importer.vertex_count());
+                mesh.indices.resize(importer.index_count());
+                importer.read_vertices(mesh.vertices.data());
+                importer.read_indices(mesh.indices.data());
+                return mesh;
+            }
+        }
+    }
+}
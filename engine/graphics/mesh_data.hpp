@@ -0,0 +1,146 @@
+#pragma once
+
+#include "model.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tinygltf {
+    class Model;
+    struct Primitive;
+}
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            // image indices refer to MeshData::image_uris, -1 means the default texture is used
+            struct MeshMaterialData {
+                i32 albedo_image = -1;
+                i32 normal_image = -1;
+                i32 metallic_roughness_image = -1;
+                u32 double_sided = 0; // back faces are visible, meshlets of these materials are never cone culled
+            };
+
+            // simplified index range over the primitive's vertices
+            struct MeshLodData {
+                u32 first_index = 0;
+                u32 index_count = 0;
+                f32 error = 0.0f; // model space distance from the full detail surface
+            };
+
+            struct MeshPrimitiveData {
+                u32 first_index = 0;
+                u32 first_vertex = 0;
+                u32 index_count = 0;
+                u32 vertex_count = 0;
+                i32 material = -1;
+                glm::vec3 bounds_min{};
+                glm::vec3 bounds_max{};
+                u32 lod_count = 1; // including the full detail range above
+                MeshLodData lods[MAX_MESH_LODS - 1] = {}; // lod 1 and up
+                u32 first_meshlet = 0;
+                u32 meshlet_count = 0; // clusters of the full detail range, see build_meshlets
+            };
+
+            // contiguous slice of a primitive's full detail indices with culling bounds in model space
+            struct MeshMeshletData {
+                u32 first_index = 0;
+                u32 index_count = 0;
+                glm::vec3 center{};
+                f32 radius = 0.0f;
+                glm::vec3 cone_axis{};
+                f32 cone_cutoff = 1.0f; // sine of the normal cone's half angle, 1 never culls
+            };
+
+            // placement of a glTF mesh, a contiguous range of primitives, by a node of the scene hierarchy
+            struct MeshInstanceData {
+                glm::mat4 transform{ 1.0f }; // node to model space, flattened over all parents
+                u32 first_primitive = 0;
+                u32 primitive_count = 0;
+            };
+
+            /**
+             * @brief CPU side geometry and material description of a model, already in the engine's vertex layout.
+             * Indices are relative to the primitive's first vertex. Every glTF mesh is stored once, nodes that
+             * reference it become instances of its primitives.
+             */
+            struct MeshData {
+                std::vector<Model::Vertex> vertices = {};
+                std::vector<u32> indices = {};
+                std::vector<MeshPrimitiveData> primitives = {};
+                std::vector<MeshMaterialData> materials = {};
+                std::vector<MeshMeshletData> meshlets = {};
+                std::vector<MeshInstanceData> instances = {};
+                std::vector<std::string> image_uris = {}; // relative to the directory of the source file
+                // encoded bytes of images embedded in a .glb or data uri, indexed like image_uris and empty for
+                // external images. The uri of an embedded image only names it, e.g. "model.glb#2"
+                std::vector<std::vector<u8>> embedded_images = {};
+                glm::vec3 bounds_min{}; // over all instances
+                glm::vec3 bounds_max{};
+
+                // bounds of all instances from the primitive bounds, call after changing either
+                void update_bounds();
+
+                // .gltf or .glb, see GltfImporter
+                static MeshData import_gltf(const std::string &filepath);
+            };
+
+            // axis aligned box around the transformed corners of min/max
+            void transform_bounds(const glm::mat4 &transform, glm::vec3 &bounds_min, glm::vec3 &bounds_max);
+
+            /**
+             * @brief Parsed .gltf or .glb whose accessors are read in place. read_layout fills everything but the
+             * vertices and indices, which are then written straight into caller provided memory sized from
+             * vertex_count and index_count, e.g. presized vectors or mapped staging memory.
+             */
+            class GltfImporter {
+            public:
+                GltfImporter(const std::string &filepath);
+                ~GltfImporter();
+
+                /**
+                 * @brief Content hash of the file and the buffers it references, without a full parse.
+                 * The paths of those buffers are appended to dependencies when given.
+                 */
+                static u64 hash_sources(const std::string &filepath, std::vector<std::string> *dependencies = nullptr);
+
+                GltfImporter(const GltfImporter &) = delete;
+                GltfImporter &operator=(const GltfImporter &) = delete;
+
+                u32 vertex_count() const { return total_vertices; }
+                u32 index_count() const { return total_indices; }
+
+                // primitives, instances, materials, images and bounds, embedded images are moved out so call it once
+                void read_layout(MeshData &mesh);
+                void read_vertices(Model::Vertex *vertices) const;
+                void read_indices(u32 *indices) const;
+
+                // external buffers read by the parse, normalized like VirtualFileSystem paths
+                const std::vector<std::string> &dependencies() const { return external_files; }
+
+            private:
+                struct PrimitiveSource {
+                    const tinygltf::Primitive *primitive;
+                    u32 first_vertex;
+                    u32 first_index;
+                    u32 vertex_count;
+                    u32 index_count;
+                };
+
+                std::string name;
+                std::unique_ptr<tinygltf::Model> model;
+                std::vector<std::vector<u8>> images = {};
+                std::vector<std::string> external_files = {};
+                std::vector<PrimitiveSource> sources = {};
+                std::vector<MeshInstanceData> instances = {};
+                u32 total_vertices = 0;
+                u32 total_indices = 0;
+            };
+        }
+    }
+}
@@ -0,0 +1,380 @@
+#include "mesh_optimizer.hpp"
+
+#include "utils.hpp"
+
+// libs
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace std {
+    template <>
+    struct hash<VGED::Engine::Graphics::Model::Vertex> {
+        size_t operator()(VGED::Engine::Graphics::Model::Vertex const &vertex) const {
+            size_t seed = 0;
+            VGED::Engine::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.tangent, vertex.uv);
+            return seed;
+        }
+    };
+}
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            static constexpr u32 INVALID_INDEX = std::numeric_limits<u32>::max();
+
+            static u32 count_cache_misses(const u32 *indices, usize index_count, u32 vertex_count, u32 cache_size) {
+                // a vertex is in the FIFO if fewer than cache_size misses happened since it was last inserted
+                std::vector<u32> timestamps(vertex_count, 0);
+                u32 time = cache_size + 1;
+                u32 misses = 0;
+                for (usize i = 0; i < index_count; i++) {
+                    u32 index = indices[i];
+                    if (time - timestamps[index] > cache_size) {
+                        timestamps[index] = time++;
+                        misses++;
+                    }
+                }
+                return misses;
+            }
+
+            VertexCacheStats analyze_vertex_cache(const MeshData &mesh, u32 cache_size) {
+                u64 misses = 0;
+                u64 triangles = 0;
+                u64 vertices = 0;
+                for (auto &primitive : mesh.primitives) {
+                    misses += count_cache_misses(&mesh.indices[primitive.first_index], primitive.index_count, primitive.vertex_count, cache_size);
+                    triangles += primitive.index_count / 3;
+                    vertices += primitive.vertex_count;
+                }
+
+                VertexCacheStats stats{};
+                stats.acmr = triangles ? static_cast<f32>(misses) / static_cast<f32>(triangles) : 0.0f;
+                stats.atvr = vertices ? static_cast<f32>(misses) / static_cast<f32>(vertices) : 0.0f;
+                return stats;
+            }
+
+            static void weld_vertices(std::vector<Model::Vertex> &vertices, std::vector<u32> &indices) {
+                std::unordered_map<Model::Vertex, u32> unique;
+                unique.reserve(vertices.size());
+                std::vector<Model::Vertex> welded;
+                welded.reserve(vertices.size());
+
+                std::vector<u32> remap(vertices.size());
+                for (usize v = 0; v < vertices.size(); v++) {
+                    auto [it, inserted] = unique.try_emplace(vertices[v], static_cast<u32>(welded.size()));
+                    if (inserted) {
+                        welded.push_back(vertices[v]);
+                    }
+                    remap[v] = it->second;
+                }
+                for (auto &index : indices) {
+                    index = remap[index];
+                }
+                vertices = std::move(welded);
+            }
+
+            // Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+            static constexpr u32 FORSYTH_CACHE_SIZE = 32;
+
+            static f32 forsyth_vertex_score(i32 cache_position, u32 remaining_triangles) {
+                if (remaining_triangles == 0) {
+                    return -1.0f;
+                }
+
+                f32 score = 0.0f;
+                if (cache_position >= 0) {
+                    if (cache_position < 3) {
+                        // the last triangle's vertices are penalized so strips don't run back on themselves
+                        score = 0.75f;
+                    } else {
+                        f32 scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                        score = std::pow(1.0f - static_cast<f32>(cache_position - 3) * scale, 1.5f);
+                    }
+                }
+                // boost vertices with few triangles left so they get finished instead of leaving stragglers
+                score += 2.0f * std::pow(static_cast<f32>(remaining_triangles), -0.5f);
+                return score;
+            }
+
+            std::vector<u32> optimize_vertex_cache(const std::vector<u32> &indices, u32 vertex_count) {
+                usize triangle_count = indices.size() / 3;
+
+                std::vector<u32> remaining(vertex_count, 0);
+                for (u32 index : indices) {
+                    remaining[index]++;
+                }
+
+                // live triangles per vertex, shrunk from the back as triangles are emitted
+                std::vector<u32> offsets(vertex_count + 1, 0);
+                for (u32 v = 0; v < vertex_count; v++) {
+                    offsets[v + 1] = offsets[v] + remaining[v];
+                }
+                std::vector<u32> adjacency(indices.size());
+                {
+                    std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+                    for (usize i = 0; i < indices.size(); i++) {
+                        adjacency[fill[indices[i]]++] = static_cast<u32>(i / 3);
+                    }
+                }
+
+                std::vector<i32> cache_position(vertex_count, -1);
+                std::vector<f32> vertex_score(vertex_count);
+                for (u32 v = 0; v < vertex_count; v++) {
+                    vertex_score[v] = forsyth_vertex_score(-1, remaining[v]);
+                }
+
+                std::vector<f32> triangle_score(triangle_count);
+                u32 best = INVALID_INDEX;
+                for (usize t = 0; t < triangle_count; t++) {
+                    triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+                    if (best == INVALID_INDEX || triangle_score[t] > triangle_score[best]) {
+                        best = static_cast<u32>(t);
+                    }
+                }
+
+                std::vector<bool> emitted(triangle_count, false);
+                std::vector<u32> cache;
+                std::vector<u32> next_cache;
+                cache.reserve(FORSYTH_CACHE_SIZE + 3);
+                next_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+                std::vector<u32> result;
+                result.reserve(triangle_count * 3);
+                usize cursor = 0;
+
+                while (result.size() < triangle_count * 3) {
+                    if (best == INVALID_INDEX) {
+                        // nothing in the cache has triangles left, restart from the next unvisited triangle
+                        while (emitted[cursor]) {
+                            cursor++;
+                        }
+                        best = static_cast<u32>(cursor);
+                    }
+
+                    emitted[best] = true;
+                    next_cache.clear();
+                    for (u32 k = 0; k < 3; k++) {
+                        u32 v = indices[best * 3 + k];
+                        result.push_back(v);
+
+                        u32 begin = offsets[v];
+                        u32 end = begin + remaining[v];
+                        auto it = std::find(adjacency.begin() + begin, adjacency.begin() + end, best);
+                        std::iter_swap(it, adjacency.begin() + end - 1);
+                        remaining[v]--;
+
+                        if (std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end()) {
+                            next_cache.push_back(v);
+                        }
+                    }
+                    for (u32 v : cache) {
+                        if (std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end()) {
+                            next_cache.push_back(v);
+                        }
+                    }
+
+                    // rescore everything whose cache position changed, including vertices that fell out
+                    for (usize i = 0; i < next_cache.size(); i++) {
+                        u32 v = next_cache[i];
+                        cache_position[v] = i < FORSYTH_CACHE_SIZE ? static_cast<i32>(i) : -1;
+
+                        f32 score = forsyth_vertex_score(cache_position[v], remaining[v]);
+                        f32 delta = score - vertex_score[v];
+                        vertex_score[v] = score;
+                        for (u32 a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+                            triangle_score[adjacency[a]] += delta;
+                        }
+                    }
+                    if (next_cache.size() > FORSYTH_CACHE_SIZE) {
+                        next_cache.resize(FORSYTH_CACHE_SIZE);
+                    }
+                    std::swap(cache, next_cache);
+
+                    best = INVALID_INDEX;
+                    for (u32 v : cache) {
+                        for (u32 a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+                            u32 t = adjacency[a];
+                            if (best == INVALID_INDEX || triangle_score[t] > triangle_score[best]) {
+                                best = t;
+                            }
+                        }
+                    }
+                }
+                return result;
+            }
+
+            // Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+            static std::vector<u32> optimize_overdraw(const std::vector<u32> &indices, const std::vector<Model::Vertex> &vertices, u32 cache_size, f32 threshold) {
+                usize triangle_count = indices.size() / 3;
+                if (triangle_count == 0) {
+                    return indices;
+                }
+
+                // hard boundaries: triangles where the cache is effectively flushed
+                std::vector<usize> clusters;
+                {
+                    std::vector<u32> timestamps(vertices.size(), 0);
+                    u32 time = cache_size + 1;
+                    for (usize t = 0; t < triangle_count; t++) {
+                        u32 misses = 0;
+                        for (u32 k = 0; k < 3; k++) {
+                            u32 index = indices[t * 3 + k];
+                            if (time - timestamps[index] > cache_size) {
+                                timestamps[index] = time++;
+                                misses++;
+                            }
+                        }
+                        if (t == 0 || misses == 3) {
+                            clusters.push_back(t);
+                        }
+                    }
+                }
+
+                // soft boundaries: split hard clusters wherever the running ACMR is within threshold of the cluster's
+                // hard clusters are short and many, so they share one timestamp buffer and start cold by advancing time past the cache
+                std::vector<usize> boundaries;
+                std::vector<u32> timestamps(vertices.size(), 0);
+                u32 time = 0;
+                for (usize c = 0; c < clusters.size(); c++) {
+                    usize begin = clusters[c];
+                    usize end = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+
+                    time += cache_size + 1;
+                    u32 cluster_misses = 0;
+                    for (usize i = begin * 3; i < end * 3; i++) {
+                        if (time - timestamps[indices[i]] > cache_size) {
+                            timestamps[indices[i]] = time++;
+                            cluster_misses++;
+                        }
+                    }
+                    f32 cluster_acmr = static_cast<f32>(cluster_misses) / static_cast<f32>(end - begin);
+
+                    time += cache_size + 1;
+                    u32 misses = 0;
+                    usize start = begin;
+                    boundaries.push_back(begin);
+                    for (usize t = begin; t < end; t++) {
+                        for (u32 k = 0; k < 3; k++) {
+                            u32 index = indices[t * 3 + k];
+                            if (time - timestamps[index] > cache_size) {
+                                timestamps[index] = time++;
+                                misses++;
+                            }
+                        }
+                        usize count = t + 1 - start;
+                        if (t + 1 < end && static_cast<f32>(misses) / static_cast<f32>(count) <= cluster_acmr * threshold) {
+                            boundaries.push_back(t + 1);
+                            start = t + 1;
+                            misses = 0;
+                            time += cache_size + 1; // the next cluster starts cold
+                        }
+                    }
+                }
+
+                glm::vec3 mesh_centroid{ 0.0f };
+                for (auto &vertex : vertices) {
+                    mesh_centroid += vertex.position;
+                }
+                mesh_centroid /= static_cast<f32>(vertices.size());
+
+                // clusters facing away from the mesh center are drawn first, they are the most likely occluders
+                struct Cluster {
+                    usize begin;
+                    usize end;
+                    f32 sort_key;
+                };
+                std::vector<Cluster> sorted;
+                sorted.reserve(boundaries.size());
+                for (usize b = 0; b < boundaries.size(); b++) {
+                    usize begin = boundaries[b];
+                    usize end = b + 1 < boundaries.size() ? boundaries[b + 1] : triangle_count;
+
+                    glm::vec3 centroid{ 0.0f };
+                    glm::vec3 normal{ 0.0f };
+                    f32 area = 0.0f;
+                    for (usize t = begin; t < end; t++) {
+                        const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+                        const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+                        const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+                        glm::vec3 weighted_normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+                        f32 weight = glm::length(weighted_normal);
+                        centroid += (p0 + p1 + p2) * (weight / 3.0f);
+                        normal += weighted_normal;
+                        area += weight;
+                    }
+                    centroid = area > 0.0f ? centroid / area : centroid;
+                    f32 normal_length = glm::length(normal);
+                    normal = normal_length > 0.0f ? normal / normal_length : normal;
+                    sorted.push_back({ begin, end, glm::dot(centroid - mesh_centroid, normal) });
+                }
+                std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) { return a.sort_key > b.sort_key; });
+
+                std::vector<u32> result;
+                result.reserve(indices.size());
+                for (auto &cluster : sorted) {
+                    result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+                }
+                return result;
+            }
+
+            static void optimize_vertex_fetch(std::vector<Model::Vertex> &vertices, std::vector<u32> &indices) {
+                std::vector<u32> remap(vertices.size(), INVALID_INDEX);
+                std::vector<Model::Vertex> ordered;
+                ordered.reserve(vertices.size());
+                for (auto &index : indices) {
+                    if (remap[index] == INVALID_INDEX) {
+                        remap[index] = static_cast<u32>(ordered.size());
+                        ordered.push_back(vertices[index]);
+                    }
+                    index = remap[index];
+                }
+                vertices = std::move(ordered);
+            }
+
+            void optimize_mesh(MeshData &mesh, const MeshOptimizeInfo &info) {
+                std::vector<Model::Vertex> vertices;
+                std::vector<u32> indices;
+                vertices.reserve(mesh.vertices.size());
+                indices.reserve(mesh.indices.size());
+
+                for (auto &primitive : mesh.primitives) {
+                    std::vector<Model::Vertex> local_vertices(mesh.vertices.begin() + primitive.first_vertex, mesh.vertices.begin() + primitive.first_vertex + primitive.vertex_count);
+                    std::vector<u32> local_indices(mesh.indices.begin() + primitive.first_index, mesh.indices.begin() + primitive.first_index + primitive.index_count);
+
+                    if (info.weld_vertices) {
+                        weld_vertices(local_vertices, local_indices);
+                    }
+                    if (info.optimize_vertex_cache) {
+                        local_indices = optimize_vertex_cache(local_indices, static_cast<u32>(local_vertices.size()));
+                    }
+                    if (info.optimize_overdraw) {
+                        local_indices = optimize_overdraw(local_indices, local_vertices, info.cache_size, info.overdraw_threshold);
+                    }
+                    if (info.optimize_vertex_fetch) {
+                        optimize_vertex_fetch(local_vertices, local_indices);
+                    }
+
+                    primitive.first_vertex = static_cast<u32>(vertices.size());
+                    primitive.first_index = static_cast<u32>(indices.size());
+                    primitive.vertex_count = static_cast<u32>(local_vertices.size());
+                    primitive.index_count = static_cast<u32>(local_indices.size());
+                    primitive.lod_count = 1;
+                    primitive.meshlet_count = 0;
+                    vertices.insert(vertices.end(), local_vertices.begin(), local_vertices.end());
+                    indices.insert(indices.end(), local_indices.begin(), local_indices.end());
+                }
+
+                mesh.vertices = std::move(vertices);
+                mesh.indices = std::move(indices);
+                mesh.meshlets.clear();
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "mesh_data.hpp"
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            struct MeshOptimizeInfo {
+                bool weld_vertices = true;        // merge bitwise equal vertices within a primitive
+                bool optimize_vertex_cache = true; // Forsyth ordering for post-transform cache hits
+                bool optimize_overdraw = true;     // reorder cache friendly clusters front to back from the outside
+                bool optimize_vertex_fetch = true; // store vertices in the order they are first referenced
+                u32 cache_size = 16;
+                f32 overdraw_threshold = 1.05f; // how much ACMR the overdraw pass may trade for better ordering
+            };
+
+            struct VertexCacheStats {
+                f32 acmr = 0.0f; // transformed vertices per triangle, 0.5 is optimal for a regular grid, 3 is worst
+                f32 atvr = 0.0f; // transformed vertices per vertex, 1 is optimal
+            };
+
+            /**
+             * @brief Simulate a FIFO post-transform cache over every primitive of mesh.
+             */
+            VertexCacheStats analyze_vertex_cache(const MeshData &mesh, u32 cache_size = 16);
+
+            /**
+             * @brief Run the enabled passes on every primitive of mesh in place. Primitive ranges and vertex
+             * counts are updated; the geometry drawn stays the same. LODs and meshlets are dropped, build them afterwards.
+             */
+            void optimize_mesh(MeshData &mesh, const MeshOptimizeInfo &info = {});
+
+            /**
+             * @brief Forsyth triangle order for a single index list referencing vertex_count vertices.
+             */
+            std::vector<u32> optimize_vertex_cache(const std::vector<u32> &indices, u32 vertex_count);
+        }
+    }
+}
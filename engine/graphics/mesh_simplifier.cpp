@@ -0,0 +1,306 @@
+#include "mesh_simplifier.hpp"
+
+#include "mesh_optimizer.hpp"
+
+// libs
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            // symmetric 4x4 matrix of summed squared plane distances, w is the summed weight
+            struct Quadric {
+                f64 a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+                f64 a11 = 0, a12 = 0, a13 = 0;
+                f64 a22 = 0, a23 = 0;
+                f64 a33 = 0;
+                f64 w = 0;
+
+                static Quadric plane(const glm::vec3 &normal, f32 distance, f64 weight) {
+                    f64 a = normal.x, b = normal.y, c = normal.z, d = distance;
+                    return Quadric{ a * a * weight, a * b * weight, a * c * weight, a * d * weight, b * b * weight, b * c * weight, b * d * weight, c * c * weight, c * d * weight, d * d * weight, weight };
+                }
+
+                Quadric &operator+=(const Quadric &q) {
+                    a00 += q.a00, a01 += q.a01, a02 += q.a02, a03 += q.a03;
+                    a11 += q.a11, a12 += q.a12, a13 += q.a13;
+                    a22 += q.a22, a23 += q.a23;
+                    a33 += q.a33;
+                    w += q.w;
+                    return *this;
+                }
+
+                // mean squared distance of p to the accumulated planes
+                f64 error(const glm::vec3 &p) const {
+                    f64 x = p.x, y = p.y, z = p.z;
+                    f64 e = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y + a22 * z * z + 2 * a23 * z + a33;
+                    return w > 0 ? std::abs(e) / w : 0.0;
+                }
+            };
+
+            enum class VertexKind : u8 {
+                MANIFOLD, // may collapse onto any neighbour
+                BORDER,   // may only collapse along an open border edge
+                LOCKED,   // attribute seam, never removed
+            };
+
+            static constexpr f64 BORDER_WEIGHT = 10.0;
+
+            static u64 edge_key(u32 a, u32 b) { return a < b ? (u64(a) << 32) | b : (u64(b) << 32) | a; }
+
+            std::vector<u32> simplify_mesh(const std::vector<u32> &indices, const std::vector<Model::Vertex> &vertices, usize target_index_count, f32 max_error, f32 *result_error) {
+                std::vector<u32> result = indices;
+                f64 worst_error = 0.0;
+                u32 vertex_count = static_cast<u32>(vertices.size());
+
+                // vertices sharing a position with different attributes form a seam
+                std::unordered_map<glm::vec3, u32> first_at_position;
+                std::vector<u32> position_id(vertex_count);
+                std::vector<u32> position_users;
+                for (u32 v = 0; v < vertex_count; v++) {
+                    auto [it, inserted] = first_at_position.try_emplace(vertices[v].position, static_cast<u32>(position_users.size()));
+                    if (inserted) {
+                        position_users.push_back(0);
+                    }
+                    position_id[v] = it->second;
+                    position_users[it->second]++;
+                }
+
+                // borders are found on positions so seams don't read as holes
+                std::unordered_map<u64, u32> edge_use;
+                for (usize t = 0; t + 2 < result.size(); t += 3) {
+                    for (u32 k = 0; k < 3; k++) {
+                        edge_use[edge_key(position_id[result[t + k]], position_id[result[t + (k + 1) % 3]])]++;
+                    }
+                }
+                auto is_border = [&](u32 a, u32 b) {
+                    auto it = edge_use.find(edge_key(position_id[a], position_id[b]));
+                    return it != edge_use.end() && it->second == 1;
+                };
+
+                std::vector<VertexKind> kind(vertex_count, VertexKind::MANIFOLD);
+                std::vector<Quadric> quadrics(vertex_count);
+                for (u32 v = 0; v < vertex_count; v++) {
+                    if (position_users[position_id[v]] > 1) {
+                        kind[v] = VertexKind::LOCKED;
+                    }
+                }
+                for (usize t = 0; t + 2 < result.size(); t += 3) {
+                    const glm::vec3 &p0 = vertices[result[t]].position;
+                    const glm::vec3 &p1 = vertices[result[t + 1]].position;
+                    const glm::vec3 &p2 = vertices[result[t + 2]].position;
+                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                    f32 area = glm::length(normal);
+                    if (area <= 0.0f) {
+                        continue;
+                    }
+                    normal /= area;
+
+                    Quadric q = Quadric::plane(normal, -glm::dot(normal, p0), area);
+                    for (u32 k = 0; k < 3; k++) {
+                        quadrics[result[t + k]] += q;
+                    }
+
+                    // keep open borders in place with a plane through the edge, perpendicular to the triangle
+                    for (u32 k = 0; k < 3; k++) {
+                        u32 a = result[t + k];
+                        u32 b = result[t + (k + 1) % 3];
+                        if (!is_border(a, b)) {
+                            continue;
+                        }
+                        glm::vec3 edge = vertices[b].position - vertices[a].position;
+                        f32 length = glm::length(edge);
+                        if (length <= 0.0f) {
+                            continue;
+                        }
+                        glm::vec3 border_normal = glm::normalize(glm::cross(edge, normal));
+                        Quadric border = Quadric::plane(border_normal, -glm::dot(border_normal, vertices[a].position), length * length * BORDER_WEIGHT);
+                        quadrics[a] += border;
+                        quadrics[b] += border;
+                        if (kind[a] == VertexKind::MANIFOLD) {
+                            kind[a] = VertexKind::BORDER;
+                        }
+                        if (kind[b] == VertexKind::MANIFOLD) {
+                            kind[b] = VertexKind::BORDER;
+                        }
+                    }
+                }
+
+                struct Collapse {
+                    u32 from;
+                    u32 to;
+                    f64 error;
+                };
+                std::vector<Collapse> collapses;
+                std::vector<u32> offsets(vertex_count + 1);
+                std::vector<u32> adjacency;
+                std::vector<u32> remap(vertex_count);
+                std::vector<bool> touched(vertex_count);
+                f64 max_error_squared = static_cast<f64>(max_error) * max_error;
+
+                while (result.size() > target_index_count) {
+                    collapses.clear();
+                    for (usize t = 0; t + 2 < result.size(); t += 3) {
+                        for (u32 k = 0; k < 3; k++) {
+                            u32 a = result[t + k];
+                            u32 b = result[t + (k + 1) % 3];
+                            Collapse best{ a, b, std::numeric_limits<f64>::max() };
+                            for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+                                if (kind[from] == VertexKind::LOCKED || (kind[from] == VertexKind::BORDER && !is_border(from, to))) {
+                                    continue;
+                                }
+                                Quadric q = quadrics[from];
+                                q += quadrics[to];
+                                f64 error = q.error(vertices[to].position);
+                                if (error < best.error) {
+                                    best = { from, to, error };
+                                }
+                            }
+                            if (best.error <= max_error_squared) {
+                                collapses.push_back(best);
+                            }
+                        }
+                    }
+                    if (collapses.empty()) {
+                        break;
+                    }
+                    std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.error < y.error; });
+
+                    std::fill(offsets.begin(), offsets.end(), 0);
+                    for (u32 index : result) {
+                        offsets[index + 1]++;
+                    }
+                    for (u32 v = 0; v < vertex_count; v++) {
+                        offsets[v + 1] += offsets[v];
+                    }
+                    adjacency.resize(result.size());
+                    {
+                        std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+                        for (usize i = 0; i < result.size(); i++) {
+                            adjacency[fill[result[i]]++] = static_cast<u32>(i / 3);
+                        }
+                    }
+
+                    for (u32 v = 0; v < vertex_count; v++) {
+                        remap[v] = v;
+                    }
+                    std::fill(touched.begin(), touched.end(), false);
+
+                    // each collapse removes about two triangles, don't overshoot the target within a pass
+                    usize triangles_to_remove = (result.size() - target_index_count) / 3;
+                    usize collapse_budget = std::max<usize>(1, (triangles_to_remove + 1) / 2);
+                    usize collapsed = 0;
+
+                    for (auto &collapse : collapses) {
+                        if (collapsed >= collapse_budget) {
+                            break;
+                        }
+                        if (touched[collapse.from] || touched[collapse.to]) {
+                            continue;
+                        }
+
+                        // reject collapses that flip a triangle around the removed vertex
+                        bool flips = false;
+                        for (u32 a = offsets[collapse.from]; a < offsets[collapse.from + 1] && !flips; a++) {
+                            const u32 *triangle = &result[adjacency[a] * 3];
+                            if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                                continue;
+                            }
+                            glm::vec3 before[3];
+                            glm::vec3 after[3];
+                            for (u32 k = 0; k < 3; k++) {
+                                before[k] = vertices[triangle[k]].position;
+                                after[k] = triangle[k] == collapse.from ? vertices[collapse.to].position : before[k];
+                            }
+                            glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+                            glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+                            flips = glm::dot(normal_before, normal_after) <= 0.0f;
+                        }
+                        if (flips) {
+                            continue;
+                        }
+
+                        remap[collapse.from] = collapse.to;
+                        quadrics[collapse.to] += quadrics[collapse.from];
+                        worst_error = std::max(worst_error, collapse.error);
+                        collapsed++;
+
+                        // neighbours of the removed vertex changed shape, their collapses are re-evaluated next pass
+                        for (u32 a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++) {
+                            const u32 *triangle = &result[adjacency[a] * 3];
+                            touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+                        }
+                    }
+                    if (collapsed == 0) {
+                        break;
+                    }
+
+                    usize write = 0;
+                    for (usize t = 0; t + 2 < result.size(); t += 3) {
+                        u32 a = remap[result[t]];
+                        u32 b = remap[result[t + 1]];
+                        u32 c = remap[result[t + 2]];
+                        if (a == b || b == c || a == c) {
+                            continue;
+                        }
+                        result[write++] = a;
+                        result[write++] = b;
+                        result[write++] = c;
+                    }
+                    result.resize(write);
+                }
+
+                if (result_error) {
+                    *result_error = static_cast<f32>(std::sqrt(worst_error));
+                }
+                return result;
+            }
+
+            void generate_lods(MeshData &mesh, const MeshLodInfo &info) {
+                u32 lod_count = std::clamp(info.lod_count, 1u, MAX_MESH_LODS);
+
+                for (auto &primitive : mesh.primitives) {
+                    primitive.lod_count = 1;
+                    if (primitive.index_count < 3 * 64) {
+                        continue; // not worth a draw call's worth of bookkeeping
+                    }
+
+                    std::vector<Model::Vertex> vertices(mesh.vertices.begin() + primitive.first_vertex, mesh.vertices.begin() + primitive.first_vertex + primitive.vertex_count);
+                    std::vector<u32> indices(mesh.indices.begin() + primitive.first_index, mesh.indices.begin() + primitive.first_index + primitive.index_count);
+                    f32 max_error = glm::length(primitive.bounds_max - primitive.bounds_min) * info.max_error;
+
+                    // every lod is simplified from full detail so its error is measured against the real surface
+                    usize previous_count = indices.size();
+                    f32 target_ratio = 1.0f;
+                    for (u32 lod = 1; lod < lod_count; lod++) {
+                        target_ratio *= info.reduction;
+                        usize target = static_cast<usize>(static_cast<f32>(indices.size() / 3) * target_ratio) * 3;
+
+                        f32 error = 0.0f;
+                        std::vector<u32> simplified = simplify_mesh(indices, vertices, target, max_error, &error);
+                        if (simplified.empty() || simplified.size() > previous_count * 9 / 10) {
+                            break; // hit the error limit, further lods would look the same
+                        }
+                        simplified = optimize_vertex_cache(simplified, primitive.vertex_count);
+
+                        MeshLodData &data = primitive.lods[lod - 1];
+                        data.first_index = static_cast<u32>(mesh.indices.size());
+                        data.index_count = static_cast<u32>(simplified.size());
+                        data.error = error;
+                        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+
+                        primitive.lod_count = lod + 1;
+                        previous_count = simplified.size();
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "mesh_data.hpp"
+
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            struct MeshLodInfo {
+                u32 lod_count = 4;     // including full detail, clamped to MAX_MESH_LODS
+                f32 reduction = 0.5f;  // triangle ratio between consecutive lods
+                f32 max_error = 0.02f; // relative to the primitive's bounding box diagonal
+            };
+
+            /**
+             * @brief Quadric error metric edge collapse (Garland and Heckbert) that only rewrites indices, so every
+             * lod shares the primitive's vertices. Open borders collapse along themselves and vertices on attribute
+             * seams stay fixed, so neither tears.
+             *
+             * @param indices triangle list referencing vertices
+             * @param target_index_count stop once the result has at most this many indices
+             * @param max_error stop before collapsing further than this model space distance
+             * @param result_error receives the distance of the worst collapse performed
+             */
+            std::vector<u32> simplify_mesh(const std::vector<u32> &indices, const std::vector<Model::Vertex> &vertices, usize target_index_count, f32 max_error, f32 *result_error = nullptr);
+
+            /**
+             * @brief Append simplified index ranges for every primitive of mesh. Run after optimize_mesh, which drops them.
+             */
+            void generate_lods(MeshData &mesh, const MeshLodInfo &info = {});
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include "meshlet_builder.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            static MeshMeshletData compute_meshlet_bounds(const MeshData &mesh, const MeshPrimitiveData &primitive, u32 first_index, u32 index_count, bool double_sided) {
+                const Model::Vertex *vertices = &mesh.vertices[primitive.first_vertex];
+                const u32 *indices = &mesh.indices[first_index];
+
+                MeshMeshletData meshlet{};
+                meshlet.first_index = first_index;
+                meshlet.index_count = index_count;
+
+                glm::vec3 bounds_min{ std::numeric_limits<f32>::max() };
+                glm::vec3 bounds_max{ std::numeric_limits<f32>::lowest() };
+                for (u32 i = 0; i < index_count; i++) {
+                    bounds_min = glm::min(bounds_min, vertices[indices[i]].position);
+                    bounds_max = glm::max(bounds_max, vertices[indices[i]].position);
+                }
+                meshlet.center = (bounds_min + bounds_max) * 0.5f;
+                for (u32 i = 0; i < index_count; i++) {
+                    meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].position - meshlet.center));
+                }
+
+                std::vector<glm::vec3> normals;
+                normals.reserve(index_count / 3);
+                glm::vec3 axis{ 0.0f };
+                for (u32 i = 0; i + 2 < index_count; i += 3) {
+                    const glm::vec3 &p0 = vertices[indices[i]].position;
+                    const glm::vec3 &p1 = vertices[indices[i + 1]].position;
+                    const glm::vec3 &p2 = vertices[indices[i + 2]].position;
+                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                    f32 length = glm::length(normal);
+                    if (length > 0.0f) {
+                        normals.push_back(normal / length);
+                        axis += normals.back();
+                    }
+                }
+
+                // a cone that can't reject anything, used for double sided materials and whenever the normals spread too far
+                meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+                meshlet.cone_cutoff = 1.0f;
+
+                f32 axis_length = glm::length(axis);
+                if (axis_length > 0.0f && !double_sided) {
+                    axis /= axis_length;
+                    f32 min_dot = 1.0f;
+                    for (auto &normal : normals) {
+                        min_dot = std::min(min_dot, glm::dot(axis, normal));
+                    }
+                    if (min_dot > 0.1f) {
+                        // sine of the cone's half angle, culled when the view direction is inside the mirrored cone
+                        meshlet.cone_axis = axis;
+                        meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+                    }
+                }
+                return meshlet;
+            }
+
+            void build_meshlets(MeshData &mesh) {
+                mesh.meshlets.clear();
+
+                std::vector<u32> slot;
+                for (auto &primitive : mesh.primitives) {
+                    primitive.first_meshlet = static_cast<u32>(mesh.meshlets.size());
+                    primitive.meshlet_count = 0;
+                    bool double_sided = primitive.material != -1 && mesh.materials[primitive.material].double_sided;
+
+                    // marks vertices already in the current meshlet
+                    slot.assign(primitive.vertex_count, std::numeric_limits<u32>::max());
+                    u32 meshlet_id = 0;
+                    u32 meshlet_vertices = 0;
+                    u32 meshlet_start = primitive.first_index;
+
+                    u32 end = primitive.first_index + primitive.index_count;
+                    for (u32 i = primitive.first_index; i + 2 < end; i += 3) {
+                        u32 new_vertices = 0;
+                        for (u32 k = 0; k < 3; k++) {
+                            u32 index = mesh.indices[i + k];
+                            bool repeated = (k > 0 && mesh.indices[i] == index) || (k > 1 && mesh.indices[i + 1] == index);
+                            new_vertices += slot[index] != meshlet_id && !repeated ? 1 : 0;
+                        }
+
+                        u32 triangles = (i - meshlet_start) / 3;
+                        if (meshlet_vertices + new_vertices > MAX_MESHLET_VERTICES || triangles + 1 > MAX_MESHLET_TRIANGLES) {
+                            mesh.meshlets.push_back(compute_meshlet_bounds(mesh, primitive, meshlet_start, i - meshlet_start, double_sided));
+                            primitive.meshlet_count++;
+                            meshlet_id++;
+                            meshlet_vertices = 0;
+                            meshlet_start = i;
+                        }
+
+                        for (u32 k = 0; k < 3; k++) {
+                            u32 index = mesh.indices[i + k];
+                            if (slot[index] != meshlet_id) {
+                                slot[index] = meshlet_id;
+                                meshlet_vertices++;
+                            }
+                        }
+                    }
+
+                    if (meshlet_start < end) {
+                        mesh.meshlets.push_back(compute_meshlet_bounds(mesh, primitive, meshlet_start, end - meshlet_start, double_sided));
+                        primitive.meshlet_count++;
+                    }
+                }
+            }
+        }
+    }
+}
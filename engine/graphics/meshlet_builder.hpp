@@ -0,0 +1,20 @@
+#pragma once
+
+#include "mesh_data.hpp"
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            static constexpr u32 MAX_MESHLET_VERTICES = 64;
+            static constexpr u32 MAX_MESHLET_TRIANGLES = 124;
+
+            /**
+             * @brief Split the full detail range of every primitive into meshlets of at most MAX_MESHLET_VERTICES
+             * vertices and MAX_MESHLET_TRIANGLES triangles, with a bounding sphere and normal cone each.
+             * Meshlets are cut from the existing triangle order, so they stay contiguous in the index buffer and
+             * adjacent visible meshlets can be drawn as one range. Run after optimize_mesh for tight clusters.
+             */
+            void build_meshlets(MeshData &mesh);
+        }
+    }
+}
@@ -1,60 +1,128 @@
 #include "model.hpp"
 
+#include "bindless_materials.hpp"
+#include "cooked_mesh.hpp"
 #include "descriptors.hpp"
 #include "device.hpp"
-#include "utils.hpp"
+#include "mesh_data.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "pipeline_library.hpp"
+#include "texture_cache.hpp"
+#include "upload_manager.hpp"
+#include "../core/derived_data_cache.hpp"
+#include "../core/hash.hpp"
+#include "../core/pack_file.hpp"
+#include "../core/timing_report.hpp"
 
 // libs
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <unordered_map>
 #include <filesystem>
 #include <iostream>
-
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define TINYGLTF_NO_STB_IMAGE_WRITE
-#define STBI_MSC_SECURE_CRT
-//#define TINYGLTF_NO_STB_IMAGE
-#include <tinygltf/tiny_gltf.h>
+#include <limits>
+#include <stdexcept>
 
 #ifndef ENGINE_DIR
 #define ENGINE_DIR ""
 #endif
 
-namespace std {
-    template <>
-    struct hash<VGED::Engine::Graphics::Model::Vertex> {
-        size_t operator()(VGED::Engine::Graphics::Model::Vertex const &vertex) const {
-            size_t seed = 0;
-            VGED::Engine::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-            return seed;
-        }
-    };
-}
-
 namespace VGED {
     namespace Engine {
         inline namespace Graphics {
-            void Model::createVertexBuffers(const std::vector<Vertex> &vertices) {
-                uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
-                assert(vertexCount >= 3 && "Vertex count must be at least 3");
-                VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-                uint32_t vertexSize = sizeof(vertices[0]);
+            // bump when the glTF import, optimizer, simplifier or meshlet builder produce different data
+            static constexpr u32 MODEL_IMPORT_VERSION = 1;
 
-                Buffer stagingBuffer{ device.device(), device.allocator(), BufferInfo {
-                    .instance_size = vertexSize,
-                    .instance_count = vertexCount,
-                    .memory_flags = MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE
-                }};
+            static glm::vec2 octEncode(glm::vec3 n) {
+                float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+                if (!(l1 > 0.0f)) {
+                    return glm::vec2(0.0f); // decodes to +z, also catches missing normals
+                }
+                n /= l1;
+                if (n.z < 0.0f) {
+                    return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+                }
+                return glm::vec2(n.x, n.y);
+            }
+
+            static i16 packSnorm16(float v) { return static_cast<i16>(std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f)); }
+
+            template <typename PackedVertex>
+            static void packCommon(const Model::Vertex &vertex, PackedVertex &packed) {
+                glm::vec2 normal = octEncode(vertex.normal);
+                packed.normal[0] = packSnorm16(normal.x);
+                packed.normal[1] = packSnorm16(normal.y);
+
+                glm::vec2 tangent = octEncode(glm::vec3(vertex.tangent));
+                packed.tangent[0] = packSnorm16(tangent.x);
+                packed.tangent[1] = static_cast<i16>((packSnorm16(tangent.y) & ~1) | (vertex.tangent.w < 0.0f ? 1 : 0));
+
+                u32 uv = glm::packHalf2x16(vertex.uv);
+                packed.uv[0] = static_cast<u16>(uv & 0xffff);
+                packed.uv[1] = static_cast<u16>(uv >> 16);
+            }
+
+            static uint32_t packedVertexSize(VertexFormat format) {
+                switch (format) {
+                case VertexFormat::COMPACT: return sizeof(Model::CompactVertex);
+                case VertexFormat::QUANTIZED: return sizeof(Model::QuantizedVertex);
+                default: return sizeof(Model::Vertex);
+                }
+            }
 
-                stagingBuffer.map();
-                stagingBuffer.write_to_buffer((void *)vertices.data());
+            void Model::createVertexBuffers(const Vertex *vertices, uint32_t vertexCount) {
+                assert(vertexCount >= 3 && "Vertex count must be at least 3");
+                uint32_t vertexSize = packedVertexSize(vertexFormat);
+                VkDeviceSize bufferSize = static_cast<VkDeviceSize>(vertexSize) * vertexCount;
+
+                // pack straight into the upload ring
+                UploadStaging staging = device.upload_manager().stage(bufferSize);
+                switch (vertexFormat) {
+                case VertexFormat::STANDARD: {
+                    std::memcpy(staging.mapped, vertices, bufferSize);
+                    break;
+                }
+                case VertexFormat::COMPACT: {
+                    auto *packed = static_cast<CompactVertex *>(staging.mapped);
+                    for (uint32_t v = 0; v < vertexCount; v++) {
+                        CompactVertex vertex{};
+                        vertex.position = vertices[v].position;
+                        packCommon(vertices[v], vertex);
+                        packed[v] = vertex;
+                    }
+                    break;
+                }
+                case VertexFormat::QUANTIZED: {
+                    glm::vec3 boundsMin = vertices[0].position;
+                    glm::vec3 boundsMax = vertices[0].position;
+                    for (uint32_t v = 1; v < vertexCount; v++) {
+                        boundsMin = glm::min(boundsMin, vertices[v].position);
+                        boundsMax = glm::max(boundsMax, vertices[v].position);
+                    }
+                    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+                    dequantization = glm::translate(glm::mat4{ 1.f }, boundsMin) * glm::scale(glm::mat4{ 1.f }, extent);
+
+                    auto *packed = static_cast<QuantizedVertex *>(staging.mapped);
+                    for (uint32_t v = 0; v < vertexCount; v++) {
+                        QuantizedVertex vertex{};
+                        glm::vec3 position = glm::clamp((vertices[v].position - boundsMin) / extent, 0.0f, 1.0f);
+                        vertex.position[0] = static_cast<u16>(std::round(position.x * 65535.0f));
+                        vertex.position[1] = static_cast<u16>(std::round(position.y * 65535.0f));
+                        vertex.position[2] = static_cast<u16>(std::round(position.z * 65535.0f));
+                        packCommon(vertices[v], vertex);
+                        packed[v] = vertex;
+                    }
+                    break;
+                }
+                }
 
                 vertexBuffer = std::make_unique<Buffer>(device.device(), device.allocator(), BufferInfo {
                     .instance_size = vertexSize,
@@ -62,53 +130,178 @@ namespace VGED {
                     .memory_flags = MemoryFlagBits::DEDICATED_MEMORY
                 });
 
-                device.copy_buffer(stagingBuffer.get_buffer(), vertexBuffer->get_buffer(), bufferSize);
+                device.upload_manager().copy_buffer(staging, vertexBuffer->get_buffer(), bufferSize);
+
+                std::cout << "vertex buffer: " << vertexCount << " vertices, " << bufferSize / 1024 << " KiB (" << vertexSize << " bytes/vertex, standard layout would be "
+                          << static_cast<VkDeviceSize>(sizeof(Vertex)) * vertexCount / 1024 << " KiB)" << std::endl;
             }
 
-            void Model::createIndexBuffers(const std::vector<uint32_t> &indices) {
-                uint32_t indexCount = static_cast<uint32_t>(indices.size());
+            void Model::createIndexBuffers(const uint32_t *indices, uint32_t indexCount) {
                 hasIndexBuffer = indexCount > 0;
 
                 if (!hasIndexBuffer) {
                     return;
                 }
 
-                VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-                uint32_t indexSize = sizeof(indices[0]);
+                VkDeviceSize bufferSize = sizeof(uint32_t) * indexCount;
+                uint32_t indexSize = sizeof(uint32_t);
 
-                Buffer stagingBuffer{ device.device(), device.allocator(), BufferInfo {
+                indexBuffer = std::make_unique<Buffer>(device.device(), device.allocator(), BufferInfo {
                     .instance_size = indexSize,
                     .instance_count = indexCount,
-                    .memory_flags = MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE
-                }};
+                    .memory_flags = MemoryFlagBits::DEDICATED_MEMORY
+                });
+
+                device.upload_manager().upload_buffer(indexBuffer->get_buffer(), indices, bufferSize);
+            }
+
+            void Model::createBuffers(const GltfImporter &importer) {
+                uint32_t vertexCount = importer.vertex_count();
+                uint32_t indexCount = importer.index_count();
+                assert(vertexCount >= 3 && "Vertex count must be at least 3");
 
-                stagingBuffer.map();
-                stagingBuffer.write_to_buffer((void *)indices.data());
+                VkDeviceSize vertexBufferSize = sizeof(Vertex) * static_cast<VkDeviceSize>(vertexCount);
+                UploadStaging vertexStaging = device.upload_manager().stage(vertexBufferSize);
+                importer.read_vertices(static_cast<Vertex *>(vertexStaging.mapped));
+                vertexBuffer = std::make_unique<Buffer>(device.device(), device.allocator(), BufferInfo {
+                    .instance_size = sizeof(Vertex),
+                    .instance_count = vertexCount,
+                    .memory_flags = MemoryFlagBits::DEDICATED_MEMORY
+                });
+                device.upload_manager().copy_buffer(vertexStaging, vertexBuffer->get_buffer(), vertexBufferSize);
+
+                hasIndexBuffer = indexCount > 0;
+                if (!hasIndexBuffer) {
+                    return;
+                }
 
+                VkDeviceSize indexBufferSize = sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCount);
+                UploadStaging indexStaging = device.upload_manager().stage(indexBufferSize);
+                importer.read_indices(static_cast<uint32_t *>(indexStaging.mapped));
                 indexBuffer = std::make_unique<Buffer>(device.device(), device.allocator(), BufferInfo {
-                    .instance_size = indexSize,
+                    .instance_size = sizeof(uint32_t),
                     .instance_count = indexCount,
                     .memory_flags = MemoryFlagBits::DEDICATED_MEMORY
                 });
+                device.upload_manager().copy_buffer(indexStaging, indexBuffer->get_buffer(), indexBufferSize);
+            }
+
+            ModelCulling ModelCulling::fromMatrices(const glm::mat4 &modelViewProjection, const glm::mat4 &inverseModel, const glm::vec3 &cameraWorldPosition) {
+                // Gribb and Hartmann, rows of the matrix combined for a 0..1 depth range
+                auto row = [&](int i) { return glm::vec4(modelViewProjection[0][i], modelViewProjection[1][i], modelViewProjection[2][i], modelViewProjection[3][i]); };
+
+                ModelCulling culling{};
+                culling.planes[0] = row(3) + row(0);
+                culling.planes[1] = row(3) - row(0);
+                culling.planes[2] = row(3) + row(1);
+                culling.planes[3] = row(3) - row(1);
+                culling.planes[4] = row(2);
+                culling.planes[5] = row(3) - row(2);
+                for (auto &plane : culling.planes) {
+                    plane = plane * (1.0f / glm::length(glm::vec3(plane)));
+                }
+                culling.cameraPosition = glm::vec3(inverseModel * glm::vec4(cameraWorldPosition, 1.0f));
+                return culling;
+            }
+
+            bool ModelCulling::isSphereVisible(const glm::vec3 &center, float radius) const {
+                for (auto &plane : planes) {
+                    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            void Model::draw(VkCommandBuffer commandBuffer, VkDescriptorSet globalDescriptorSet, VkPipelineLayout pipelineLayout, const Instance &instance, uint32_t lod, ModelCulling *culling,
+                             const VkPipeline *materialPipelines) {
+                drawPrimitives(commandBuffer, globalDescriptorSet, pipelineLayout, instance, lod, culling, materialPipelines, false);
+            }
 
-                device.copy_buffer(stagingBuffer.get_buffer(), indexBuffer->get_buffer(), bufferSize);
+            void Model::drawBindless(VkCommandBuffer commandBuffer, const Instance &instance, uint32_t lod, ModelCulling *culling, const VkPipeline *materialPipelines) {
+                assert((usesBindless || materials.empty()) && "model was loaded without ModelInfo::bindless");
+                drawPrimitives(commandBuffer, VK_NULL_HANDLE, VK_NULL_HANDLE, instance, lod, culling, materialPipelines, true);
             }
 
-            void Model::draw(VkCommandBuffer commandBuffer, VkDescriptorSet globalDescriptorSet, VkPipelineLayout pipelineLayout) {
-                for (auto &primitive : primitives) {
+            void Model::drawPrimitives(VkCommandBuffer commandBuffer, VkDescriptorSet globalDescriptorSet, VkPipelineLayout pipelineLayout, const Instance &instance, uint32_t lod, ModelCulling *culling,
+                                       const VkPipeline *materialPipelines, bool bindless) {
+                VkPipeline boundPipeline = VK_NULL_HANDLE;
+                for (uint32_t p = instance.firstPrimitive; p < instance.firstPrimitive + instance.primitiveCount; p++) {
+                    const Primitive &primitive = primitives[p];
+                    // the variants share their layout, so the bound descriptor sets and push constants stay valid
+                    if (materialPipelines && materialPipelines[primitive.material.features] != boundPipeline) {
+                        boundPipeline = materialPipelines[primitive.material.features];
+                        device.pipeline_library().bind(commandBuffer, boundPipeline);
+                    }
+                    // bindless shaders read the material at the instance index
+                    uint32_t firstInstance = bindless ? primitive.material.bindlessIndex : 0;
+                    auto bindMaterial = [&]() {
+                        if (!bindless) {
+                            VkDescriptorSet sets[] = { globalDescriptorSet, primitive.material.descriptorSet };
+                            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, sets, 0, nullptr);
+                        }
+                    };
                     if (hasIndexBuffer) {
-                        std::vector<VkDescriptorSet> sets{ globalDescriptorSet, primitive.material.descriptorSet };
-                        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, sets.size(), sets.data(), 0, nullptr);
-                        vkCmdDrawIndexed(commandBuffer, primitive.indexCount, 1, primitive.firstIndex, primitive.firstVertex, 0);
+                        const Lod &range = primitive.lods[std::min(lod, primitive.lodCount - 1)];
+                        if (culling == nullptr || lod != 0 || primitive.meshletCount == 0) {
+                            bindMaterial();
+                            vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.firstIndex, primitive.firstVertex, firstInstance);
+                            if (culling) {
+                                culling->drawCount++;
+                            }
+                            continue;
+                        }
+
+                        bool bound = false;
+                        uint32_t runFirst = 0;
+                        uint32_t runCount = 0;
+                        auto flush = [&]() {
+                            if (runCount == 0) {
+                                return;
+                            }
+                            if (!bound) {
+                                bindMaterial();
+                                bound = true;
+                            }
+                            vkCmdDrawIndexed(commandBuffer, runCount, 1, runFirst, primitive.firstVertex, firstInstance);
+                            culling->drawCount++;
+                            runCount = 0;
+                        };
+
+                        for (uint32_t m = primitive.firstMeshlet; m < primitive.firstMeshlet + primitive.meshletCount; m++) {
+                            const Meshlet &meshlet = meshlets[m];
+                            culling->meshletCount++;
+
+                            // backfacing when the camera lies inside the cone mirrored through the meshlet center
+                            glm::vec3 toCenter = meshlet.center - culling->cameraPosition;
+                            bool backfacing = glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+                            if (backfacing || !culling->isSphereVisible(meshlet.center, meshlet.radius)) {
+                                flush();
+                                continue;
+                            }
+
+                            culling->visibleMeshletCount++;
+                            if (runCount > 0 && runFirst + runCount == meshlet.firstIndex) {
+                                runCount += meshlet.indexCount;
+                            } else {
+                                flush();
+                                runFirst = meshlet.firstIndex;
+                                runCount = meshlet.indexCount;
+                            }
+                        }
+                        flush();
                     } else {
-                        std::vector<VkDescriptorSet> sets{ globalDescriptorSet, primitive.material.descriptorSet };
-                        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, sets.size(), sets.data(), 0, nullptr);
-                        vkCmdDraw(commandBuffer, primitive.vertexCount, 1, 0, 0);
+                        bindMaterial();
+                        vkCmdDraw(commandBuffer, primitive.vertexCount, 1, 0, firstInstance);
                     }
                 }
             }
 
             void Model::bind(VkCommandBuffer commandBuffer) {
+                if (isEmpty()) {
+                    return;
+                }
+
                 VkBuffer buffers[] = { vertexBuffer->get_buffer() };
                 VkDeviceSize offsets[] = { 0 };
                 vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
@@ -126,6 +319,32 @@ namespace VGED {
                 return bindingDescriptions;
             }
 
+            std::vector<VkVertexInputBindingDescription> Model::getBindingDescriptions(VertexFormat format) {
+                std::vector<VkVertexInputBindingDescription> bindingDescriptions = Vertex::getBindingDescriptions();
+                bindingDescriptions[0].stride = packedVertexSize(format);
+                return bindingDescriptions;
+            }
+
+            std::vector<VkVertexInputAttributeDescription> Model::getAttributeDescriptions(VertexFormat format) {
+                std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+                switch (format) {
+                case VertexFormat::COMPACT:
+                    attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(CompactVertex, position) });
+                    attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal) });
+                    attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SINT, offsetof(CompactVertex, tangent) });
+                    attributeDescriptions.push_back({ 4, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv) });
+                    break;
+                case VertexFormat::QUANTIZED:
+                    attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(QuantizedVertex, position) });
+                    attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(QuantizedVertex, normal) });
+                    attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SINT, offsetof(QuantizedVertex, tangent) });
+                    attributeDescriptions.push_back({ 4, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(QuantizedVertex, uv) });
+                    break;
+                default: attributeDescriptions = Vertex::getAttributeDescriptions(); break;
+                }
+                return attributeDescriptions;
+            }
+
             std::vector<VkVertexInputAttributeDescription> Model::Vertex::getAttributeDescriptions() {
                 std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
                 attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
@@ -137,178 +356,314 @@ namespace VGED {
                 return attributeDescriptions;
             }
 
-            Model::~Model() {}
-
-            Model::Model(Device &_device, const std::string &filepath, DescriptorSetLayout &materialSetLayout, DescriptorPool &descriptorPool) : device{ _device } {
-                std::string warn, err;
-                tinygltf::TinyGLTF GltfLoader;
-                tinygltf::Model GltfModel;
-                if (!GltfLoader.LoadASCIIFromFile(&GltfModel, &err, &warn, filepath)) {
-                    throw std::runtime_error("failed to load gltf file!");
+            void Model::loadImages(const std::vector<TextureSource> &sources, const MeshMaterialData *meshMaterials, uint32_t materialCount, ThreadPool &threadPool) {
+                // normal and metallic roughness maps hold linear data, an image used in both roles is loaded once per format
+                std::vector<bool> colorUse(sources.size(), false);
+                std::vector<bool> linearUse(sources.size(), false);
+                for (uint32_t i = 0; i < materialCount; i++) {
+                    if (meshMaterials[i].albedo_image != -1) {
+                        colorUse[meshMaterials[i].albedo_image] = true;
+                    }
+                    if (meshMaterials[i].normal_image != -1) {
+                        linearUse[meshMaterials[i].normal_image] = true;
+                    }
+                    if (meshMaterials[i].metallic_roughness_image != -1) {
+                        linearUse[meshMaterials[i].metallic_roughness_image] = true;
+                    }
                 }
 
-                auto path = std::filesystem::path{ filepath };
+                // misses are decoded on the pool and uploaded in one batch, images shared with other models are reused
+                auto load = [&](const std::vector<bool> &use, const TextureInfo &info, std::vector<std::shared_ptr<Texture>> &loaded) {
+                    std::vector<TextureSource> used{};
+                    for (usize i = 0; i < sources.size(); i++) {
+                        if (use[i]) {
+                            used.push_back(sources[i]);
+                        }
+                    }
+                    loaded.assign(sources.size(), nullptr);
+                    if (used.empty()) {
+                        return;
+                    }
+                    std::vector<std::shared_ptr<Texture>> textures = device.texture_cache().get(used, info, threadPool);
+                    for (usize i = 0, next = 0; i < sources.size(); i++) {
+                        if (use[i]) {
+                            loaded[i] = std::move(textures[next++]);
+                        }
+                    }
+                };
+                load(colorUse, { .srgb = true }, images);
+                load(linearUse, { .srgb = false }, linearImages);
+            }
+
+            void Model::createMaterials(const MeshMaterialData *meshMaterials, uint32_t materialCount, DescriptorSetLayout &materialSetLayout, DescriptorAllocator &descriptorAllocator) {
+                auto timer = TimingReport::shared().measure("model materials");
+                std::shared_ptr<Texture> defaultTexture = device.texture_cache().get("textures/white.png");
+                auto resolve = [&](const std::vector<std::shared_ptr<Texture>> &loaded, i32 imageIndex) { return imageIndex != -1 ? loaded[imageIndex] : defaultTexture; };
+
+                // every material set is written by one flush after the loop
+                DescriptorBatch descriptorBatch{ device };
+
+                // the last material is the fallback for primitives without one
+                materials.reserve(materialCount + 1);
+                for (uint32_t i = 0; i <= materialCount; i++) {
+                    Material material{};
+                    if (i < materialCount) {
+                        material.albedoTexture = resolve(images, meshMaterials[i].albedo_image);
+                        material.normalTexture = resolve(linearImages, meshMaterials[i].normal_image);
+                        material.metallicRoughnessTexture = resolve(linearImages, meshMaterials[i].metallic_roughness_image);
+                        material.features |= meshMaterials[i].normal_image != -1 ? MATERIAL_FEATURE_NORMAL_MAP : 0;
+                        material.features |= meshMaterials[i].metallic_roughness_image != -1 ? MATERIAL_FEATURE_METALLIC_ROUGHNESS_MAP : 0;
+                    } else {
+                        material.albedoTexture = defaultTexture;
+                        material.normalTexture = defaultTexture;
+                        material.metallicRoughnessTexture = defaultTexture;
+                    }
+
+                    VkDescriptorImageInfo albedo_info = {};
+                    albedo_info.sampler = material.albedoTexture->getSampler();
+                    albedo_info.imageView = material.albedoTexture->getImageView();
+                    albedo_info.imageLayout = material.albedoTexture->getImageLayout();
+
+                    VkDescriptorImageInfo normal_info = {};
+                    normal_info.sampler = material.normalTexture->getSampler();
+                    normal_info.imageView = material.normalTexture->getImageView();
+                    normal_info.imageLayout = material.normalTexture->getImageLayout();
+
+                    VkDescriptorImageInfo metallicRoughness_info = {};
+                    metallicRoughness_info.sampler = material.metallicRoughnessTexture->getSampler();
+                    metallicRoughness_info.imageView = material.metallicRoughnessTexture->getImageView();
+                    metallicRoughness_info.imageLayout = material.metallicRoughnessTexture->getImageLayout();
 
-                for (auto &image : GltfModel.images) {
-                    images.push_back(std::make_shared<Texture>(device, path.parent_path().append(image.uri).generic_string()));
+                    if (!descriptorAllocator.allocateDescriptor(materialSetLayout.getDescriptorSetLayout(), material.descriptorSet)) {
+                        throw std::runtime_error("failed to allocate material descriptor set!");
+                    }
+                    descriptorBatch.writeSet(materialSetLayout, material.descriptorSet)
+                        .writeImage(0, albedo_info)
+                        .writeImage(1, normal_info)
+                        .writeImage(2, metallicRoughness_info);
+
+                    // renderers on the classic descriptor set path never read the table, so they don't take slots from it
+                    if (usesBindless) {
+                        material.bindlessIndex = device.bindless_materials().add_material({
+                            .albedo = material.albedoTexture.get(),
+                            .normal = material.normalTexture.get(),
+                            .metallic_roughness = material.metallicRoughnessTexture.get(),
+                            .features = material.features,
+                        });
+                    }
+
+                    materialVariants |= 1u << material.features;
+                    materials.push_back(material);
                 }
+                descriptorBatch.flush();
+            }
 
-                for (auto &scene : GltfModel.scenes) {
-                    for (size_t i = 0; i < scene.nodes.size(); i++) {
-                        auto &node = GltfModel.nodes[i];
-                        uint32_t vertexOffset = 0;
-                        uint32_t indexOffset = 0;
-
-                        for (auto &GltfPrimitive : GltfModel.meshes[node.mesh].primitives) {
-                            uint32_t vertexCount = 0;
-                            uint32_t indexCount = 0;
-
-                            const float *positionBuffer = nullptr;
-                            const float *normalsBuffer = nullptr;
-                            const float *texCoordsBuffer = nullptr;
-                            const float *tangentsBuffer = nullptr;
-
-                            if (GltfPrimitive.attributes.find("POSITION") != GltfPrimitive.attributes.end()) {
-                                const tinygltf::Accessor &accessor = GltfModel.accessors[GltfPrimitive.attributes.find("POSITION")->second];
-                                const tinygltf::BufferView &view = GltfModel.bufferViews[accessor.bufferView];
-                                positionBuffer = reinterpret_cast<const float *>(&(GltfModel.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-                                vertexCount = accessor.count;
-                            }
+            void Model::createPrimitives(const MeshPrimitiveData *meshPrimitives, uint32_t primitiveCount) {
+                primitives.reserve(primitiveCount);
+                for (uint32_t i = 0; i < primitiveCount; i++) {
+                    const MeshPrimitiveData &meshPrimitive = meshPrimitives[i];
+
+                    Primitive primitive{};
+                    primitive.firstVertex = meshPrimitive.first_vertex;
+                    primitive.vertexCount = meshPrimitive.vertex_count;
+                    primitive.indexCount = meshPrimitive.index_count;
+                    primitive.firstIndex = meshPrimitive.first_index;
+                    primitive.material = meshPrimitive.material != -1 ? materials[meshPrimitive.material] : materials.back();
+
+                    primitive.firstMeshlet = meshPrimitive.first_meshlet;
+                    primitive.meshletCount = meshPrimitive.meshlet_count;
+
+                    primitive.lodCount = std::clamp(meshPrimitive.lod_count, 1u, MAX_MESH_LODS);
+                    primitive.lods[0] = { primitive.firstIndex, primitive.indexCount };
+                    for (uint32_t lod = 1; lod < primitive.lodCount; lod++) {
+                        const MeshLodData &meshLod = meshPrimitive.lods[lod - 1];
+                        primitive.lods[lod] = { meshLod.first_index, meshLod.index_count };
+                        if (lodErrors.size() <= lod) {
+                            lodErrors.resize(lod + 1, 0.0f);
+                        }
+                        lodErrors[lod] = std::max(lodErrors[lod], meshLod.error);
+                    }
+                    primitives.push_back(primitive);
+                    primitiveBounds.push_back({ meshPrimitive.bounds_min, meshPrimitive.bounds_max });
+                }
 
-                            if (GltfPrimitive.attributes.find("NORMAL") != GltfPrimitive.attributes.end()) {
-                                const tinygltf::Accessor &accessor = GltfModel.accessors[GltfPrimitive.attributes.find("NORMAL")->second];
-                                const tinygltf::BufferView &view = GltfModel.bufferViews[accessor.bufferView];
-                                normalsBuffer = reinterpret_cast<const float *>(&(GltfModel.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-                            }
+                // primitives with fewer lods keep drawing their coarsest one, which is at least as accurate
+                for (uint32_t lod = 1; lod < lodErrors.size(); lod++) {
+                    lodErrors[lod] = std::max(lodErrors[lod], lodErrors[lod - 1]);
+                }
+            }
 
-                            if (GltfPrimitive.attributes.find("TEXCOORD_0") != GltfPrimitive.attributes.end()) {
-                                const tinygltf::Accessor &accessor = GltfModel.accessors[GltfPrimitive.attributes.find("TEXCOORD_0")->second];
-                                const tinygltf::BufferView &view = GltfModel.bufferViews[accessor.bufferView];
-                                texCoordsBuffer = reinterpret_cast<const float *>(&(GltfModel.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-                            }
+            void Model::createInstances(const MeshInstanceData *meshInstances, uint32_t instanceCount) {
+                glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+                glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+
+                instances.reserve(instanceCount);
+                for (uint32_t i = 0; i < instanceCount; i++) {
+                    const MeshInstanceData &meshInstance = meshInstances[i];
+                    assert(meshInstance.first_primitive + meshInstance.primitive_count <= primitives.size() && "instance references missing primitives");
+
+                    Instance instance{};
+                    instance.transform = meshInstance.transform;
+                    instance.normalMatrix = glm::transpose(glm::inverse(glm::mat3(meshInstance.transform)));
+                    instance.firstPrimitive = meshInstance.first_primitive;
+                    instance.primitiveCount = meshInstance.primitive_count;
+                    instance.isIdentity = meshInstance.transform == glm::mat4{ 1.f };
+                    instances.push_back(instance);
+
+                    for (uint32_t p = instance.firstPrimitive; p < instance.firstPrimitive + instance.primitiveCount; p++) {
+                        auto [primitiveMin, primitiveMax] = primitiveBounds[p];
+                        transform_bounds(instance.transform, primitiveMin, primitiveMax);
+                        boundsMin = glm::min(boundsMin, primitiveMin);
+                        boundsMax = glm::max(boundsMax, primitiveMax);
+                    }
+                }
+                primitiveBounds.clear();
+                primitiveBounds.shrink_to_fit();
 
-                            if (GltfPrimitive.attributes.find("TANGENT") != GltfPrimitive.attributes.end()) {
-                                const tinygltf::Accessor &accessor = GltfModel.accessors[GltfPrimitive.attributes.find("TANGENT")->second];
-                                const tinygltf::BufferView &view = GltfModel.bufferViews[accessor.bufferView];
-                                tangentsBuffer = reinterpret_cast<const float *>(&(GltfModel.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-                            }
+                if (instanceCount > 0) {
+                    boundsCenter = (boundsMin + boundsMax) * 0.5f;
+                    boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+                }
+            }
 
-                            for (size_t v = 0; v < vertexCount; v++) {
-                                Vertex vertex{};
-                                vertex.position = glm::make_vec3(&positionBuffer[v * 3]);
-                                vertex.color = glm::vec3(1.0);
-                                vertex.normal = glm::normalize(glm::vec3(normalsBuffer ? glm::make_vec3(&normalsBuffer[v * 3]) : glm::vec3(0.0f)));
-                                vertex.tangent = glm::vec4(tangentsBuffer ? glm::make_vec4(&tangentsBuffer[v * 4]) : glm::vec4(0.0f));
-                                ;
-                                vertex.uv = texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[v * 2]) : glm::vec2(0.0f);
-                                vertices.push_back(vertex);
-                            }
+            void Model::createMeshlets(const MeshMeshletData *meshMeshlets, uint32_t meshletCount) {
+                meshlets.reserve(meshletCount);
+                for (uint32_t i = 0; i < meshletCount; i++) {
+                    const MeshMeshletData &meshlet = meshMeshlets[i];
+                    meshlets.push_back({ meshlet.first_index, meshlet.index_count, meshlet.center, meshlet.radius, meshlet.cone_axis, meshlet.cone_cutoff });
+                }
+            }
 
-                            {
-                                const tinygltf::Accessor &accessor = GltfModel.accessors[GltfPrimitive.indices];
-                                const tinygltf::BufferView &bufferView = GltfModel.bufferViews[accessor.bufferView];
-                                const tinygltf::Buffer &buffer = GltfModel.buffers[bufferView.buffer];
-
-                                indexCount += static_cast<uint32_t>(accessor.count);
-
-                                switch (accessor.componentType) {
-                                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-                                    const uint32_t *buf = reinterpret_cast<const uint32_t *>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-                                    for (size_t index = 0; index < accessor.count; index++) {
-                                        indices.push_back(buf[index]);
-                                    }
-                                    break;
-                                }
-                                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-                                    const uint16_t *buf = reinterpret_cast<const uint16_t *>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-                                    for (size_t index = 0; index < accessor.count; index++) {
-                                        indices.push_back(buf[index]);
-                                    }
-                                    break;
-                                }
-                                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-                                    const uint8_t *buf = reinterpret_cast<const uint8_t *>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-                                    for (size_t index = 0; index < accessor.count; index++) {
-                                        indices.push_back(buf[index]);
-                                    }
-                                    break;
-                                }
-                                default: std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl; return;
-                                }
-                            }
+            Model::~Model() {
+                if (!usesBindless) {
+                    return;
+                }
+                for (auto &material : materials) {
+                    device.bindless_materials().release_material(material.bindlessIndex);
+                }
+            }
 
-                            std::shared_ptr<Texture> defaultTexture = std::make_shared<Texture>(device, "textures/white.png");
-
-                            Material material{};
-                            if (GltfPrimitive.material != -1) {
-                                tinygltf::Material &GltfPrimitiveMaterial = GltfModel.materials[GltfPrimitive.material];
-
-                                if (GltfPrimitiveMaterial.pbrMetallicRoughness.baseColorTexture.index != -1) {
-                                    uint32_t textureIndex = GltfPrimitiveMaterial.pbrMetallicRoughness.baseColorTexture.index;
-                                    uint32_t imageIndex = GltfModel.textures[textureIndex].source;
-                                    material.albedoTexture = images[imageIndex];
-                                } else {
-                                    material.albedoTexture = defaultTexture;
-                                }
-
-                                if (GltfPrimitiveMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index != -1) {
-                                    uint32_t textureIndex = GltfPrimitiveMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index;
-                                    uint32_t imageIndex = GltfModel.textures[textureIndex].source;
-                                    material.metallicRoughnessTexture = images[imageIndex];
-                                } else {
-                                    material.metallicRoughnessTexture = defaultTexture;
-                                }
-
-                                if (GltfPrimitiveMaterial.normalTexture.index != -1) {
-                                    uint32_t textureIndex = GltfPrimitiveMaterial.normalTexture.index;
-                                    uint32_t imageIndex = GltfModel.textures[textureIndex].source;
-                                    material.normalTexture = images[imageIndex];
-                                } else {
-                                    material.normalTexture = defaultTexture;
-                                }
-                            } else {
-                                material.albedoTexture = defaultTexture;
-                                material.normalTexture = defaultTexture;
-                                material.metallicRoughnessTexture = defaultTexture;
-                            }
+            bool Model::dependsOn(const std::string &normalizedPath) const { return std::find(sourceFiles.begin(), sourceFiles.end(), normalizedPath) != sourceFiles.end(); }
+
+            void Model::swap(Model &other) {
+                std::swap(vertexBuffer, other.vertexBuffer);
+                std::swap(vertexFormat, other.vertexFormat);
+                std::swap(usesBindless, other.usesBindless);
+                std::swap(dequantization, other.dequantization);
+                std::swap(primitives, other.primitives);
+                std::swap(primitiveBounds, other.primitiveBounds);
+                std::swap(instances, other.instances);
+                std::swap(meshlets, other.meshlets);
+                std::swap(materials, other.materials);
+                std::swap(materialVariants, other.materialVariants);
+                std::swap(lodErrors, other.lodErrors);
+                std::swap(boundsCenter, other.boundsCenter);
+                std::swap(boundsRadius, other.boundsRadius);
+                std::swap(images, other.images);
+                std::swap(linearImages, other.linearImages);
+                std::swap(sourceFiles, other.sourceFiles);
+                std::swap(hasIndexBuffer, other.hasIndexBuffer);
+                std::swap(indexBuffer, other.indexBuffer);
+            }
+
+            Model::Model(Device &_device, const ModelInfo &info) : device{ _device }, vertexFormat{ info.vertex_format }, usesBindless{ info.bindless } {}
 
-                            VkDescriptorImageInfo albedo_info = {};
-                            albedo_info.sampler = material.albedoTexture->getSampler();
-                            albedo_info.imageView = material.albedoTexture->getImageView();
-                            albedo_info.imageLayout = material.albedoTexture->getImageLayout();
-
-                            VkDescriptorImageInfo normal_info = {};
-                            normal_info.sampler = material.normalTexture->getSampler();
-                            normal_info.imageView = material.normalTexture->getImageView();
-                            normal_info.imageLayout = material.normalTexture->getImageLayout();
-
-                            VkDescriptorImageInfo metallicRoughness_info = {};
-                            metallicRoughness_info.sampler = material.metallicRoughnessTexture->getSampler();
-                            metallicRoughness_info.imageView = material.metallicRoughnessTexture->getImageView();
-                            metallicRoughness_info.imageLayout = material.metallicRoughnessTexture->getImageLayout();
-
-                            DescriptorWriter(materialSetLayout, descriptorPool)
-                                .writeImage(0, &albedo_info)
-                                .writeImage(1, &normal_info)
-                                .writeImage(2, &metallicRoughness_info)
-                                .build(material.descriptorSet);
-
-                            Primitive primitive{};
-                            primitive.firstVertex = vertexOffset;
-                            primitive.vertexCount = vertexCount;
-                            primitive.indexCount = indexCount;
-                            primitive.firstIndex = indexOffset;
-                            primitive.material = material;
-                            primitives.push_back(primitive);
-
-                            vertexOffset += vertexCount;
-                            indexOffset += indexCount;
+            Model::Model(Device &_device, const std::string &filepath, DescriptorSetLayout &materialSetLayout, DescriptorAllocator &descriptorAllocator, const ModelInfo &info)
+                : device{ _device }, vertexFormat{ info.vertex_format }, usesBindless{ info.bindless } {
+                auto timer = TimingReport::shared().measure("model load");
+                auto path = std::filesystem::path{ filepath };
+                ThreadPool &threadPool = info.thread_pool ? *info.thread_pool : ThreadPool::shared();
+                sourceFiles.push_back(PackFile::normalize(filepath));
+
+                auto resolveImages = [&](const std::vector<std::string> &uris, const std::vector<std::vector<u8>> &embedded = {}) {
+                    std::vector<TextureSource> imageSources(uris.size());
+                    for (usize i = 0; i < uris.size(); i++) {
+                        imageSources[i].path = path.parent_path().append(uris[i]).generic_string();
+                        if (i < embedded.size() && !embedded[i].empty()) {
+                            imageSources[i].bytes = embedded[i].data();
+                            imageSources[i].size = embedded[i].size();
+                        } else {
+                            sourceFiles.push_back(PackFile::normalize(imageSources[i].path));
                         }
                     }
+                    return imageSources;
+                };
+
+                // image uris stay relative to the source, also for cooked meshes from the derived data cache
+                auto createFromCooked = [&](const CookedMesh &cooked) {
+                    const CookedMeshHeader &header = cooked.header();
+                    loadImages(resolveImages(cooked.image_uris()), cooked.materials(), header.material_count, threadPool);
+                    createMaterials(cooked.materials(), header.material_count, materialSetLayout, descriptorAllocator);
+                    createPrimitives(cooked.primitives(), header.primitive_count);
+                    createInstances(cooked.instances(), header.instance_count);
+                    createMeshlets(cooked.meshlets(), header.meshlet_count);
+                    createVertexBuffers(cooked.vertices(), header.vertex_count);
+                    createIndexBuffers(cooked.indices(), header.index_count);
+                    device.upload_manager().flush();
+                };
+
+                if (path.extension() == CookedMesh::EXTENSION) {
+                    createFromCooked(CookedMesh{ filepath });
+                    return;
+                }
+
+                if (!info.optimize && vertexFormat == VertexFormat::STANDARD) {
+                    // the source needs no processing or repacking, so accessors are read straight into the upload ring
+                    GltfImporter importer{ filepath };
+                    sourceFiles.insert(sourceFiles.end(), importer.dependencies().begin(), importer.dependencies().end());
+                    MeshData mesh{};
+                    importer.read_layout(mesh);
+
+                    loadImages(resolveImages(mesh.image_uris, mesh.embedded_images), mesh.materials.data(), static_cast<uint32_t>(mesh.materials.size()), threadPool);
+                    createMaterials(mesh.materials.data(), static_cast<uint32_t>(mesh.materials.size()), materialSetLayout, descriptorAllocator);
+                    createPrimitives(mesh.primitives.data(), static_cast<uint32_t>(mesh.primitives.size()));
+                    createInstances(mesh.instances.data(), static_cast<uint32_t>(mesh.instances.size()));
+                    createBuffers(importer);
+                    device.upload_manager().flush();
+                    return;
+                }
+
+                // the whole import is cached as a .vmesh, a hit skips the parse, optimization, lods and meshlets
+                DerivedDataCache &cache = DerivedDataCache::shared();
+                u64 key = HashBuilder{}.add_value(MODEL_IMPORT_VERSION).add_value(CookedMeshHeader::VERSION).add_value(info.optimize).add_value(GltfImporter::hash_sources(filepath, &sourceFiles)).get();
+                if (auto cached = cache.find("model", key)) {
+                    std::unique_ptr<CookedMesh> cooked;
+                    try {
+                        cooked = std::make_unique<CookedMesh>(cached->string());
+                    } catch (const std::exception &e) {
+                        std::cerr << "ignoring broken cache entry for " << filepath << ": " << e.what() << std::endl;
+                    }
+                    if (cooked) {
+                        createFromCooked(*cooked);
+                        return;
+                    }
+                }
 
-                    createVertexBuffers(vertices);
-                    createIndexBuffers(indices);
+                MeshData mesh = MeshData::import_gltf(filepath);
+                if (info.optimize) {
+                    VertexCacheStats before = analyze_vertex_cache(mesh);
+                    usize importedVertices = mesh.vertices.size();
+                    optimize_mesh(mesh);
+                    VertexCacheStats after = analyze_vertex_cache(mesh);
+                    generate_lods(mesh);
+                    build_meshlets(mesh);
+                    std::cout << filepath << ": " << importedVertices << " -> " << mesh.vertices.size() << " vertices, ACMR " << before.acmr << " -> " << after.acmr << ", ATVR "
+                              << before.atvr << " -> " << after.atvr << std::endl;
                 }
+                // a .vmesh has no room for embedded images, those imports are redone every time
+                if (std::all_of(mesh.embedded_images.begin(), mesh.embedded_images.end(), [](const std::vector<u8> &image) { return image.empty(); })) {
+                    std::vector<u8> blob = CookedMesh::serialize(mesh);
+                    cache.write("model", key, blob.data(), blob.size());
+                }
+
+                loadImages(resolveImages(mesh.image_uris, mesh.embedded_images), mesh.materials.data(), static_cast<uint32_t>(mesh.materials.size()), threadPool);
+                createMaterials(mesh.materials.data(), static_cast<uint32_t>(mesh.materials.size()), materialSetLayout, descriptorAllocator);
+                createPrimitives(mesh.primitives.data(), static_cast<uint32_t>(mesh.primitives.size()));
+                createInstances(mesh.instances.data(), static_cast<uint32_t>(mesh.instances.size()));
+                createMeshlets(mesh.meshlets.data(), static_cast<uint32_t>(mesh.meshlets.size()));
+                createVertexBuffers(mesh.vertices.data(), static_cast<uint32_t>(mesh.vertices.size()));
+                createIndexBuffers(mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()));
+                device.upload_manager().flush();
             }
         }
     }
@@ -4,18 +4,67 @@
 #include "device.hpp"
 #include "texture.hpp"
 #include "descriptors.hpp"
+#include "../core/thread_pool.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <array>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <filesystem>
 
 namespace VGED {
     namespace Engine {
         inline namespace Graphics {
+            struct MeshPrimitiveData;
+            struct MeshMeshletData;
+            struct MeshMaterialData;
+            struct MeshInstanceData;
+            class GltfImporter;
+
+            static constexpr u32 MAX_MESH_LODS = 6;
+
+            // optional textures a material has, selects the shader permutation drawing it
+            enum MaterialFeatureBits : u32 {
+                MATERIAL_FEATURE_NORMAL_MAP = 1,
+                MATERIAL_FEATURE_METALLIC_ROUGHNESS_MAP = 2,
+            };
+            static constexpr u32 MATERIAL_VARIANT_COUNT = 4; // every combination of MaterialFeatureBits
+
+            enum class VertexFormat : u32 {
+                STANDARD,  // Model::Vertex, full precision floats
+                COMPACT,   // Model::CompactVertex, octahedral normal/tangent and half float uv
+                QUANTIZED, // Model::QuantizedVertex, COMPACT with 16 bit positions relative to the mesh bounds
+            };
+
+            struct ModelInfo {
+                ThreadPool *thread_pool = nullptr; // decodes the images, defaults to ThreadPool::shared()
+                VertexFormat vertex_format = VertexFormat::STANDARD;
+                bool optimize = true; // weld, reorder, build lods and meshlets for glTF imports, cooked meshes are already optimized by the cooker
+                bool bindless = false; // registers the materials in the device's BindlessMaterials, needed for drawBindless
+            };
+
+            /**
+             * @brief View frustum and camera in a model's local space, used to cull its meshlets.
+             * Planes taken from projection * view * model are already in model space, which keeps
+             * the tests exact under non-uniform scale.
+             */
+            struct ModelCulling {
+                glm::vec4 planes[6]{}; // xyz normal, w distance, inside is positive
+                glm::vec3 cameraPosition{};
+
+                // filled by Model::draw
+                uint32_t meshletCount = 0;
+                uint32_t visibleMeshletCount = 0;
+                uint32_t drawCount = 0;
+
+                static ModelCulling fromMatrices(const glm::mat4 &modelViewProjection, const glm::mat4 &inverseModel, const glm::vec3 &cameraWorldPosition);
+                bool isSphereVisible(const glm::vec3 &center, float radius) const;
+            };
+
             class Model {
             public:
                 struct Material {
@@ -23,6 +72,22 @@ namespace VGED {
                     std::shared_ptr<Texture> normalTexture;
                     std::shared_ptr<Texture> metallicRoughnessTexture;
                     VkDescriptorSet descriptorSet;
+                    uint32_t features = 0; // MaterialFeatureBits, textures that are missing are bound as white.png
+                    uint32_t bindlessIndex = 0; // in the device's BindlessMaterials
+                };
+
+                struct Lod {
+                    uint32_t firstIndex;
+                    uint32_t indexCount;
+                };
+
+                struct Meshlet {
+                    uint32_t firstIndex;
+                    uint32_t indexCount;
+                    glm::vec3 center;
+                    float radius;
+                    glm::vec3 coneAxis;
+                    float coneCutoff;
                 };
 
                 struct Primitive {
@@ -31,6 +96,19 @@ namespace VGED {
                     uint32_t indexCount;
                     uint32_t vertexCount;
                     Material material;
+                    uint32_t lodCount = 1; // lods[0] is the full detail range above
+                    std::array<Lod, MAX_MESH_LODS> lods;
+                    uint32_t firstMeshlet = 0;
+                    uint32_t meshletCount = 0;
+                };
+
+                // primitives placed by a node of the source hierarchy, identity once the transform was baked by the cooker
+                struct Instance {
+                    glm::mat4 transform{ 1.f };
+                    glm::mat3 normalMatrix{ 1.f };
+                    uint32_t firstPrimitive = 0;
+                    uint32_t primitiveCount = 0;
+                    bool isIdentity = true;
                 };
 
                 struct Vertex {
@@ -44,26 +122,111 @@ namespace VGED {
 
                     static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 
-                    bool operator==(const Vertex &other) const { return position == other.position && color == other.color && normal == other.normal && uv == other.uv; }
+                    bool operator==(const Vertex &other) const { return position == other.position && color == other.color && normal == other.normal && tangent == other.tangent && uv == other.uv; }
+                };
+
+                // 24 bytes, color is dropped since it is always white
+                struct CompactVertex {
+                    glm::vec3 position{};
+                    i16 normal[2]{};  // octahedral, snorm
+                    i16 tangent[2]{}; // octahedral, lowest bit of [1] set when the bitangent is flipped
+                    u16 uv[2]{};      // half float
+                };
+
+                // 20 bytes, positions are unorm in the mesh bounds and expanded by getDequantization()
+                struct QuantizedVertex {
+                    u16 position[4]{};
+                    i16 normal[2]{};
+                    i16 tangent[2]{};
+                    u16 uv[2]{};
                 };
 
-                Model(Device &_device, const std::string &filepath, DescriptorSetLayout &setLayout, DescriptorPool &pool);
+                static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(VertexFormat format);
+                static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format);
+
+                /**
+                 * @brief Load a model from a .gltf or .glb file or from a mesh cooked by the model_cooker tool (.vmesh).
+                 * Cooked meshes are memory mapped and copied straight into the staging buffers, unoptimized glTF
+                 * imports in the STANDARD format have their accessors read straight into them.
+                 */
+                Model(Device &_device, const std::string &filepath, DescriptorSetLayout &setLayout, DescriptorAllocator &allocator, const ModelInfo &info = {});
+                /**
+                 * @brief Empty model without any geometry, binds and draws nothing. Used as placeholder while streaming.
+                 */
+                Model(Device &_device, const ModelInfo &info = {});
                 ~Model();
 
+                bool isEmpty() const { return vertexBuffer == nullptr; }
+
+                // the source file and every file it pulled in (buffers, images), normalized like VirtualFileSystem paths
+                const std::vector<std::string> &getSourceFiles() const { return sourceFiles; }
+                bool dependsOn(const std::string &normalizedPath) const;
+
+                /**
+                 * @brief Exchange everything but the device with other, so a reloaded model can take the place of this one
+                 * while references to it stay valid. Other then holds the old resources, keep it alive until the frames
+                 * that might still use them have retired.
+                 */
+                void swap(Model &other);
+
+                VertexFormat getVertexFormat() const { return vertexFormat; }
+                // maps QUANTIZED positions back into model space, identity for the other formats
+                const glm::mat4 &getDequantization() const { return dequantization; }
+
+                const std::vector<Instance> &getInstances() const { return instances; }
+
+                // model space bounding sphere, over all instances
+                const glm::vec3 &getBoundsCenter() const { return boundsCenter; }
+                float getBoundsRadius() const { return boundsRadius; }
+
+                // bit n is set when a material has the features n, the variants a renderer needs for this model
+                uint32_t getMaterialVariants() const { return materialVariants; }
+
+                uint32_t getLodCount() const { return static_cast<uint32_t>(lodErrors.size()); }
+                // worst model space deviation from full detail of any primitive at lod
+                float getLodError(uint32_t lod) const { return lodErrors[lod]; }
+
                 void bind(VkCommandBuffer commandBuffer);
-                void draw(VkCommandBuffer commandBuffer, VkDescriptorSet globalDescriptorSet, VkPipelineLayout pipelineLayout);
+                // draws the primitives of instance, its transform is pushed by the caller
+                // meshlets are culled against culling when given and drawing full detail, surviving neighbours merge into one draw
+                // materialPipelines, indexed by Material::features, are switched between primitives when given
+                void draw(VkCommandBuffer commandBuffer, VkDescriptorSet globalDescriptorSet, VkPipelineLayout pipelineLayout, const Instance &instance, uint32_t lod = 0, ModelCulling *culling = nullptr,
+                          const VkPipeline *materialPipelines = nullptr);
+                // for pipelines using the device's BindlessMaterials, bound once by the caller, primitives pick their material through firstInstance
+                // only for models loaded with ModelInfo::bindless
+                void drawBindless(VkCommandBuffer commandBuffer, const Instance &instance, uint32_t lod = 0, ModelCulling *culling = nullptr, const VkPipeline *materialPipelines = nullptr);
 
             private:
-                void createVertexBuffers(const std::vector<Vertex> &vertices);
-
-                void createIndexBuffers(const std::vector<uint32_t> &indices);
+                void drawPrimitives(VkCommandBuffer commandBuffer, VkDescriptorSet globalDescriptorSet, VkPipelineLayout pipelineLayout, const Instance &instance, uint32_t lod, ModelCulling *culling,
+                                    const VkPipeline *materialPipelines, bool bindless);
+                void loadImages(const std::vector<TextureSource> &sources, const MeshMaterialData *materials, uint32_t materialCount, ThreadPool &threadPool);
+                void createMaterials(const MeshMaterialData *materials, uint32_t materialCount, DescriptorSetLayout &setLayout, DescriptorAllocator &allocator);
+                void createPrimitives(const MeshPrimitiveData *meshPrimitives, uint32_t primitiveCount);
+                void createInstances(const MeshInstanceData *meshInstances, uint32_t instanceCount);
+                void createMeshlets(const MeshMeshletData *meshMeshlets, uint32_t meshletCount);
+                void createVertexBuffers(const Vertex *vertices, uint32_t vertexCount);
+
+                void createIndexBuffers(const uint32_t *indices, uint32_t indexCount);
+                // STANDARD layout only, vertices and indices are written by the importer into mapped staging memory
+                void createBuffers(const GltfImporter &importer);
 
                 std::unique_ptr<Buffer> vertexBuffer;
+                VertexFormat vertexFormat = VertexFormat::STANDARD;
+                bool usesBindless = false; // materials are registered in the device's BindlessMaterials
+                glm::mat4 dequantization{ 1.f };
 
-                std::vector<Vertex> vertices;
-                std::vector<uint32_t> indices;
                 std::vector<Primitive> primitives;
-                std::vector<std::shared_ptr<Texture>> images;
+                std::vector<std::pair<glm::vec3, glm::vec3>> primitiveBounds; // only until the instances are created
+                std::vector<Instance> instances;
+                std::vector<Meshlet> meshlets;
+                std::vector<Material> materials;
+                uint32_t materialVariants = 0;
+                std::vector<float> lodErrors{ 0.0f };
+                glm::vec3 boundsCenter{};
+                float boundsRadius = 0.0f;
+                std::vector<std::shared_ptr<Texture>> images;       // sRGB, for the images used as albedo
+                std::vector<std::shared_ptr<Texture>> linearImages; // UNORM, for normal and metallic roughness maps
+                std::vector<std::string> sourceFiles;
 
                 bool hasIndexBuffer = false;
                 std::unique_ptr<Buffer> indexBuffer;
@@ -1,17 +1,33 @@
 #include "pipeline.hpp"
+#include "pipeline_library.hpp"
+#include "../core/derived_data_cache.hpp"
+#include "../core/hash.hpp"
+#include "../core/timing_report.hpp"
+#include "../core/virtual_file_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <mutex>
 
 namespace VGED {
     namespace Engine {
         inline namespace Graphics {
+            // bump together with the shaderc version or the compile options, cached SPIR-V is otherwise reused as is
+            static constexpr u32 SPIRV_CACHE_VERSION = 3;
+            static constexpr shaderc_optimization_level SHADER_OPTIMIZATION_LEVEL = shaderc_optimization_level_performance;
+
             Result<std::filesystem::path> RasterPipeline::try_get_path_to_file(const std::filesystem::path &path) {
-                if (std::filesystem::exists(path)) {
+                if (VirtualFileSystem::shared().exists(path.string())) {
                     return { path };
                 }
                 std::filesystem::path potential_path;
                 for (auto &root : std::filesystem::directory_iterator(std::filesystem::current_path())) {
                     potential_path.clear();
                     potential_path = root / path;
-                    if (std::filesystem::exists(potential_path)) {
+                    if (VirtualFileSystem::shared().exists(potential_path.string())) {
                         return { potential_path };
                     }
                 }
@@ -23,27 +39,65 @@ namespace VGED {
             }
 
             Result<ShaderCode> RasterPipeline::try_read_file(const std::filesystem::path &path) {
-                std::string code;
-                std::ifstream in(path, std::ios::in | std::ios::binary);
-                if (in) {
-                    in.seekg(0, std::ios::end);
-                    size_t size = in.tellg();
-                    if (size != -1) {
-                        code.resize(size);
-                        in.seekg(0, std::ios::beg);
-                        in.read(&code[0], size);
-                    } else {
-                        return ResultErr{ .message = "File is empty!" };
-                    }
-                } else {
+                if (!VirtualFileSystem::shared().exists(path.string())) {
                     return ResultErr{ .message = "File couldn't be found!" };
                 }
-                return ShaderCode{ .code = code };
+                FileView file = VirtualFileSystem::shared().open(path.string());
+                if (file.size() == 0) {
+                    return ResultErr{ .message = "File is empty!" };
+                }
+                return ShaderCode{ .code = std::string{ file.string() } };
             }
 
-            Result<std::vector<u32>> RasterPipeline::compile_shader(const ShaderCode &code, VkShaderStageFlagBits shader_stage, const std::filesystem::path &path) {
-                shaderc::PreprocessedSourceCompilationResult pre_result = compiler.PreprocessGlsl(code.code, shaderc_fragment_shader, "", options);
+            void RasterPipeline::hash_includes(std::string_view code, HashBuilder &hash, std::vector<std::string> &visited, std::vector<std::string> &sources) {
+                usize line_start = 0;
+                while (line_start < code.size()) {
+                    usize line_end = code.find('\n', line_start);
+                    if (line_end == std::string_view::npos) {
+                        line_end = code.size();
+                    }
+                    std::string_view line = code.substr(line_start, line_end - line_start);
+                    line_start = line_end + 1;
+
+                    // #include "name" or #include <name>, spaces allowed around the #
+                    usize hash_sign = line.find_first_not_of(" \t");
+                    if (hash_sign == std::string_view::npos || line[hash_sign] != '#') {
+                        continue;
+                    }
+                    usize directive = line.find_first_not_of(" \t", hash_sign + 1);
+                    if (directive == std::string_view::npos || line.substr(directive, 7) != "include") {
+                        continue;
+                    }
+                    usize open = line.find_first_of("\"<", directive + 7);
+                    if (open == std::string_view::npos) {
+                        continue;
+                    }
+                    usize close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+                    if (close == std::string_view::npos) {
+                        continue;
+                    }
+
+                    std::string name{ line.substr(open + 1, close - open - 1) };
+                    std::string normal = PackFile::normalize(name);
+                    if (std::find(visited.begin(), visited.end(), normal) != visited.end()) {
+                        continue;
+                    }
+                    visited.push_back(normal);
+                    sources.push_back(normal);
+
+                    // resolved the same way ShaderIncluder does, includes inside disabled #if blocks are hashed too which only costs a spurious miss
+                    hash.add(name);
+                    if (!VirtualFileSystem::shared().exists(name)) {
+                        continue;
+                    }
+                    FileView include = VirtualFileSystem::shared().open(name);
+                    hash.add(include.data(), include.size());
+                    hash_includes(include.string(), hash, visited, sources);
+                }
+            }
 
+            Result<std::vector<u32>> RasterPipeline::compile_shader(const ShaderCode &code, VkShaderStageFlagBits shader_stage, const std::filesystem::path &path, const std::vector<ShaderDefine> &defines,
+                                                                    std::vector<std::string> &sources) {
                 shaderc_shader_kind shader_type = {};
                 if (shader_stage == VK_SHADER_STAGE_VERTEX_BIT) {
                     shader_type = shaderc_vertex_shader;
@@ -55,20 +109,60 @@ namespace VGED {
                     return ResultErr{ .message = "Wrong shader type" };
                 }
 
-                shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(pre_result.begin(), shader_type, path.c_str(), options);
+                // the key covers the source and every file it includes, so a warm cache never starts shaderc, not even the preprocessor
+                DerivedDataCache &cache = DerivedDataCache::shared();
+                u64 key = 0;
+                {
+                    auto timer = TimingReport::shared().measure("shader cache lookup");
+                    HashBuilder hash{};
+                    hash.add_value(SPIRV_CACHE_VERSION).add_value(shader_type).add_value(SHADER_OPTIMIZATION_LEVEL).add(code.code);
+                    hash.add_value(defines.size());
+                    for (auto &define : defines) {
+                        hash.add_value(define.name.size()).add(define.name).add_value(define.value.size()).add(define.value);
+                    }
+                    std::vector<std::string> visited;
+                    hash_includes(code.code, hash, visited, sources);
+                    key = hash.get();
+
+                    std::vector<u8> cached;
+                    if (cache.read("spirv", key, cached) && cached.size() % sizeof(u32) == 0) {
+                        std::vector<u32> spirv(cached.size() / sizeof(u32));
+                        std::memcpy(spirv.data(), cached.data(), cached.size());
+                        return spirv;
+                    }
+                }
+
+                auto timer = TimingReport::shared().measure("shader compile");
+                if (!compiler) {
+                    compiler = std::make_unique<shaderc::Compiler>();
+                    options = std::make_unique<shaderc::CompileOptions>();
+                    options->SetIncluder(std::make_unique<ShaderIncluder>());
+                    options->SetOptimizationLevel(SHADER_OPTIMIZATION_LEVEL);
+                }
+
+                // the copy keeps using the includer of options
+                shaderc::CompileOptions stage_options{ *options };
+                for (auto &define : defines) {
+                    stage_options.AddMacroDefinition(define.name, define.value);
+                }
 
+                shaderc::PreprocessedSourceCompilationResult pre_result = compiler->PreprocessGlsl(code.code, shader_type, path.string().c_str(), stage_options);
                 if (pre_result.GetNumErrors() > 0) {
                     return ResultErr{ .message = pre_result.GetErrorMessage() };
                 }
 
+                shaderc::SpvCompilationResult result = compiler->CompileGlslToSpv(pre_result.begin(), shader_type, path.string().c_str(), stage_options);
+
                 if (result.GetNumErrors() > 0) {
                     return ResultErr{ .message = result.GetErrorMessage() };
                 }
 
-                return std::vector<uint32_t>(result.cbegin(), result.cend());
+                std::vector<u32> spirv(result.cbegin(), result.cend());
+                cache.write("spirv", key, spirv.data(), spirv.size() * sizeof(u32));
+                return spirv;
             }
 
-            Result<std::vector<u32>> RasterPipeline::get_spirv(const ShaderInfo &shader_info, VkShaderStageFlagBits shader_stage) {
+            Result<std::vector<u32>> RasterPipeline::get_spirv(const ShaderInfo &shader_info, VkShaderStageFlagBits shader_stage, std::vector<std::string> &sources) {
                 std::vector<u32> spirv = {};
                 std::filesystem::path path = {};
                 if (shader_info.source.index() == 2) {
@@ -85,6 +179,7 @@ namespace VGED {
                             return ResultErr{ path_result.message() };
                         }
                         path = path_result.value();
+                        sources.push_back(PackFile::normalize(path.string()));
                         auto code_result = try_read_file(path_result.value());
                         if (code_result.is_err()) {
                             return ResultErr{ code_result.message() };
@@ -94,7 +189,7 @@ namespace VGED {
                         code = std::get<ShaderCode>(shader_info.source);
                     }
 
-                    auto compiled_spirv_result = compile_shader(code, shader_stage, path);
+                    auto compiled_spirv_result = compile_shader(code, shader_stage, path, shader_info.defines, sources);
                     if (compiled_spirv_result.is_err()) {
                         return ResultErr{ compiled_spirv_result.message() };
                     }
@@ -104,21 +199,55 @@ namespace VGED {
                 return spirv;
             }
 
-            RasterPipeline::RasterPipeline(Device &_device, const RasterPipelineInfo &_info) : device{ _device }, info{ _info } {
-                options.SetIncluder(std::make_unique<ShaderIncluder>());
-                options.SetOptimizationLevel(shaderc_optimization_level_performance);
+            // the constants are read straight out of shader_info, which outlives the pipeline creation
+            static const VkSpecializationInfo *fill_specialization(const ShaderInfo &shader_info, std::vector<VkSpecializationMapEntry> &entries, VkSpecializationInfo &specialization) {
+                if (shader_info.specialization.empty()) {
+                    return nullptr;
+                }
+                entries.resize(shader_info.specialization.size());
+                for (usize i = 0; i < entries.size(); i++) {
+                    entries[i] = {
+                        .constantID = shader_info.specialization[i].id,
+                        .offset = static_cast<u32>(i * sizeof(SpecializationConstant) + offsetof(SpecializationConstant, value)),
+                        .size = sizeof(u32),
+                    };
+                }
+                specialization = {
+                    .mapEntryCount = static_cast<u32>(entries.size()),
+                    .pMapEntries = entries.data(),
+                    .dataSize = shader_info.specialization.size() * sizeof(SpecializationConstant),
+                    .pData = shader_info.specialization.data(),
+                };
+                return &specialization;
+            }
+
+            // every pipeline alive, for hot reloading the ones built from a changed shader
+            static std::mutex live_pipelines_mutex;
+            static std::vector<RasterPipeline *> live_pipelines;
+
+            RasterPipeline::RasterPipeline(Device &_device, const RasterPipelineInfo &_info, VkPipelineLayout shared_layout)
+                : device{ _device }, info{ _info }, vk_pipeline_layout{ shared_layout }, owns_layout{ shared_layout == VK_NULL_HANDLE } {
+                vk_pipeline = create_pipeline();
+
+                std::lock_guard<std::mutex> lock{ live_pipelines_mutex };
+                live_pipelines.push_back(this);
+            }
 
-                auto v_spirv_result = get_spirv(info.vertex_shader_info, VK_SHADER_STAGE_VERTEX_BIT);
+            VkPipeline RasterPipeline::create_pipeline() {
+                // a failed reload keeps the old dependencies, so fixing the shader or an include still triggers the next one
+                std::vector<std::string> sources = {};
+                auto v_spirv_result = get_spirv(info.vertex_shader_info, VK_SHADER_STAGE_VERTEX_BIT, sources);
                 if (v_spirv_result.is_err()) {
-                    THROW(v_spirv_result.message());
+                    throw std::runtime_error(v_spirv_result.message());
                 }
                 std::vector<u32> v_spirv = v_spirv_result.value();
 
-                auto f_spirv_result = get_spirv(info.fragment_shader_info, VK_SHADER_STAGE_FRAGMENT_BIT);
+                auto f_spirv_result = get_spirv(info.fragment_shader_info, VK_SHADER_STAGE_FRAGMENT_BIT, sources);
                 if (f_spirv_result.is_err()) {
-                    THROW(f_spirv_result.message());
+                    throw std::runtime_error(f_spirv_result.message());
                 }
                 std::vector<u32> f_spirv = f_spirv_result.value();
+                source_files = std::move(sources);
 
                 VkShaderModule v_vk_shader_module = {};
                 VkShaderModule f_vk_shader_module = {};
@@ -141,6 +270,11 @@ namespace VGED {
 
                 vkCreateShaderModule(device.device(), &shader_module_fragment, nullptr, &f_vk_shader_module);
 
+                std::vector<VkSpecializationMapEntry> v_vk_specialization_entries;
+                std::vector<VkSpecializationMapEntry> f_vk_specialization_entries;
+                VkSpecializationInfo v_vk_specialization = {};
+                VkSpecializationInfo f_vk_specialization = {};
+
                 VkPipelineShaderStageCreateInfo vk_pipeline_shader_stage_create_infos[2] = {
                     VkPipelineShaderStageCreateInfo{
                         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -149,7 +283,7 @@ namespace VGED {
                         .stage = VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT,
                         .module = v_vk_shader_module,
                         .pName = "main",
-                        .pSpecializationInfo = nullptr,
+                        .pSpecializationInfo = fill_specialization(info.vertex_shader_info, v_vk_specialization_entries, v_vk_specialization),
                     },
                     VkPipelineShaderStageCreateInfo{
                         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -158,7 +292,7 @@ namespace VGED {
                         .stage = VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT,
                         .module = f_vk_shader_module,
                         .pName = "main",
-                        .pSpecializationInfo = nullptr,
+                        .pSpecializationInfo = fill_specialization(info.fragment_shader_info, f_vk_specialization_entries, f_vk_specialization),
                     },
                 };
 
@@ -258,24 +392,9 @@ namespace VGED {
                     .depthAttachmentFormat = static_cast<VkFormat>(info.depth_test.depth_attachment_format),
                 };
 
-                VkPushConstantRange vk_push_constant_range{
-                    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    .offset = 0,
-                    .size = info.pipeline_layout_info.push_constant_size
-                };
-
-                VkPipelineLayoutCreateInfo vk_pipeline_layout_create_info = {
-                    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-                    .pNext = 0,
-                    .flags = {},
-                    .setLayoutCount = static_cast<uint32_t>(info.pipeline_layout_info.vk_descriptor_set_layouts.size()),
-                    .pSetLayouts = info.pipeline_layout_info.vk_descriptor_set_layouts.data(),
-                    .pushConstantRangeCount = 1,
-                    .pPushConstantRanges = &vk_push_constant_range
-                };
-
-                if (vkCreatePipelineLayout(device.device(), &vk_pipeline_layout_create_info, nullptr, &vk_pipeline_layout) != VK_SUCCESS) {
-                    throw std::runtime_error("failed to create pipeline layout!");
+                // a reload only replaces the pipeline, the layout stays the same
+                if (vk_pipeline_layout == VK_NULL_HANDLE) {
+                    vk_pipeline_layout = create_pipeline_layout(device, info.pipeline_layout_info);
                 }
 
                 VkGraphicsPipelineCreateInfo vk_graphics_pipeline_create_info{
@@ -299,20 +418,132 @@ namespace VGED {
                     .basePipelineIndex = 0,
                 };
 
-                if (vkCreateGraphicsPipelines(device.device(), VK_NULL_HANDLE, 1, &vk_graphics_pipeline_create_info, nullptr, &vk_pipeline) != VK_SUCCESS) {
-                    THROW("failed to create graphics pipeline");
+                // core since 1.3, tells whether the driver found the pipeline in the cache
+                VkPipelineCreationFeedback vk_feedback = {};
+                VkPipelineCreationFeedbackCreateInfo vk_feedback_create_info = {
+                    .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+                    .pNext = nullptr,
+                    .pPipelineCreationFeedback = &vk_feedback,
+                    .pipelineStageCreationFeedbackCount = 0,
+                    .pPipelineStageCreationFeedbacks = nullptr,
+                };
+                vk_graphics_pipeline_create_info.pNext = &vk_feedback_create_info;
+
+                VkPipeline created = VK_NULL_HANDLE;
+                auto start = std::chrono::steady_clock::now();
+                VkResult result = vkCreateGraphicsPipelines(device.device(), device.pipeline_cache(), 1, &vk_graphics_pipeline_create_info, nullptr, &created);
+                f64 milliseconds = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (!(vk_feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT)) {
+                    TimingReport::shared().add("pipeline create", milliseconds);
+                } else if (vk_feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) {
+                    TimingReport::shared().add("pipeline cache hit", milliseconds);
+                } else {
+                    TimingReport::shared().add("pipeline cold create", milliseconds);
                 }
 
                 vkDestroyShaderModule(device.device(), v_vk_shader_module, nullptr);
                 vkDestroyShaderModule(device.device(), f_vk_shader_module, nullptr);
+
+                if (result != VK_SUCCESS) {
+                    THROW("failed to create graphics pipeline");
+                }
+                return created;
             }
 
             RasterPipeline::~RasterPipeline() {
+                {
+                    std::lock_guard<std::mutex> lock{ live_pipelines_mutex };
+                    std::erase(live_pipelines, this);
+                }
                 vkDestroyPipeline(device.device(), vk_pipeline, nullptr);
-                vkDestroyPipelineLayout(device.device(), vk_pipeline_layout, nullptr);
+                if (owns_layout) {
+                    vkDestroyPipelineLayout(device.device(), vk_pipeline_layout, nullptr);
+                }
+            }
+
+            VkPipelineLayout RasterPipeline::create_pipeline_layout(Device &device, const PipelineLayoutInfo &layout_info) {
+                VkPushConstantRange vk_push_constant_range{
+                    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                    .offset = 0,
+                    .size = layout_info.push_constant_size
+                };
+
+                VkPipelineLayoutCreateInfo vk_pipeline_layout_create_info = {
+                    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                    .pNext = 0,
+                    .flags = {},
+                    .setLayoutCount = static_cast<uint32_t>(layout_info.vk_descriptor_set_layouts.size()),
+                    .pSetLayouts = layout_info.vk_descriptor_set_layouts.data(),
+                    .pushConstantRangeCount = 1,
+                    .pPushConstantRanges = &vk_push_constant_range
+                };
+
+                VkPipelineLayout vk_pipeline_layout = VK_NULL_HANDLE;
+                if (vkCreatePipelineLayout(device.device(), &vk_pipeline_layout_create_info, nullptr, &vk_pipeline_layout) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create pipeline layout!");
+                }
+                return vk_pipeline_layout;
+            }
+
+            std::vector<PendingPipeline> RasterPipeline::create_async(Device &device, std::vector<RasterPipelineInfo> infos, ThreadPool &thread_pool) {
+                std::vector<PendingPipeline> pending;
+                pending.reserve(infos.size());
+                for (auto &info : infos) {
+                    pending.push_back(create_async(device, std::move(info), thread_pool));
+                }
+                return pending;
+            }
+
+            PendingPipeline RasterPipeline::create_async(Device &device, RasterPipelineInfo info, ThreadPool &thread_pool) {
+                return { thread_pool.submit([&device, info = std::move(info)]() { return std::make_unique<RasterPipeline>(device, info); }) };
+            }
+
+            PendingPipeline::~PendingPipeline() {
+                // taking the result destroys the pipeline here rather than on whichever thread releases the shared state last
+                if (future.valid()) {
+                    try {
+                        pipeline = future.get();
+                    } catch (const std::exception &) {
+                        // nobody asked for it, so nobody is told
+                    }
+                }
+            }
+
+            RasterPipeline &PendingPipeline::get() {
+                if (!pipeline) {
+                    pipeline = future.get();
+                }
+                return *pipeline;
+            }
+
+            bool RasterPipeline::depends_on(const std::string &normalized_path) const { return std::find(source_files.begin(), source_files.end(), normalized_path) != source_files.end(); }
+
+            bool RasterPipeline::reload(VkPipeline &retired) {
+                try {
+                    VkPipeline created = create_pipeline();
+                    retired = vk_pipeline;
+                    vk_pipeline = created;
+                    return true;
+                } catch (const std::exception &e) {
+                    // keep drawing with the last pipeline that compiled
+                    std::cerr << "failed to reload pipeline: " << e.what() << std::endl;
+                    return false;
+                }
+            }
+
+            std::vector<RasterPipeline *> RasterPipeline::dependents_of(const std::string &path) {
+                std::string normal = PackFile::normalize(path);
+                std::lock_guard<std::mutex> lock{ live_pipelines_mutex };
+                std::vector<RasterPipeline *> dependents;
+                for (RasterPipeline *pipeline : live_pipelines) {
+                    if (pipeline->depends_on(normal)) {
+                        dependents.push_back(pipeline);
+                    }
+                }
+                return dependents;
             }
 
-            void RasterPipeline::bind(VkCommandBuffer commandBuffer) { vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_pipeline); }
+            void RasterPipeline::bind(VkCommandBuffer commandBuffer) { device.pipeline_library().bind(commandBuffer, vk_pipeline); }
         }
     }
 }
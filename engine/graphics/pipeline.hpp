@@ -4,11 +4,16 @@
 #include "device.hpp"
 #include "model.hpp"
 #include "../core/debug.hpp"
+#include "../core/hash.hpp"
 #include "../core/result.hpp"
+#include "../core/thread_pool.hpp"
+#include "../core/virtual_file_system.hpp"
 
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <future>
+#include <memory>
 #include <variant>
 #include <fstream>
 
@@ -51,22 +56,14 @@ namespace VGED {
                 };
 
                 static std::string readFile(const std::string &filepath) {
-                    std::string code;
-                    std::ifstream in(filepath, std::ios::in | std::ios::binary);
-                    if (in) {
-                        in.seekg(0, std::ios::end);
-                        u32 size = static_cast<u32>(in.tellg());
-                        if (size != 0) {
-                            code.resize(size);
-                            in.seekg(0, std::ios::beg);
-                            in.read(&code[0], size);
-                        } else {
-                            THROW("File is empty!");
-                        }
-                    } else {
+                    if (!VirtualFileSystem::shared().exists(filepath)) {
                         THROW("Couldn't open a file!");
                     }
-                    return code;
+                    FileView file = VirtualFileSystem::shared().open(filepath);
+                    if (file.size() == 0) {
+                        THROW("File is empty!");
+                    }
+                    return std::string{ file.string() };
                 }
             };
 
@@ -85,8 +82,21 @@ namespace VGED {
 
             using ShaderSource = std::variant<ShaderFile, ShaderCode, ShaderSPIRV>;
 
+            struct ShaderDefine {
+                std::string name;
+                std::string value = "1";
+            };
+
+            // bool and int constants hold their value as is, float constants through std::bit_cast
+            struct SpecializationConstant {
+                u32 id; // layout(constant_id = id)
+                u32 value;
+            };
+
             struct ShaderInfo {
                 ShaderSource source;
+                std::vector<ShaderDefine> defines = {};                  // compiled in, every set of defines is its own SPIR-V
+                std::vector<SpecializationConstant> specialization = {}; // applied when the pipeline is created, the SPIR-V is shared
             };
 
             struct PipelineLayoutInfo {
@@ -111,32 +121,88 @@ namespace VGED {
                 VertexInput vertex_input = {};
             };
 
+            class RasterPipeline;
+
+            /**
+             * @brief Pipeline being built on a worker thread. get() waits for it the first time and rethrows
+             * whatever the build threw, destroying an unfinished one waits for the build to finish.
+             */
+            class PendingPipeline {
+            public:
+                PendingPipeline() = default;
+                PendingPipeline(std::future<std::unique_ptr<RasterPipeline>> _future) : future{ std::move(_future) } {}
+                ~PendingPipeline();
+
+                PendingPipeline(PendingPipeline &&) = default;
+                PendingPipeline &operator=(PendingPipeline &&) = default;
+
+                RasterPipeline &get();
+                bool is_ready() const { return pipeline || (future.valid() && future.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready); }
+                bool is_valid() const { return pipeline || future.valid(); }
+
+            private:
+                std::future<std::unique_ptr<RasterPipeline>> future = {};
+                std::unique_ptr<RasterPipeline> pipeline = {};
+            };
+
             class RasterPipeline {
             public:
-                RasterPipeline(Device &_device, const RasterPipelineInfo &_info);
+                // a shared layout, as handed out by PipelineLibrary::layout, is not destroyed with the pipeline
+                RasterPipeline(Device &_device, const RasterPipelineInfo &_info, VkPipelineLayout shared_layout = VK_NULL_HANDLE);
                 ~RasterPipeline();
 
                 RasterPipeline(const RasterPipeline &) = delete;
                 RasterPipeline &operator=(const RasterPipeline &) = delete;
 
+                // goes through the device's PipelineLibrary, which counts the binds
                 void bind(VkCommandBuffer commandBuffer);
 
                 VkPipeline &pipeline() { return vk_pipeline; }
                 VkPipelineLayout &pipeline_layout() { return vk_pipeline_layout; }
 
+                // shader files and includes the pipeline was built from, normalized like VirtualFileSystem paths
+                const std::vector<std::string> &sources() const { return source_files; }
+                bool depends_on(const std::string &normalized_path) const;
+
+                /**
+                 * @brief Rebuild the pipeline from its shader files, the layout is kept. On success the previous pipeline is
+                 * handed out through retired and must be destroyed once no frame in flight uses it, on failure nothing changes.
+                 */
+                bool reload(VkPipeline &retired);
+
+                // live pipelines built from the shader file or include at path
+                static std::vector<RasterPipeline *> dependents_of(const std::string &path);
+
+                /**
+                 * @brief Compile the shaders of and create every pipeline in infos concurrently on thread_pool, in the order given.
+                 * Layouts and render passes the infos refer to have to outlive the builds.
+                 */
+                static std::vector<PendingPipeline> create_async(Device &device, std::vector<RasterPipelineInfo> infos, ThreadPool &thread_pool = ThreadPool::shared());
+                static PendingPipeline create_async(Device &device, RasterPipelineInfo info, ThreadPool &thread_pool = ThreadPool::shared());
+
+                static VkPipelineLayout create_pipeline_layout(Device &device, const PipelineLayoutInfo &layout_info);
+
             private:
-                Result<std::vector<u32>> get_spirv(const ShaderInfo &shader_info, VkShaderStageFlagBits shader_stage);
+                VkPipeline create_pipeline();
+                // files the shader was read from are appended to sources
+                Result<std::vector<u32>> get_spirv(const ShaderInfo &shader_info, VkShaderStageFlagBits shader_stage, std::vector<std::string> &sources);
                 Result<std::filesystem::path> try_get_path_to_file(const std::filesystem::path &path);
                 Result<ShaderCode> try_read_file(const std::filesystem::path &path);
-                Result<std::vector<u32>> compile_shader(const ShaderCode &code, VkShaderStageFlagBits shader_stage, const std::filesystem::path &path);
+                Result<std::vector<u32>> compile_shader(const ShaderCode &code, VkShaderStageFlagBits shader_stage, const std::filesystem::path &path, const std::vector<ShaderDefine> &defines,
+                                                        std::vector<std::string> &sources);
+                // adds every file code includes, recursively, to hash and sources
+                void hash_includes(std::string_view code, HashBuilder &hash, std::vector<std::string> &visited, std::vector<std::string> &sources);
 
-                shaderc::Compiler compiler;
-                shaderc::CompileOptions options;
+                // only created once a shader misses the SPIR-V cache
+                std::unique_ptr<shaderc::Compiler> compiler;
+                std::unique_ptr<shaderc::CompileOptions> options;
 
                 Device &device;
                 RasterPipelineInfo info;
                 VkPipeline vk_pipeline = {};
                 VkPipelineLayout vk_pipeline_layout = {};
+                bool owns_layout = true;
+                std::vector<std::string> source_files = {};
             };
         }
     }
@@ -0,0 +1,151 @@
+#include "pipeline_library.hpp"
+#include "../core/hash.hpp"
+
+#include <algorithm>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            PipelineLibrary::PipelineLibrary(Device &_device, ThreadPool &_thread_pool) : device{ _device }, thread_pool{ _thread_pool } {}
+
+            PipelineLibrary::~PipelineLibrary() {
+                // waits for unfinished builds, they still use the layouts
+                pipelines.clear();
+                for (auto &[key, vk_pipeline_layout] : layouts) {
+                    vkDestroyPipelineLayout(device.device(), vk_pipeline_layout, nullptr);
+                }
+                set_layouts.clear();
+            }
+
+            static void hash_shader(HashBuilder &hash, const ShaderInfo &shader_info) {
+                hash.add_value(shader_info.source.index());
+                if (auto file = std::get_if<ShaderFile>(&shader_info.source)) {
+                    hash.add(PackFile::normalize(file->path.string()));
+                } else if (auto code = std::get_if<ShaderCode>(&shader_info.source)) {
+                    hash.add(code->code);
+                } else {
+                    const ShaderSPIRV &spirv = std::get<ShaderSPIRV>(shader_info.source);
+                    hash.add(spirv.data, spirv.size * sizeof(u32));
+                }
+                hash.add_value(shader_info.defines.size());
+                for (auto &define : shader_info.defines) {
+                    hash.add(define.name).add(define.value);
+                }
+                hash.add(shader_info.specialization.data(), shader_info.specialization.size() * sizeof(SpecializationConstant));
+            }
+
+            u64 PipelineLibrary::hash(const PipelineLayoutInfo &info) {
+                HashBuilder hash{};
+                hash.add_value(info.push_constant_size);
+                hash.add(info.vk_descriptor_set_layouts.data(), info.vk_descriptor_set_layouts.size() * sizeof(VkDescriptorSetLayout));
+                return hash.get();
+            }
+
+            u64 PipelineLibrary::hash(const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings, const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &binding_flags) {
+                // map order depends on insertion, the key must not
+                std::vector<VkDescriptorSetLayoutBinding> sorted{};
+                sorted.reserve(bindings.size());
+                for (auto &[binding, layout_binding] : bindings) {
+                    sorted.push_back(layout_binding);
+                }
+                std::sort(sorted.begin(), sorted.end(), [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b) { return a.binding < b.binding; });
+
+                HashBuilder hash{};
+                hash.add_value(sorted.size());
+                for (auto &layout_binding : sorted) {
+                    auto flags = binding_flags.find(layout_binding.binding);
+                    hash.add_value(layout_binding.binding).add_value(layout_binding.descriptorType).add_value(layout_binding.descriptorCount).add_value(layout_binding.stageFlags);
+                    hash.add_value(flags != binding_flags.end() ? flags->second : VkDescriptorBindingFlags{ 0 });
+                }
+                return hash.get();
+            }
+
+            u64 PipelineLibrary::hash(const RasterPipelineInfo &info) {
+                HashBuilder hash{};
+                hash_shader(hash, info.vertex_shader_info);
+                hash_shader(hash, info.fragment_shader_info);
+                hash_shader(hash, info.geometry_shader_info);
+
+                // every member of RenderAttachment is 4 bytes, there is no padding to hash
+                hash.add(info.color_attachments.data(), info.color_attachments.size() * sizeof(RenderAttachment));
+                // the depth and raster state hold bools, so their members are hashed one by one
+                hash.add_value(info.depth_test.depth_attachment_format).add_value(info.depth_test.enable_depth_test).add_value(info.depth_test.enable_depth_write);
+                hash.add_value(info.depth_test.depth_test_compare_op).add_value(info.depth_test.min_depth_bounds).add_value(info.depth_test.max_depth_bounds);
+                hash.add_value(info.raster.polygon_mode).add_value(info.raster.face_culling).add_value(info.raster.depth_clamp_enable).add_value(info.raster.rasterizer_discard_enable);
+                hash.add_value(info.raster.depth_bias_enable).add_value(info.raster.depth_bias_constant_factor).add_value(info.raster.depth_bias_clamp);
+                hash.add_value(info.raster.depth_bias_slope_factor).add_value(info.raster.line_width);
+
+                hash.add_value(info.vk_render_pass);
+                hash.add_value(PipelineLibrary::hash(info.pipeline_layout_info));
+                hash.add(info.vertex_input.binding.data(), info.vertex_input.binding.size() * sizeof(VkVertexInputBindingDescription));
+                hash.add(info.vertex_input.attribute.data(), info.vertex_input.attribute.size() * sizeof(VkVertexInputAttributeDescription));
+                return hash.get();
+            }
+
+            VkPipelineLayout PipelineLibrary::layout(const PipelineLayoutInfo &info) {
+                u64 key = hash(info);
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto it = layouts.find(key);
+                if (it != layouts.end()) {
+                    return it->second;
+                }
+                VkPipelineLayout vk_pipeline_layout = RasterPipeline::create_pipeline_layout(device, info);
+                layouts.emplace(key, vk_pipeline_layout);
+                return vk_pipeline_layout;
+            }
+
+            std::shared_ptr<DescriptorSetLayout> PipelineLibrary::descriptor_set_layout(const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+                                                                                         const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &binding_flags) {
+                u64 key = hash(bindings, binding_flags);
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto it = set_layouts.find(key);
+                if (it != set_layouts.end()) {
+                    return it->second;
+                }
+                auto set_layout = std::make_shared<DescriptorSetLayout>(device, bindings, binding_flags);
+                set_layouts.emplace(key, set_layout);
+                return set_layout;
+            }
+
+            PendingPipeline &PipelineLibrary::acquire(const RasterPipelineInfo &info) {
+                u64 key = hash(info);
+                VkPipelineLayout vk_pipeline_layout = layout(info.pipeline_layout_info);
+
+                std::lock_guard<std::mutex> lock{ mutex };
+                requests++;
+                auto it = pipelines.find(key);
+                if (it != pipelines.end()) {
+                    return *it->second;
+                }
+                auto pending = std::make_unique<PendingPipeline>(thread_pool.submit([this, info, vk_pipeline_layout]() { return std::make_unique<RasterPipeline>(device, info, vk_pipeline_layout); }));
+                return *pipelines.emplace(key, std::move(pending)).first->second;
+            }
+
+            void PipelineLibrary::bind(VkCommandBuffer command_buffer, VkPipeline pipeline) {
+                frame.binds++;
+                if (command_buffer != bound_command_buffer || pipeline != bound_pipeline) {
+                    frame.bind_switches++;
+                    bound_command_buffer = command_buffer;
+                    bound_pipeline = pipeline;
+                }
+                vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            }
+
+            const PipelineStats &PipelineLibrary::end_frame() {
+                {
+                    std::lock_guard<std::mutex> lock{ mutex };
+                    frame.unique_pipelines = static_cast<u32>(pipelines.size());
+                    frame.unique_layouts = static_cast<u32>(layouts.size());
+                    frame.unique_set_layouts = static_cast<u32>(set_layouts.size());
+                    frame.requests = requests;
+                }
+                last_frame = frame;
+                frame = {};
+                // the next frame records into a freshly begun command buffer
+                bound_command_buffer = VK_NULL_HANDLE;
+                bound_pipeline = VK_NULL_HANDLE;
+                return last_frame;
+            }
+        }
+    }
+}
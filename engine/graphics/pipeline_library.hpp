@@ -0,0 +1,80 @@
+#pragma once
+
+#include "descriptors.hpp"
+#include "pipeline.hpp"
+#include "../core/thread_pool.hpp"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            struct PipelineStats {
+                u32 unique_pipelines = 0;
+                u32 unique_layouts = 0;
+                u32 unique_set_layouts = 0;
+                u32 requests = 0;      // acquire calls, every one beyond unique_pipelines was shared
+                u32 binds = 0;         // pipeline binds recorded through the library
+                u32 bind_switches = 0; // binds that changed the bound pipeline
+            };
+
+            /**
+             * @brief Owns every pipeline and pipeline layout, keyed by a hash of the full state that creates them.
+             * Systems asking for the same shaders, defines, blend, depth, raster, formats and layout share one
+             * pipeline, and pipelines with the same layout info share one VkPipelineLayout. Descriptor set layouts
+             * are shared the same way, which also keeps the pipeline layout keys equal for equal bindings.
+             */
+            class PipelineLibrary {
+            public:
+                PipelineLibrary(Device &_device, ThreadPool &_thread_pool = ThreadPool::shared());
+                ~PipelineLibrary();
+
+                PipelineLibrary(const PipelineLibrary &) = delete;
+                PipelineLibrary &operator=(const PipelineLibrary &) = delete;
+
+                static u64 hash(const RasterPipelineInfo &info);
+                static u64 hash(const PipelineLayoutInfo &info);
+                static u64 hash(const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings, const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &binding_flags);
+
+                /**
+                 * @brief Pipeline built from info, started on the thread pool the first time its state is asked for.
+                 * The reference stays valid as long as the library. Safe to call from any thread, get() it on the render thread.
+                 */
+                PendingPipeline &acquire(const RasterPipelineInfo &info);
+                VkPipelineLayout layout(const PipelineLayoutInfo &info);
+                /**
+                 * @brief Set layout for the bindings, created once per distinct binding set and kept until the library is destroyed.
+                 * Used by DescriptorSetLayout::Builder::build, safe to call from any thread.
+                 */
+                std::shared_ptr<DescriptorSetLayout> descriptor_set_layout(const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+                                                                           const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &binding_flags);
+
+                // render thread only, counts towards the frame's binds and switches
+                void bind(VkCommandBuffer command_buffer, VkPipeline pipeline);
+
+                /**
+                 * @brief Roll the per frame bind counters over, call once per frame after recording the draws.
+                 */
+                const PipelineStats &end_frame();
+                const PipelineStats &last_frame_stats() const { return last_frame; }
+
+            private:
+                Device &device;
+                ThreadPool &thread_pool;
+
+                std::mutex mutex;
+                std::unordered_map<u64, std::unique_ptr<PendingPipeline>> pipelines;
+                std::unordered_map<u64, VkPipelineLayout> layouts;
+                std::unordered_map<u64, std::shared_ptr<DescriptorSetLayout>> set_layouts;
+                u32 requests = 0;
+
+                VkCommandBuffer bound_command_buffer = VK_NULL_HANDLE;
+                VkPipeline bound_pipeline = VK_NULL_HANDLE;
+                PipelineStats frame = {};
+                PipelineStats last_frame = {};
+            };
+        }
+    }
+}
@@ -4,6 +4,7 @@
 // std
 #include <array>
 #include <cassert>
+#include <mutex>
 #include <stdexcept>
 
 namespace VGED {
@@ -12,6 +13,13 @@ namespace VGED {
             Renderer::Renderer(Window &_window, Device &_device) : window{ _window }, device{ _device } {
                 recreateSwapChain();
                 createCommandBuffers();
+                for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+                    frameDescriptorAllocators.push_back(std::make_unique<DescriptorAllocator>(device, std::vector<DescriptorAllocator::PoolSizeRatio>{
+                                                                                                           { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+                                                                                                           { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f },
+                                                                                                           { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+                                                                                                       }));
+                }
             }
 
             Renderer::~Renderer() { freeCommandBuffers(); }
@@ -22,7 +30,10 @@ namespace VGED {
                     extent = window.get_extent();
                     glfwWaitEvents();
                 }
-                vkDeviceWaitIdle(device.device());
+                {
+                    std::lock_guard<std::mutex> lock{ device.queue_mutex() };
+                    vkDeviceWaitIdle(device.device());
+                }
 
                 if (swap_chain == nullptr) {
                     swap_chain = std::make_unique<SwapChain>(device, extent);
@@ -69,6 +80,8 @@ namespace VGED {
                 }
 
                 isFrameStarted = true;
+                // acquiring waited for this frame index's fence, nothing in flight uses its sets anymore
+                frameDescriptorAllocators[currentFrameIndex]->resetPools();
 
                 auto commandBuffer = getCurrentCommandBuffer();
                 VkCommandBufferBeginInfo beginInfo{};
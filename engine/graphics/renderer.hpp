@@ -1,5 +1,6 @@
 #pragma once
 
+#include "descriptors.hpp"
 #include "device.hpp"
 #include "swap_chain.hpp"
 #include "../core/window.hpp"
@@ -35,6 +36,15 @@ namespace VGED {
                     return currentFrameIndex;
                 }
 
+                /**
+                 * @brief Descriptor sets that only live for the current frame. The frame's pools are reset in one go once
+                 * its fence signaled, when beginFrame next hands out the same frame index.
+                 */
+                DescriptorAllocator &getFrameDescriptorAllocator() {
+                    assert(isFrameStarted && "Cannot get frame descriptors when frame not in progress");
+                    return *frameDescriptorAllocators[currentFrameIndex];
+                }
+
                 VkCommandBuffer beginFrame();
                 void endFrame();
                 void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
@@ -49,6 +59,7 @@ namespace VGED {
                 Device &device;
                 std::unique_ptr<SwapChain> swap_chain;
                 std::vector<VkCommandBuffer> commandBuffers;
+                std::vector<std::unique_ptr<DescriptorAllocator>> frameDescriptorAllocators;
 
                 uint32_t currentImageIndex;
                 int currentFrameIndex{ 0 };
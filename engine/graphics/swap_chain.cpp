@@ -8,6 +8,7 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <stdexcept>
 
@@ -94,6 +95,7 @@ namespace VGED {
                 submitInfo.pSignalSemaphores = signalSemaphores;
 
                 vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
+                std::lock_guard<std::mutex> lock{ device.queue_mutex() };
                 if (vkQueueSubmit(device.graphics_queue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
                     throw std::runtime_error("failed to submit draw command buffer!");
                 }
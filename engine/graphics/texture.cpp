@@ -6,30 +6,152 @@
 #include "stb_image.h"
 #include <cmath>
 #include "buffer.hpp"
+#include "upload_manager.hpp"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include "../core/derived_data_cache.hpp"
+#include "../core/hash.hpp"
+#include "../core/virtual_file_system.hpp"
 
 namespace VGED {
     namespace Engine {
         inline namespace Graphics {
-            Texture::Texture(Device &_device, const std::string &filepath) : device{ _device } {
+            // bump when TextureData::import produces different data for the same source
+            static constexpr u32 TEXTURE_IMPORT_VERSION = 1;
+
+            void PixelDeleter::operator()(u8 *pixels) const { stbi_image_free(pixels); }
+
+            TextureData TextureData::load(const std::string &filepath) {
+                TextureData data{};
+                data.path = filepath;
+
+                if (std::filesystem::path{ filepath }.extension() == CookedTexture::EXTENSION) {
+                    data.cooked = std::make_unique<CookedTexture>(filepath);
+                    data.width = static_cast<i32>(data.cooked->header().width);
+                    data.height = static_cast<i32>(data.cooked->header().height);
+                    return data;
+                }
+
+                FileView file = VirtualFileSystem::shared().open(filepath);
+                return decode(filepath, file.data(), file.size());
+            }
+
+            TextureData TextureData::decode(const std::string &name, const u8 *bytes, usize size) {
+                TextureData data{};
+                data.path = name;
+
                 int channels;
-                int m_BytesPerPixel;
+                data.pixels.reset(stbi_load_from_memory(bytes, static_cast<int>(size), &data.width, &data.height, &channels, 4));
+                if (!data.pixels) {
+                    throw std::runtime_error("failed to decode texture: " + name);
+                }
+                return data;
+            }
 
-                auto data = stbi_load(filepath.c_str(), &width, &height, &m_BytesPerPixel, 4);
+            TextureData TextureData::import(const TextureSource &source, const TextureInfo &info) {
+                if (!source.bytes && std::filesystem::path{ source.path }.extension() == CookedTexture::EXTENSION) {
+                    return load(source.path);
+                }
 
-                mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+                FileView file;
+                const u8 *bytes = source.bytes;
+                usize size = source.size;
+                if (!bytes) {
+                    file = VirtualFileSystem::shared().open(source.path);
+                    bytes = file.data();
+                    size = file.size();
+                }
 
-                //Buffer stagingBuffer{ device.device(), device.allocator(), 4, static_cast<uint32_t>(width * height), MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE };
+                DerivedDataCache &cache = DerivedDataCache::shared();
+                u64 key = HashBuilder{}.add_value(TEXTURE_IMPORT_VERSION).add_value(CookedTextureHeader::VERSION).add_value(info.srgb).add(bytes, size).get();
+                if (auto cached = cache.find("texture", key)) {
+                    try {
+                        TextureData data{};
+                        data.path = source.path;
+                        data.cooked = std::make_unique<CookedTexture>(cached->string());
+                        data.width = static_cast<i32>(data.cooked->header().width);
+                        data.height = static_cast<i32>(data.cooked->header().height);
+                        return data;
+                    } catch (const std::exception &e) {
+                        std::cerr << "ignoring broken cache entry for " << source.path << ": " << e.what() << std::endl;
+                    }
+                }
+
+                TextureData decoded = decode(source.path, bytes, size);
+                // the decode already runs on a pool worker, the mip chain is built inline there
+                CookedTextureData mips = cook_texture(decoded.pixels.get(), static_cast<u32>(decoded.width), static_cast<u32>(decoded.height), { .encoding = TextureEncoding::RGBA8, .srgb = info.srgb });
+                std::vector<u8> blob = CookedTexture::serialize(mips);
+                cache.write("texture", key, blob.data(), blob.size());
+
+                // upload the chain just built like a cache hit would, instead of blitting the same mips again on the GPU
+                TextureData data{};
+                data.path = source.path;
+                data.cooked = std::make_unique<CookedTexture>(std::move(blob), source.path);
+                data.width = static_cast<i32>(data.cooked->header().width);
+                data.height = static_cast<i32>(data.cooked->header().height);
+                return data;
+            }
 
-                Buffer stagingBuffer{ device.device(), device.allocator(), BufferInfo {
-                    .instance_size = sizeof(u8) * 4,
-                    .instance_count = static_cast<uint32_t>(width * height),
-                    .memory_flags = MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE
-                }};
+            TextureUploadBatch::TextureUploadBatch(Device &_device) : device{ _device } {}
 
-                stagingBuffer.map();
-                stagingBuffer.write_to_buffer(data);
+            TextureUploadBatch::~TextureUploadBatch() { submit(); }
 
-                imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+            VkCommandBuffer TextureUploadBatch::stage(const void *data, VkDeviceSize size, VkBuffer &staging_buffer, VkDeviceSize &staging_offset) {
+                UploadStaging staging = device.upload_manager().stage(size);
+                std::memcpy(staging.mapped, data, size);
+                staging_buffer = staging.buffer;
+                staging_offset = staging.offset;
+                staged = true;
+                return staging.command_buffer;
+            }
+
+            u64 TextureUploadBatch::submit() {
+                if (!staged) {
+                    return 0;
+                }
+                staged = false;
+                return device.upload_manager().flush();
+            }
+
+            Texture::Texture(Device &_device, const std::string &filepath, const TextureInfo &info) : Texture(_device, TextureData::import({ .path = filepath }, info), info) {}
+
+            Texture::Texture(Device &_device, const TextureData &data, const TextureInfo &info) : device{ _device } {
+                TextureUploadBatch batch{ device };
+                VkBuffer stagingBuffer;
+                VkDeviceSize stagingOffset;
+                VkCommandBuffer commandBuffer = batch.stage(data.bytes(), data.size(), stagingBuffer, stagingOffset);
+                createImage(data, info);
+                recordUpload(commandBuffer, stagingBuffer, stagingOffset, data);
+                batch.submit();
+            }
+
+            Texture::Texture(Device &_device, const TextureData &data, TextureUploadBatch &batch, const TextureInfo &info) : device{ _device } {
+                VkBuffer stagingBuffer;
+                VkDeviceSize stagingOffset;
+                VkCommandBuffer commandBuffer = batch.stage(data.bytes(), data.size(), stagingBuffer, stagingOffset);
+                createImage(data, info);
+                recordUpload(commandBuffer, stagingBuffer, stagingOffset, data);
+            }
+
+            Texture::~Texture() {
+                device.destroy_image(image_id);
+                device.destroy_sampler(sampler_id);
+            }
+
+            void Texture::createImage(const TextureData &data, const TextureInfo &info) {
+                width = data.width;
+                height = data.height;
+                if (data.cooked) {
+                    mipLevels = static_cast<int>(data.cooked->header().level_count);
+                    imageFormat = static_cast<VkFormat>(data.cooked->header().format);
+                    if (imageFormat >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && imageFormat <= VK_FORMAT_BC7_SRGB_BLOCK && !device.supports_bc_textures()) {
+                        throw std::runtime_error("texture is BC compressed, but the GPU has no BC support: " + data.path);
+                    }
+                } else {
+                    mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+                    imageFormat = info.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+                }
 
                 auto [image, img_id] = device.create_image({ .format = static_cast<ImageFormat>(imageFormat),
                                                              .size = { width, height, 1 },
@@ -38,12 +160,6 @@ namespace VGED {
                                                              .memory_flags = MemoryFlagBits::DEDICATED_MEMORY });
 
                 image_id = img_id;
-
-                transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-                device.copy_buffer_to_image(stagingBuffer.get_buffer(), image->image(), static_cast<uint>(width), static_cast<uint>(height), 1);
-
-                generateMipmaps();
                 imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
                 auto [sampler, sampler_id_] = device.create_sampler({
@@ -56,18 +172,53 @@ namespace VGED {
                 });
 
                 sampler_id = sampler_id_;
-
-                stbi_image_free(data);
             }
 
-            Texture::~Texture() {
-                device.destroy_image(image_id);
-                device.destroy_sampler(sampler_id);
-            }
+            void Texture::recordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, VkDeviceSize stagingOffset, const TextureData &data) {
+                transitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+                // cooked textures bring their whole mip chain, copy every level instead of blitting
+                if (data.cooked) {
+                    const CookedTextureHeader &header = data.cooked->header();
+                    std::vector<VkBufferImageCopy> regions(header.level_count);
+                    for (uint32_t level = 0; level < header.level_count; level++) {
+                        regions[level] = {
+                            .bufferOffset = stagingOffset + header.levels[level].offset - header.levels[0].offset,
+                            .bufferRowLength = 0,
+                            .bufferImageHeight = 0,
+                            .imageSubresource = {
+                                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                .mipLevel = level,
+                                .baseArrayLayer = 0,
+                                .layerCount = 1 },
+                            .imageOffset = { .x = 0, .y = 0, .z = 0 },
+                            .imageExtent = { .width = header.levels[level].width, .height = header.levels[level].height, .depth = 1 },
+                        };
+                    }
+                    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, device.get_image(image_id)->image(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+                    transitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                    return;
+                }
 
-            void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout) {
-                VkCommandBuffer commandBuffer = device.begin_single_time_commands();
+                VkBufferImageCopy region = {
+                    .bufferOffset = stagingOffset,
+                    .bufferRowLength = 0,
+                    .bufferImageHeight = 0,
+                    .imageSubresource = {
+                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                        .mipLevel = 0,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1 },
+                    .imageOffset = { .x = 0, .y = 0, .z = 0 },
+                    .imageExtent = { .width = static_cast<u32>(width), .height = static_cast<u32>(height), .depth = 1 },
+                };
+                vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, device.get_image(image_id)->image(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+                generateMipmaps(commandBuffer);
+            }
 
+            void Texture::transitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) {
                 auto vk_image = device.get_image(image_id)->image();
 
                 VkImageMemoryBarrier barrier{};
@@ -103,11 +254,9 @@ namespace VGED {
                 }
 
                 vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-                device.end_single_time_commands(commandBuffer);
             }
 
-            void Texture::generateMipmaps() {
+            void Texture::generateMipmaps(VkCommandBuffer commandBuffer) {
                 VkFormatProperties formatProperties;
                 vkGetPhysicalDeviceFormatProperties(device.physical_device(), imageFormat, &formatProperties);
 
@@ -115,8 +264,6 @@ namespace VGED {
                     throw std::runtime_error("texture image format does not support linear blitting!");
                 }
 
-                VkCommandBuffer commandBuffer = device.begin_single_time_commands();
-
                 auto vk_image = device.get_image(image_id)->image();
 
                 VkImageMemoryBarrier barrier{};
@@ -177,8 +324,6 @@ namespace VGED {
                 barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
                 vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-                device.end_single_time_commands(commandBuffer);
             }
         }
     }
@@ -1,15 +1,84 @@
 #pragma once
 
 #include "device.hpp"
+#include "buffer.hpp"
 #include "image.hpp"
+#include "cooked_texture.hpp"
 #include <string.h>
 
+#include <memory>
+#include <vector>
+
 namespace VGED {
     namespace Engine {
         inline namespace Graphics {
+            struct PixelDeleter {
+                void operator()(u8 *pixels) const;
+            };
+
+            struct TextureInfo {
+                bool srgb = true; // color data, false for normal maps and other linear data. Cooked textures carry their own format
+            };
+
+            // image file on disk, or encoded image bytes embedded in another file, path then only names it
+            struct TextureSource {
+                std::string path = {};
+                const u8 *bytes = nullptr;
+                usize size = 0;
+            };
+
+            /**
+             * @brief Decoded RGBA8 pixels of an image file, or the mapped mip chain of a cooked .vtex. Loading only
+             * touches the CPU, so this can be produced on any thread and uploaded later.
+             */
+            struct TextureData {
+                std::string path = {};
+                i32 width = 0;
+                i32 height = 0;
+                std::unique_ptr<u8, PixelDeleter> pixels = {};
+                std::unique_ptr<CookedTexture> cooked = {};
+
+                static TextureData load(const std::string &filepath);
+                // png, jpg, ... already in memory, e.g. an image embedded in a .glb
+                static TextureData decode(const std::string &name, const u8 *bytes, usize size);
+                static TextureData load(const TextureSource &source) { return source.bytes ? decode(source.path, source.bytes, source.size) : load(source.path); }
+                /**
+                 * @brief load through the DerivedDataCache. A hit maps a full RGBA8 mip chain built on the CPU, so neither
+                 * the decode nor the mip generation runs again. A miss decodes and stores that chain for the next launch.
+                 */
+                static TextureData import(const TextureSource &source, const TextureInfo &info);
+
+                const void *bytes() const { return cooked ? static_cast<const void *>(cooked->data()) : pixels.get(); }
+                VkDeviceSize size() const { return cooked ? cooked->data_size() : static_cast<VkDeviceSize>(width) * static_cast<VkDeviceSize>(height) * 4; }
+            };
+
+            /**
+             * @brief Records the uploads of many textures into the calling thread's UploadManager batch and
+             * submits them together. Staging memory comes from the upload ring.
+             */
+            class TextureUploadBatch {
+            public:
+                TextureUploadBatch(Device &_device);
+                ~TextureUploadBatch();
+
+                TextureUploadBatch(const TextureUploadBatch &) = delete;
+                TextureUploadBatch &operator=(const TextureUploadBatch &) = delete;
+
+                // copies data into staging memory and returns the command buffer to record into
+                VkCommandBuffer stage(const void *data, VkDeviceSize size, VkBuffer &staging_buffer, VkDeviceSize &staging_offset);
+                // submits without waiting, returns the value to pass to UploadManager::wait
+                u64 submit();
+
+            private:
+                Device &device;
+                bool staged = false;
+            };
+
             class Texture {
             public:
-                Texture(Device &_device, const std::string &filepath);
+                Texture(Device &_device, const std::string &filepath, const TextureInfo &info = {});
+                Texture(Device &_device, const TextureData &data, const TextureInfo &info = {});
+                Texture(Device &_device, const TextureData &data, TextureUploadBatch &batch, const TextureInfo &info = {});
                 ~Texture();
 
                 Texture(const Texture &) = delete;
@@ -22,17 +91,19 @@ namespace VGED {
                 VkImageLayout getImageLayout() { return imageLayout; }
 
             private:
-                void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
-                void generateMipmaps();
+                void createImage(const TextureData &data, const TextureInfo &info);
+                void recordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, VkDeviceSize stagingOffset, const TextureData &data);
+                void transitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
+                void generateMipmaps(VkCommandBuffer commandBuffer);
 
                 int width, height, mipLevels;
 
                 Device &device;
-                u32 image_id;
-                u32 sampler_id;
+                GPUResourceID image_id;
+                GPUResourceID sampler_id;
                 VkFormat imageFormat;
                 VkImageLayout imageLayout;
             };
         }
     }
-}
\ No newline at end of file
+}
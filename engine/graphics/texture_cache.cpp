@@ -0,0 +1,149 @@
+#include "texture_cache.hpp"
+
+#include "device.hpp"
+#include "upload_manager.hpp"
+
+// std
+#include <filesystem>
+#include <future>
+#include <string_view>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            TextureCache::TextureCache(Device &_device) : device{ _device } {}
+
+            TextureCache::~TextureCache() { *self = nullptr; }
+
+            std::string TextureCache::make_key(const std::string &filepath, const TextureInfo &info) {
+                std::error_code error;
+                auto canonical = std::filesystem::weakly_canonical(filepath, error);
+                std::string key = error ? std::filesystem::path{ filepath }.lexically_normal().generic_string() : canonical.generic_string();
+                key += info.srgb ? "|srgb" : "|unorm";
+                return key;
+            }
+
+            std::shared_ptr<Texture> TextureCache::find(const std::string &key) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto it = textures.find(key);
+                return it != textures.end() ? it->second.lock() : nullptr;
+            }
+
+            std::shared_ptr<Texture> TextureCache::adopt(const std::string &key, Texture *texture) {
+                std::weak_ptr<TextureCache *> owner = self;
+                return std::shared_ptr<Texture>{ texture, [owner, key](Texture *released) {
+                                                    delete released;
+                                                    if (auto cache = owner.lock(); cache && *cache) {
+                                                        (*cache)->evict(key);
+                                                    }
+                                                } };
+            }
+
+            std::shared_ptr<Texture> TextureCache::insert(const std::string &key, const std::shared_ptr<Texture> &texture) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto &entry = textures[key];
+                if (auto existing = entry.lock()) {
+                    // another caller loaded the same texture meanwhile, keep the first one
+                    return existing;
+                }
+                entry = texture;
+                return texture;
+            }
+
+            void TextureCache::evict(const std::string &key) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto it = textures.find(key);
+                // the key may already have been reloaded by the time the old texture is released
+                if (it != textures.end() && it->second.expired()) {
+                    textures.erase(it);
+                }
+            }
+
+            std::shared_ptr<Texture> TextureCache::get(const std::string &filepath, const TextureInfo &info) {
+                std::string key = make_key(filepath, info);
+                if (auto texture = find(key)) {
+                    return texture;
+                }
+                auto loaded = adopt(key, new Texture(device, filepath, info));
+                auto texture = insert(key, loaded);
+                if (texture != loaded) {
+                    // the losing copy may still be uploading
+                    device.upload_manager().wait_idle();
+                }
+                return texture;
+            }
+
+            std::vector<std::shared_ptr<Texture>> TextureCache::get(const std::vector<TextureSource> &sources, const TextureInfo &info, ThreadPool &thread_pool) {
+                std::vector<std::shared_ptr<Texture>> result(sources.size());
+
+                // collect the distinct misses, duplicates in sources resolve to the same load
+                std::vector<std::string> keys(sources.size());
+                std::unordered_map<std::string, usize> pending;
+                std::vector<usize> loads;
+                for (usize i = 0; i < sources.size(); i++) {
+                    keys[i] = make_key(sources[i].path, info);
+                    result[i] = find(keys[i]);
+                    if (!result[i] && pending.emplace(keys[i], i).second) {
+                        loads.push_back(i);
+                    }
+                }
+
+                std::vector<std::future<TextureData>> decoded;
+                decoded.reserve(loads.size());
+                for (usize i : loads) {
+                    decoded.push_back(thread_pool.submit([source = sources[i], info]() { return TextureData::import(source, info); }));
+                }
+
+                // loaded textures that lose an insert race must outlive the batch that uploads them
+                std::vector<std::shared_ptr<Texture>> loaded;
+                loaded.reserve(loads.size());
+                bool lost_race = false;
+                try {
+                    TextureUploadBatch batch{ device };
+                    for (usize load = 0; load < loads.size(); load++) {
+                        usize i = loads[load];
+                        loaded.push_back(adopt(keys[i], new Texture(device, decoded[load].get(), batch, info)));
+                        result[i] = insert(keys[i], loaded.back());
+                        lost_race |= result[i] != loaded.back();
+                    }
+                    u64 uploaded = batch.submit();
+                    if (lost_race) {
+                        device.upload_manager().wait(uploaded);
+                    }
+                } catch (...) {
+                    // the remaining decodes read embedded bytes the caller frees while unwinding
+                    for (auto &future : decoded) {
+                        if (future.valid()) {
+                            future.wait();
+                        }
+                    }
+                    throw;
+                }
+
+                for (usize i = 0; i < sources.size(); i++) {
+                    if (!result[i]) {
+                        result[i] = result[pending.at(keys[i])];
+                    }
+                }
+                return result;
+            }
+
+            void TextureCache::invalidate(const std::string &filepath) {
+                std::lock_guard<std::mutex> lock{ mutex };
+                // the old textures' deleters find the key taken or gone and leave it alone
+                std::string srgb_key = make_key(filepath, { .srgb = true });
+                textures.erase(srgb_key);
+                textures.erase(make_key(filepath, { .srgb = false }));
+
+                // images embedded in a .glb are keyed <path>#<index>, they change with the file that holds them
+                std::string embedded_prefix = srgb_key.substr(0, srgb_key.size() - std::string_view{ "|srgb" }.size()) + "#";
+                std::erase_if(textures, [&](const auto &entry) { return entry.first.starts_with(embedded_prefix); });
+            }
+
+            usize TextureCache::size() {
+                std::lock_guard<std::mutex> lock{ mutex };
+                return textures.size();
+            }
+        }
+    }
+}
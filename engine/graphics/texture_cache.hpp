@@ -0,0 +1,61 @@
+#pragma once
+
+#include "texture.hpp"
+#include "../core/thread_pool.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            /**
+             * @brief Hands out shared textures keyed by canonical path and import settings, so an image file
+             * is decoded and uploaded at most once while anything still references it. Entries are evicted
+             * as soon as the last handle is released.
+             */
+            class TextureCache {
+            public:
+                TextureCache(Device &_device);
+                ~TextureCache();
+
+                TextureCache(const TextureCache &) = delete;
+                TextureCache &operator=(const TextureCache &) = delete;
+
+                std::shared_ptr<Texture> get(const std::string &filepath, const TextureInfo &info = {});
+
+                /**
+                 * @brief Resolve many textures at once. Misses are decoded in parallel on thread_pool and
+                 * uploaded through one TextureUploadBatch; the result matches the order of sources.
+                 * Embedded sources are keyed by their path and their bytes must stay valid until this returns.
+                 */
+                std::vector<std::shared_ptr<Texture>> get(const std::vector<TextureSource> &sources, const TextureInfo &info, ThreadPool &thread_pool);
+
+                /**
+                 * @brief Forget the textures loaded from filepath so the next get loads it again. Handles already
+                 * given out keep the old texture.
+                 */
+                void invalidate(const std::string &filepath);
+
+                usize size();
+
+            private:
+                static std::string make_key(const std::string &filepath, const TextureInfo &info);
+
+                std::shared_ptr<Texture> find(const std::string &key);
+                std::shared_ptr<Texture> adopt(const std::string &key, Texture *texture);
+                std::shared_ptr<Texture> insert(const std::string &key, const std::shared_ptr<Texture> &texture);
+                void evict(const std::string &key);
+
+                Device &device;
+                std::mutex mutex = {};
+                std::unordered_map<std::string, std::weak_ptr<Texture>> textures = {};
+                // lets handles that outlive the cache skip eviction instead of touching freed memory
+                std::shared_ptr<TextureCache *> self = std::make_shared<TextureCache *>(this);
+            };
+        }
+    }
+}
@@ -0,0 +1,393 @@
+#include "texture_compressor.hpp"
+
+// std
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            static float srgb_to_linear(float c) { return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); }
+
+            static float linear_to_srgb(float c) { return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f; }
+
+            static u8 to_unorm8(float v) { return static_cast<u8>(std::clamp(std::lround(v * 255.0f), 0l, 255l)); }
+
+            ImageFormat cooked_texture_format(const TextureCookInfo &info) {
+                bool srgb = info.srgb && !info.normal_map;
+                switch (info.encoding) {
+                case TextureEncoding::BC1: return srgb ? ImageFormat::BC1_RGB_SRGB_BLOCK : ImageFormat::BC1_RGB_UNORM_BLOCK;
+                case TextureEncoding::BC4: return ImageFormat::BC4_UNORM_BLOCK;
+                case TextureEncoding::BC5: return ImageFormat::BC5_UNORM_BLOCK;
+                case TextureEncoding::BC7: return srgb ? ImageFormat::BC7_SRGB_BLOCK : ImageFormat::BC7_UNORM_BLOCK;
+                default: return srgb ? ImageFormat::R8G8B8A8_SRGB : ImageFormat::R8G8B8A8_UNORM;
+                }
+            }
+
+            std::vector<TextureLevel> build_mip_chain(const u8 *rgba, u32 width, u32 height, const TextureCookInfo &info) {
+                bool srgb = info.srgb && !info.normal_map;
+                std::vector<TextureLevel> levels;
+                levels.push_back({ width, height, std::vector<u8>(rgba, rgba + static_cast<usize>(width) * height * 4) });
+
+                // every level is filtered from full precision data instead of the rounded level above it
+                std::vector<float> current(static_cast<usize>(width) * height * 4);
+                for (usize i = 0; i < current.size(); i++) {
+                    float v = rgba[i] / 255.0f;
+                    bool color = i % 4 < 3;
+                    current[i] = color && srgb ? srgb_to_linear(v) : color && info.normal_map ? v * 2.0f - 1.0f : v;
+                }
+
+                u32 w = width;
+                u32 h = height;
+                while (w > 1 || h > 1) {
+                    u32 next_w = std::max(w / 2, 1u);
+                    u32 next_h = std::max(h / 2, 1u);
+                    std::vector<float> next(static_cast<usize>(next_w) * next_h * 4);
+                    TextureLevel level{ next_w, next_h, std::vector<u8>(next.size()) };
+
+                    for (u32 y = 0; y < next_h; y++) {
+                        for (u32 x = 0; x < next_w; x++) {
+                            float *texel = &next[(static_cast<usize>(y) * next_w + x) * 4];
+                            // 2x2 box, odd edges repeat their last row or column
+                            for (u32 dy = 0; dy < 2; dy++) {
+                                for (u32 dx = 0; dx < 2; dx++) {
+                                    u32 sx = std::min(x * 2 + dx, w - 1);
+                                    u32 sy = std::min(y * 2 + dy, h - 1);
+                                    const float *source = &current[(static_cast<usize>(sy) * w + sx) * 4];
+                                    for (u32 c = 0; c < 4; c++) {
+                                        texel[c] += source[c] * 0.25f;
+                                    }
+                                }
+                            }
+
+                            if (info.normal_map) {
+                                float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+                                if (length > 1e-6f) {
+                                    texel[0] /= length;
+                                    texel[1] /= length;
+                                    texel[2] /= length;
+                                }
+                            }
+
+                            u8 *encoded = &level.data[(static_cast<usize>(y) * next_w + x) * 4];
+                            for (u32 c = 0; c < 3; c++) {
+                                encoded[c] = to_unorm8(srgb ? linear_to_srgb(texel[c]) : info.normal_map ? texel[c] * 0.5f + 0.5f : texel[c]);
+                            }
+                            encoded[3] = to_unorm8(texel[3]);
+                        }
+                    }
+
+                    levels.push_back(std::move(level));
+                    current = std::move(next);
+                    w = next_w;
+                    h = next_h;
+                }
+                return levels;
+            }
+
+            static void fetch_block(const TextureLevel &level, u32 block_x, u32 block_y, u8 texels[16][4]) {
+                for (u32 y = 0; y < 4; y++) {
+                    for (u32 x = 0; x < 4; x++) {
+                        u32 sx = std::min(block_x * 4 + x, level.width - 1);
+                        u32 sy = std::min(block_y * 4 + y, level.height - 1);
+                        std::memcpy(texels[y * 4 + x], &level.data[(static_cast<usize>(sy) * level.width + sx) * 4], 4);
+                    }
+                }
+            }
+
+            // end points of the block projected onto its principal axis, found by power iteration on the covariance
+            static void fit_endpoints(const float points[16][4], u32 channels, float low[4], float high[4]) {
+                float mean[4] = {};
+                float min[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+                float max[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+                for (u32 i = 0; i < 16; i++) {
+                    for (u32 c = 0; c < channels; c++) {
+                        mean[c] += points[i][c] / 16.0f;
+                        min[c] = std::min(min[c], points[i][c]);
+                        max[c] = std::max(max[c], points[i][c]);
+                    }
+                }
+
+                float covariance[4][4] = {};
+                for (u32 i = 0; i < 16; i++) {
+                    for (u32 a = 0; a < channels; a++) {
+                        for (u32 b = 0; b < channels; b++) {
+                            covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+                        }
+                    }
+                }
+
+                // the bounding box diagonal is a good first guess and never orthogonal to the answer
+                float axis[4] = {};
+                for (u32 c = 0; c < channels; c++) {
+                    axis[c] = max[c] - min[c];
+                }
+                for (u32 iteration = 0; iteration < 8; iteration++) {
+                    float next[4] = {};
+                    float length = 0.0f;
+                    for (u32 a = 0; a < channels; a++) {
+                        for (u32 b = 0; b < channels; b++) {
+                            next[a] += covariance[a][b] * axis[b];
+                        }
+                        length += next[a] * next[a];
+                    }
+                    if (length < 1e-12f) {
+                        break;
+                    }
+                    length = std::sqrt(length);
+                    for (u32 c = 0; c < channels; c++) {
+                        axis[c] = next[c] / length;
+                    }
+                }
+
+                float t_min = 0.0f;
+                float t_max = 0.0f;
+                for (u32 i = 0; i < 16; i++) {
+                    float t = 0.0f;
+                    for (u32 c = 0; c < channels; c++) {
+                        t += (points[i][c] - mean[c]) * axis[c];
+                    }
+                    t_min = std::min(t_min, t);
+                    t_max = std::max(t_max, t);
+                }
+
+                for (u32 c = 0; c < 4; c++) {
+                    low[c] = c < channels ? std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f) : 0.0f;
+                    high[c] = c < channels ? std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f) : 0.0f;
+                }
+            }
+
+            template <u32 Channels>
+            static u32 nearest(const float (&point)[4], const float (*palette)[4], u32 palette_size) {
+                u32 best = 0;
+                float best_error = FLT_MAX;
+                for (u32 i = 0; i < palette_size; i++) {
+                    float error = 0.0f;
+                    for (u32 c = 0; c < Channels; c++) {
+                        float d = point[c] - palette[i][c];
+                        error += d * d;
+                    }
+                    if (error < best_error) {
+                        best_error = error;
+                        best = i;
+                    }
+                }
+                return best;
+            }
+
+            static u16 pack_565(const float color[4]) {
+                u32 r = static_cast<u32>(std::lround(color[0] * 31.0f / 255.0f));
+                u32 g = static_cast<u32>(std::lround(color[1] * 63.0f / 255.0f));
+                u32 b = static_cast<u32>(std::lround(color[2] * 31.0f / 255.0f));
+                return static_cast<u16>((r << 11) | (g << 5) | b);
+            }
+
+            static void unpack_565(u16 packed, float color[4]) {
+                u32 r = (packed >> 11) & 31;
+                u32 g = (packed >> 5) & 63;
+                u32 b = packed & 31;
+                color[0] = static_cast<float>((r << 3) | (r >> 2));
+                color[1] = static_cast<float>((g << 2) | (g >> 4));
+                color[2] = static_cast<float>((b << 3) | (b >> 2));
+                color[3] = 0.0f;
+            }
+
+            static void encode_bc1_block(const u8 texels[16][4], u8 *out) {
+                float points[16][4];
+                for (u32 i = 0; i < 16; i++) {
+                    for (u32 c = 0; c < 4; c++) {
+                        points[i][c] = c < 3 ? texels[i][c] : 0.0f;
+                    }
+                }
+
+                float low[4], high[4];
+                fit_endpoints(points, 3, low, high);
+                u16 color0 = pack_565(high);
+                u16 color1 = pack_565(low);
+                // color0 > color1 selects the opaque four color mode
+                if (color0 < color1) {
+                    std::swap(color0, color1);
+                }
+
+                u32 indices = 0;
+                if (color0 != color1) {
+                    float palette[4][4];
+                    unpack_565(color0, palette[0]);
+                    unpack_565(color1, palette[1]);
+                    for (u32 c = 0; c < 3; c++) {
+                        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+                    }
+                    for (u32 i = 0; i < 16; i++) {
+                        indices |= nearest<3>(points[i], palette, 4) << (2 * i);
+                    }
+                }
+
+                std::memcpy(out, &color0, 2);
+                std::memcpy(out + 2, &color1, 2);
+                std::memcpy(out + 4, &indices, 4);
+            }
+
+            static void encode_bc4_block(const u8 values[16], u8 *out) {
+                u8 low = *std::min_element(values, values + 16);
+                u8 high = *std::max_element(values, values + 16);
+                // red0 > red1 selects the eight value mode
+                out[0] = high;
+                out[1] = low;
+
+                u64 indices = 0;
+                if (high != low) {
+                    float palette[8][4] = {};
+                    palette[0][0] = high;
+                    palette[1][0] = low;
+                    for (u32 i = 1; i < 7; i++) {
+                        palette[i + 1][0] = ((7 - i) * static_cast<float>(high) + i * static_cast<float>(low)) / 7.0f;
+                    }
+                    for (u32 i = 0; i < 16; i++) {
+                        float point[4] = { static_cast<float>(values[i]) };
+                        indices |= static_cast<u64>(nearest<1>(point, palette, 8)) << (3 * i);
+                    }
+                }
+                std::memcpy(out + 2, &indices, 6);
+            }
+
+            static void encode_bc4_channel(const u8 texels[16][4], u32 channel, u8 *out) {
+                u8 values[16];
+                for (u32 i = 0; i < 16; i++) {
+                    values[i] = texels[i][channel];
+                }
+                encode_bc4_block(values, out);
+            }
+
+            struct BlockBitWriter {
+                u8 *out;
+                u32 bit = 0;
+
+                void write(u32 value, u32 count) {
+                    for (u32 i = 0; i < count; i++, bit++) {
+                        if ((value >> i) & 1) {
+                            out[bit / 8] |= static_cast<u8>(1 << (bit % 8));
+                        }
+                    }
+                }
+            };
+
+            // 7 bit end point channels plus a shared lowest bit, picks the p-bit that lands closer
+            static void quantize_bc7_endpoint(const float endpoint[4], u32 quantized[4], u32 &p_bit) {
+                float best_error = FLT_MAX;
+                for (u32 p = 0; p < 2; p++) {
+                    u32 candidate[4];
+                    float error = 0.0f;
+                    for (u32 c = 0; c < 4; c++) {
+                        candidate[c] = static_cast<u32>(std::clamp(std::lround((endpoint[c] - p) / 2.0f), 0l, 127l));
+                        float d = static_cast<float>((candidate[c] << 1) | p) - endpoint[c];
+                        error += d * d;
+                    }
+                    if (error < best_error) {
+                        best_error = error;
+                        p_bit = p;
+                        std::memcpy(quantized, candidate, sizeof(candidate));
+                    }
+                }
+            }
+
+            // mode 6 only: one subset, rgba end points and 4 bit indices
+            static void encode_bc7_block(const u8 texels[16][4], u8 *out) {
+                static constexpr u32 WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+                float points[16][4];
+                for (u32 i = 0; i < 16; i++) {
+                    for (u32 c = 0; c < 4; c++) {
+                        points[i][c] = texels[i][c];
+                    }
+                }
+
+                float low[4], high[4];
+                fit_endpoints(points, 4, low, high);
+                u32 q0[4], q1[4], p0, p1;
+                quantize_bc7_endpoint(low, q0, p0);
+                quantize_bc7_endpoint(high, q1, p1);
+
+                float palette[16][4];
+                for (u32 i = 0; i < 16; i++) {
+                    for (u32 c = 0; c < 4; c++) {
+                        u32 e0 = (q0[c] << 1) | p0;
+                        u32 e1 = (q1[c] << 1) | p1;
+                        palette[i][c] = static_cast<float>(((64 - WEIGHTS[i]) * e0 + WEIGHTS[i] * e1 + 32) >> 6);
+                    }
+                }
+
+                u32 indices[16];
+                for (u32 i = 0; i < 16; i++) {
+                    indices[i] = nearest<4>(points[i], palette, 16);
+                }
+
+                // the anchor index is stored with 3 bits, its top bit has to be zero
+                if (indices[0] & 8) {
+                    std::swap(q0, q1);
+                    std::swap(p0, p1);
+                    for (auto &index : indices) {
+                        index = 15 - index;
+                    }
+                }
+
+                std::memset(out, 0, 16);
+                BlockBitWriter bits{ out };
+                bits.write(1 << 6, 7);
+                for (u32 c = 0; c < 4; c++) {
+                    bits.write(q0[c], 7);
+                    bits.write(q1[c], 7);
+                }
+                bits.write(p0, 1);
+                bits.write(p1, 1);
+                bits.write(indices[0], 3);
+                for (u32 i = 1; i < 16; i++) {
+                    bits.write(indices[i], 4);
+                }
+            }
+
+            TextureLevel encode_level(const TextureLevel &level, TextureEncoding encoding, ThreadPool &thread_pool) {
+                if (encoding == TextureEncoding::RGBA8) {
+                    return level;
+                }
+
+                u32 blocks_x = (level.width + 3) / 4;
+                u32 blocks_y = (level.height + 3) / 4;
+                usize block_size = encoding == TextureEncoding::BC1 || encoding == TextureEncoding::BC4 ? 8 : 16;
+                TextureLevel encoded{ level.width, level.height, std::vector<u8>(static_cast<usize>(blocks_x) * blocks_y * block_size) };
+
+                thread_pool.parallel_for(blocks_y, [&](usize block_y) {
+                    u8 texels[16][4];
+                    for (u32 block_x = 0; block_x < blocks_x; block_x++) {
+                        fetch_block(level, block_x, static_cast<u32>(block_y), texels);
+                        u8 *out = &encoded.data[(block_y * blocks_x + block_x) * block_size];
+                        switch (encoding) {
+                        case TextureEncoding::BC1: encode_bc1_block(texels, out); break;
+                        case TextureEncoding::BC4: encode_bc4_channel(texels, 0, out); break;
+                        case TextureEncoding::BC5:
+                            encode_bc4_channel(texels, 0, out);
+                            encode_bc4_channel(texels, 1, out + 8);
+                            break;
+                        case TextureEncoding::BC7: encode_bc7_block(texels, out); break;
+                        default: break;
+                        }
+                    }
+                });
+                return encoded;
+            }
+
+            CookedTextureData cook_texture(const u8 *rgba, u32 width, u32 height, const TextureCookInfo &info) {
+                ThreadPool &thread_pool = info.thread_pool ? *info.thread_pool : ThreadPool::shared();
+
+                CookedTextureData cooked{ .format = cooked_texture_format(info), .width = width, .height = height };
+                for (auto &level : build_mip_chain(rgba, width, height, info)) {
+                    cooked.levels.push_back(encode_level(level, info.encoding, thread_pool));
+                }
+                return cooked;
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "vk_types.hpp"
+#include "../core/thread_pool.hpp"
+
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            enum class TextureEncoding : u32 {
+                RGBA8, // uncompressed, 4 bytes per texel
+                BC1,   // rgb, 0.5 bytes per texel
+                BC4,   // single channel (red), 0.5 bytes per texel
+                BC5,   // two channels (red, green), normal maps, 1 byte per texel
+                BC7    // rgba, 1 byte per texel
+            };
+
+            struct TextureCookInfo {
+                TextureEncoding encoding = TextureEncoding::BC7;
+                bool srgb = true;        // filter mips in linear space and tag the format as sRGB
+                bool normal_map = false; // filter mips as unit vectors, implies a linear format
+                ThreadPool *thread_pool = nullptr; // encodes block rows in parallel, defaults to ThreadPool::shared()
+            };
+
+            struct TextureLevel {
+                u32 width = 0;
+                u32 height = 0;
+                std::vector<u8> data = {};
+            };
+
+            /**
+             * @brief Encoded mip chain ready to be written as a .vtex, level 0 is full resolution.
+             */
+            struct CookedTextureData {
+                ImageFormat format = ImageFormat::UNDEFINED;
+                u32 width = 0;
+                u32 height = 0;
+                std::vector<TextureLevel> levels = {};
+            };
+
+            ImageFormat cooked_texture_format(const TextureCookInfo &info);
+
+            /**
+             * @brief Full RGBA8 mip chain down to 1x1. sRGB data is averaged in linear space and normal maps
+             * are averaged as vectors and renormalized, so lower mips neither darken nor flatten.
+             */
+            std::vector<TextureLevel> build_mip_chain(const u8 *rgba, u32 width, u32 height, const TextureCookInfo &info);
+
+            /**
+             * @brief Encode one RGBA8 level into 4x4 blocks, edge blocks repeat the last row and column.
+             */
+            TextureLevel encode_level(const TextureLevel &level, TextureEncoding encoding, ThreadPool &thread_pool);
+
+            CookedTextureData cook_texture(const u8 *rgba, u32 width, u32 height, const TextureCookInfo &info = {});
+        }
+    }
+}
@@ -0,0 +1,335 @@
+#include "upload_manager.hpp"
+
+#include "device.hpp"
+
+// std
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+            UploadManager::UploadManager(Device &_device, VkDeviceSize _ring_size) : device{ _device }, ring_size{ _ring_size } {
+                ring = std::make_unique<Buffer>(device.device(), device.allocator(), BufferInfo{
+                    .instance_size = static_cast<u32>(ring_size),
+                    .instance_count = 1,
+                    .memory_flags = MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE
+                });
+                ring->map();
+                ring_memory = static_cast<u8 *>(ring->get_mapped_memory());
+
+                VkSemaphoreTypeCreateInfo vk_semaphore_type_create_info = {
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                    .pNext = nullptr,
+                    .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                    .initialValue = 0
+                };
+
+                VkSemaphoreCreateInfo vk_semaphore_create_info = {
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                    .pNext = &vk_semaphore_type_create_info,
+                    .flags = {}
+                };
+
+                if (vkCreateSemaphore(device.device(), &vk_semaphore_create_info, nullptr, &timeline) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create upload timeline semaphore!");
+                }
+            }
+
+            UploadManager::~UploadManager() {
+                wait_idle();
+                // destroying the pools frees their command buffers, including batches that were never flushed
+                for (auto &[thread_id, batch] : batches) {
+                    vkDestroyCommandPool(device.device(), batch->pool, nullptr);
+                }
+                vkDestroySemaphore(device.device(), timeline, nullptr);
+            }
+
+            UploadManager::ThreadBatch &UploadManager::current_batch() {
+                std::lock_guard<std::mutex> lock{ mutex };
+                auto &batch = batches[std::this_thread::get_id()];
+                if (!batch) {
+                    batch = std::make_unique<ThreadBatch>();
+
+                    VkCommandPoolCreateInfo vk_command_pool_create_info = {
+                        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                        .pNext = nullptr,
+                        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                        .queueFamilyIndex = device.graphics_queue_family()
+                    };
+
+                    if (vkCreateCommandPool(device.device(), &vk_command_pool_create_info, nullptr, &batch->pool) != VK_SUCCESS) {
+                        throw std::runtime_error("failed to create upload command pool!");
+                    }
+                }
+                return *batch;
+            }
+
+            void UploadManager::begin(ThreadBatch &batch) {
+                if (batch.command_buffer != VK_NULL_HANDLE) {
+                    return;
+                }
+
+                // recycle the oldest command buffer of this thread once the GPU is done with it
+                if (!batch.in_flight.empty() && is_complete(batch.in_flight.front().second)) {
+                    batch.command_buffer = batch.in_flight.front().first;
+                    batch.in_flight.pop_front();
+                    vkResetCommandBuffer(batch.command_buffer, 0);
+                } else {
+                    VkCommandBufferAllocateInfo vk_command_buffer_allocate_info = {
+                        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                        .pNext = nullptr,
+                        .commandPool = batch.pool,
+                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                        .commandBufferCount = 1
+                    };
+                    vkAllocateCommandBuffers(device.device(), &vk_command_buffer_allocate_info, &batch.command_buffer);
+                }
+
+                VkCommandBufferBeginInfo vk_command_buffer_begin_info = {
+                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                    .pNext = nullptr,
+                    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                    .pInheritanceInfo = nullptr
+                };
+                vkBeginCommandBuffer(batch.command_buffer, &vk_command_buffer_begin_info);
+            }
+
+            UploadStaging UploadManager::stage(VkDeviceSize size, VkDeviceSize alignment) {
+                ThreadBatch &batch = current_batch();
+
+                VkDeviceSize offset;
+                // half the ring at most, so one huge upload can't starve everything else
+                bool in_ring = size > 0 && size <= ring_size / 2 && allocate_ring(batch, size, alignment, offset);
+                begin(batch);
+
+                UploadStaging staging{ .command_buffer = batch.command_buffer };
+                if (in_ring) {
+                    staging.buffer = ring->get_buffer();
+                    staging.offset = offset;
+                    staging.mapped = ring_memory + offset;
+                } else {
+                    auto &buffer = batch.overflow.emplace_back(std::make_unique<Buffer>(device.device(), device.allocator(), BufferInfo{
+                        .instance_size = static_cast<u32>(size),
+                        .instance_count = 1,
+                        .memory_flags = MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE
+                    }));
+                    buffer->map();
+                    staging.buffer = buffer->get_buffer();
+                    staging.mapped = buffer->get_mapped_memory();
+                }
+
+                batch.bytes += size;
+                batch.copies++;
+                return staging;
+            }
+
+            void UploadManager::copy_buffer(const UploadStaging &staging, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize dst_offset) {
+                VkBufferCopy vk_buffer_copy = {
+                    .srcOffset = staging.offset,
+                    .dstOffset = dst_offset,
+                    .size = size
+                };
+                vkCmdCopyBuffer(staging.command_buffer, staging.buffer, dst_buffer, 1, &vk_buffer_copy);
+            }
+
+            void UploadManager::upload_buffer(VkBuffer dst_buffer, const void *data, VkDeviceSize size, VkDeviceSize dst_offset) {
+                UploadStaging staging = stage(size);
+                std::memcpy(staging.mapped, data, size);
+                copy_buffer(staging, dst_buffer, size, dst_offset);
+            }
+
+            bool UploadManager::allocate_ring(ThreadBatch &batch, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset) {
+                while (true) {
+                    u64 wait_value;
+                    {
+                        std::lock_guard<std::mutex> lock{ mutex };
+                        reclaim();
+                        if (try_allocate_ring(size, alignment, offset)) {
+                            regions.push_back({ offset, offset + size, PENDING });
+                            batch.regions.push_back(&regions.back());
+                            return true;
+                        }
+
+                        // the oldest region still belongs to a batch that was never submitted, waiting on it would never finish
+                        if (regions.front().value == PENDING && batch.regions.empty()) {
+                            return false;
+                        }
+                        wait_value = regions.front().value;
+                    }
+
+                    if (wait_value == PENDING) {
+                        // some of the space is held by this thread's own batch, submit it and try again
+                        flush();
+                    } else {
+                        wait(wait_value);
+                    }
+                }
+            }
+
+            bool UploadManager::try_allocate_ring(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset) {
+                if (regions.empty()) {
+                    offset = 0;
+                    ring_head = size;
+                    return true;
+                }
+
+                VkDeviceSize head = align_up(ring_head, alignment);
+                VkDeviceSize tail = regions.front().offset;
+                if (ring_head > tail) {
+                    // free space is [head, ring_size) and [0, tail)
+                    if (head + size <= ring_size) {
+                        offset = head;
+                    } else if (size <= tail) {
+                        offset = 0;
+                    } else {
+                        return false;
+                    }
+                } else {
+                    // wrapped around, free space is [head, tail)
+                    if (head + size > tail) {
+                        return false;
+                    }
+                    offset = head;
+                }
+                ring_head = offset + size;
+                return true;
+            }
+
+            void UploadManager::reclaim() {
+                u64 completed = completed_value();
+                while (!regions.empty() && regions.front().value != PENDING && regions.front().value <= completed) {
+                    regions.pop_front();
+                }
+                if (regions.empty()) {
+                    ring_head = 0;
+                }
+                std::erase_if(retired, [completed](const RetiredBuffer &buffer) { return buffer.value <= completed; });
+            }
+
+            u64 UploadManager::flush() {
+                ThreadBatch &batch = current_batch();
+                if (batch.command_buffer == VK_NULL_HANDLE) {
+                    return batch.last_value;
+                }
+
+                // make the copies visible to every command submitted after this batch
+                VkMemoryBarrier vk_memory_barrier = {
+                    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                    .pNext = nullptr,
+                    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+                };
+                vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1,
+                                     &vk_memory_barrier, 0, nullptr, 0, nullptr);
+                vkEndCommandBuffer(batch.command_buffer);
+
+                for (auto *region : batch.regions) {
+                    ring->flush(region->end - region->offset, region->offset);
+                }
+                for (auto &buffer : batch.overflow) {
+                    buffer->flush();
+                }
+
+                u64 value;
+                {
+                    // values have to be handed out in submission order for the timeline to stay monotonic
+                    std::lock_guard<std::mutex> lock{ device.queue_mutex() };
+                    value = submitted_value.load() + 1;
+
+                    VkTimelineSemaphoreSubmitInfo vk_timeline_semaphore_submit_info = {
+                        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+                        .pNext = nullptr,
+                        .waitSemaphoreValueCount = 0,
+                        .pWaitSemaphoreValues = nullptr,
+                        .signalSemaphoreValueCount = 1,
+                        .pSignalSemaphoreValues = &value
+                    };
+
+                    VkSubmitInfo vk_submit_info = {
+                        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                        .pNext = &vk_timeline_semaphore_submit_info,
+                        .waitSemaphoreCount = 0,
+                        .pWaitSemaphores = nullptr,
+                        .pWaitDstStageMask = nullptr,
+                        .commandBufferCount = 1,
+                        .pCommandBuffers = &batch.command_buffer,
+                        .signalSemaphoreCount = 1,
+                        .pSignalSemaphores = &timeline
+                    };
+
+                    if (vkQueueSubmit(device.graphics_queue(), 1, &vk_submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+                        throw std::runtime_error("failed to submit upload batch!");
+                    }
+                    submitted_value = value;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock{ mutex };
+                    for (auto *region : batch.regions) {
+                        region->value = value;
+                    }
+                    for (auto &buffer : batch.overflow) {
+                        retired.push_back({ value, std::move(buffer) });
+                    }
+                }
+                batch.regions.clear();
+                batch.overflow.clear();
+                batch.in_flight.emplace_back(batch.command_buffer, value);
+                batch.command_buffer = VK_NULL_HANDLE;
+
+                frame_bytes += batch.bytes;
+                frame_copies += batch.copies;
+                frame_submits++;
+                batch.bytes = 0;
+                batch.copies = 0;
+                batch.last_value = value;
+                return value;
+            }
+
+            u64 UploadManager::completed_value() {
+                u64 value = 0;
+                vkGetSemaphoreCounterValue(device.device(), timeline, &value);
+                return value;
+            }
+
+            bool UploadManager::is_complete(u64 value) { return completed_value() >= value; }
+
+            void UploadManager::wait(u64 value) {
+                if (value == 0) {
+                    return;
+                }
+
+                VkSemaphoreWaitInfo vk_semaphore_wait_info = {
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                    .pNext = nullptr,
+                    .flags = {},
+                    .semaphoreCount = 1,
+                    .pSemaphores = &timeline,
+                    .pValues = &value
+                };
+                vkWaitSemaphores(device.device(), &vk_semaphore_wait_info, std::numeric_limits<u64>::max());
+            }
+
+            const UploadStats &UploadManager::end_frame() {
+                flush();
+
+                last_frame = {
+                    .bytes = frame_bytes.exchange(0),
+                    .submits = frame_submits.exchange(0),
+                    .copies = frame_copies.exchange(0)
+                };
+                total.bytes += last_frame.bytes;
+                total.submits += last_frame.submits;
+                total.copies += last_frame.copies;
+
+                std::lock_guard<std::mutex> lock{ mutex };
+                reclaim();
+                return last_frame;
+            }
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "../core/types.hpp"
+
+#include <volk.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace VGED {
+    namespace Engine {
+        inline namespace Graphics {
+            class Device;
+
+            struct UploadStats {
+                u64 bytes = 0;
+                u32 submits = 0;
+                u32 copies = 0; // staging allocations, one per buffer or image upload
+            };
+
+            /**
+             * @brief Staging memory handed out by UploadManager::stage. Write the data to mapped, then record the
+             * copies reading from buffer at offset into command_buffer before staging anything else.
+             */
+            struct UploadStaging {
+                VkBuffer buffer = VK_NULL_HANDLE;
+                VkDeviceSize offset = 0;
+                void *mapped = nullptr;
+                VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            };
+
+            /**
+             * @brief Collects buffer and image uploads into one command buffer per thread and submits them together.
+             * Staging memory comes from a persistently mapped ring buffer and is recycled once the timeline
+             * semaphore signals that the submit reading it has completed, so nothing waits on the queue.
+             * Each submit ends with a barrier that makes the copies visible to everything submitted after it.
+             */
+            class UploadManager {
+            public:
+                static constexpr VkDeviceSize DEFAULT_RING_SIZE = 64ull * 1024 * 1024;
+
+                UploadManager(Device &_device, VkDeviceSize _ring_size = DEFAULT_RING_SIZE);
+                ~UploadManager();
+
+                UploadManager(const UploadManager &) = delete;
+                UploadManager &operator=(const UploadManager &) = delete;
+
+                /**
+                 * @brief Reserve size bytes of staging memory in the calling thread's batch. Uploads that don't fit
+                 * into the ring get a dedicated staging buffer that is released with the batch.
+                 */
+                UploadStaging stage(VkDeviceSize size, VkDeviceSize alignment = 16);
+                void copy_buffer(const UploadStaging &staging, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+                void upload_buffer(VkBuffer dst_buffer, const void *data, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+
+                /**
+                 * @brief Submit the calling thread's batch without waiting for it.
+                 * @return timeline value signaled once the uploads completed, pass it to wait or is_complete
+                 */
+                u64 flush();
+                bool is_complete(u64 value);
+                void wait(u64 value);
+                void wait_idle() { wait(submitted_value.load()); }
+
+                /**
+                 * @brief Flush the calling thread's batch and roll the per frame counters over. Call once per frame
+                 * before recording, uploads made on the main thread are then visible to that frame.
+                 */
+                const UploadStats &end_frame();
+                const UploadStats &last_frame_stats() const { return last_frame; }
+                const UploadStats &total_stats() const { return total; }
+
+            private:
+                static constexpr u64 PENDING = ~0ull;
+
+                struct RingRegion {
+                    VkDeviceSize offset;
+                    VkDeviceSize end;
+                    u64 value; // PENDING until the batch owning it is submitted
+                };
+
+                struct ThreadBatch {
+                    VkCommandPool pool = VK_NULL_HANDLE;
+                    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+                    std::vector<RingRegion *> regions = {};
+                    std::vector<std::unique_ptr<Buffer>> overflow = {};
+                    std::deque<std::pair<VkCommandBuffer, u64>> in_flight = {};
+                    VkDeviceSize bytes = 0;
+                    u32 copies = 0;
+                    u64 last_value = 0;
+                };
+
+                struct RetiredBuffer {
+                    u64 value;
+                    std::unique_ptr<Buffer> buffer;
+                };
+
+                ThreadBatch &current_batch();
+                void begin(ThreadBatch &batch);
+                bool allocate_ring(ThreadBatch &batch, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+                bool try_allocate_ring(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+                void reclaim();
+                u64 completed_value();
+
+                Device &device;
+                VkDeviceSize ring_size;
+                std::unique_ptr<Buffer> ring;
+                u8 *ring_memory = nullptr;
+                VkDeviceSize ring_head = 0;
+                // regions are only added at the back and released from the front, in submission order
+                std::deque<RingRegion> regions = {};
+                std::vector<RetiredBuffer> retired = {};
+
+                VkSemaphore timeline = VK_NULL_HANDLE;
+                std::atomic<u64> submitted_value = 0;
+
+                std::unordered_map<std::thread::id, std::unique_ptr<ThreadBatch>> batches = {};
+                std::mutex mutex = {};
+
+                std::atomic<u64> frame_bytes = 0;
+                std::atomic<u32> frame_submits = 0;
+                std::atomic<u32> frame_copies = 0;
+                UploadStats last_frame = {};
+                UploadStats total = {};
+            };
+        }
+    }
+}
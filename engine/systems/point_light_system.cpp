@@ -22,23 +22,26 @@ namespace VGED {
             };
 
             PointLightSystem::PointLightSystem(Device &_device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device{ _device } {
-                pipeline = std::make_unique<RasterPipeline>(device, RasterPipelineInfo{
-                                                                        .vertex_shader_info = { .source = ShaderFile{ "shaders/point_light.vert" } },
-                                                                        .fragment_shader_info = { .source = ShaderFile{ "shaders/point_light.frag" } },
-                                                                        .color_attachments = {
-                                                                            { .format = ImageFormat::B8G8R8A8_SRGB,
-                                                                              .blend = {
-                                                                                  .blend_enable = true,
-                                                                                  .src_color_blend_factor = BlendFactor::SRC_ALPHA,
-                                                                                  .dst_color_blend_factor = BlendFactor::ONE_MINUS_SRC_ALPHA,
-                                                                              } } },
-                                                                        .depth_test = {
-                                                                            .enable_depth_test = true,
-                                                                            .enable_depth_write = true,
-                                                                        },
-                                                                        .vk_render_pass = renderPass,
-                                                                        .pipeline_layout_info = { .push_constant_size = sizeof(PointLightPushConstants), .vk_descriptor_set_layouts = { globalSetLayout } },
-                                                                        .vertex_input = { .binding = {}, .attribute = {} } });
+                RasterPipelineInfo info{
+                    .vertex_shader_info = { .source = ShaderFile{ "shaders/point_light.vert" } },
+                    .fragment_shader_info = { .source = ShaderFile{ "shaders/point_light.frag" } },
+                    .color_attachments = {
+                        { .format = ImageFormat::B8G8R8A8_SRGB,
+                          .blend = {
+                              .blend_enable = true,
+                              .src_color_blend_factor = BlendFactor::SRC_ALPHA,
+                              .dst_color_blend_factor = BlendFactor::ONE_MINUS_SRC_ALPHA,
+                          } } },
+                    .depth_test = {
+                        .enable_depth_test = true,
+                        .enable_depth_write = true,
+                    },
+                    .vk_render_pass = renderPass,
+                    .pipeline_layout_info = { .push_constant_size = sizeof(PointLightPushConstants), .vk_descriptor_set_layouts = { globalSetLayout } },
+                    .vertex_input = { .binding = {}, .attribute = {} },
+                };
+                // built on a worker while the other systems start theirs, render waits for it
+                pipeline = &device.pipeline_library().acquire(info);
             }
 
             PointLightSystem::~PointLightSystem() {}
@@ -79,9 +82,9 @@ namespace VGED {
                     sorted[disSquared] = obj.getId();
                 }
 
-                pipeline->bind(frameInfo.commandBuffer);
+                pipeline->get().bind(frameInfo.commandBuffer);
 
-                vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline_layout(), 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+                vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->get().pipeline_layout(), 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
 
                 // iterate through sorted lights in reverse order
                 for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
@@ -93,7 +96,7 @@ namespace VGED {
                     push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
                     push.radius = obj.transform.scale.x;
 
-                    vkCmdPushConstants(frameInfo.commandBuffer, pipeline->pipeline_layout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PointLightPushConstants), &push);
+                    vkCmdPushConstants(frameInfo.commandBuffer, pipeline->get().pipeline_layout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PointLightPushConstants), &push);
                     vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
                 }
             }
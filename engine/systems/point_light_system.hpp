@@ -4,7 +4,7 @@
 #include "../graphics/device.hpp"
 #include "../graphics/frame_info.hpp"
 #include "../graphics/game_object.hpp"
-#include "../graphics/pipeline.hpp"
+#include "../graphics/pipeline_library.hpp"
 
 #include <memory>
 #include <vector>
@@ -26,7 +26,7 @@ namespace VGED {
             private:
                 Device &device;
 
-                std::unique_ptr<RasterPipeline> pipeline;
+                PendingPipeline *pipeline = nullptr; // owned by the device's PipelineLibrary
             };
         }
     }
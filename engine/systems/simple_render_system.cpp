@@ -1,4 +1,5 @@
 #include "simple_render_system.hpp"
+#include "graphics/bindless_materials.hpp"
 #include "graphics/pipeline.hpp"
 #include <memory>
 
@@ -8,6 +9,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <stdexcept>
@@ -20,35 +22,157 @@ namespace VGED {
                 glm::mat4 normalMatrix{ 1.f };
             };
 
-            SimpleRenderSystem::SimpleRenderSystem(Device &_device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout> setLayouts) : device{ _device } {
-                pipeline = std::make_unique<RasterPipeline>(device, RasterPipelineInfo{
-                                                                        .vertex_shader_info = { .source = ShaderFile{ "shaders/simple_shader.vert" } },
-                                                                        .fragment_shader_info = { .source = ShaderFile{ "shaders/simple_shader.frag" } },
-                                                                        .color_attachments = { { .format = ImageFormat::B8G8R8A8_SRGB, .blend = {} } },
-                                                                        .depth_test = {
-                                                                            .enable_depth_test = true,
-                                                                            .enable_depth_write = true,
-                                                                        },
-                                                                        .vk_render_pass = renderPass,
-                                                                        .pipeline_layout_info = { .push_constant_size = sizeof(SimplePushConstantData), .vk_descriptor_set_layouts = setLayouts } });
+            // largest acceptable projected lod error as a fraction of the viewport height, about a pixel at 1080p
+            static constexpr float LOD_ERROR_THRESHOLD = 1.0f / 1080.0f;
+            // switching needs to clear the threshold by this margin, so objects near it don't flicker between lods
+            static constexpr float LOD_HYSTERESIS = 0.25f;
+
+            SimpleRenderSystem::SimpleRenderSystem(Device &_device, VkRenderPass _renderPass, std::vector<VkDescriptorSetLayout> _setLayouts, bool _bindless)
+                : device{ _device }, renderPass{ _renderPass }, setLayouts{ std::move(_setLayouts) }, bindless{ _bindless } {
+                if (bindless) {
+                    setLayouts[1] = device.bindless_materials().descriptor_set_layout();
+                }
+                pipelineLayout = device.pipeline_library().layout({ .push_constant_size = sizeof(SimplePushConstantData), .vk_descriptor_set_layouts = setLayouts });
+                for (VertexFormat format : { VertexFormat::STANDARD, VertexFormat::COMPACT, VertexFormat::QUANTIZED }) {
+                    pipelines[static_cast<u32>(format) * MATERIAL_VARIANT_COUNT] = &device.pipeline_library().acquire(pipelineInfo(format, 0));
+                }
+            }
+
+            RasterPipelineInfo SimpleRenderSystem::pipelineInfo(VertexFormat format, uint32_t materialFeatures) const {
+                std::vector<ShaderDefine> defines;
+                if (materialFeatures & MATERIAL_FEATURE_NORMAL_MAP) {
+                    defines.push_back({ .name = "HAS_NORMAL_MAP" });
+                }
+                if (materialFeatures & MATERIAL_FEATURE_METALLIC_ROUGHNESS_MAP) {
+                    defines.push_back({ .name = "HAS_METALLIC_ROUGHNESS_MAP" });
+                }
+                if (bindless) {
+                    defines.push_back({ .name = "BINDLESS" });
+                }
+
+                const char *vertexShader = format == VertexFormat::STANDARD ? "shaders/simple_shader.vert" : "shaders/simple_shader_compact.vert";
+                return RasterPipelineInfo{
+                    .vertex_shader_info = { .source = ShaderFile{ vertexShader }, .defines = defines },
+                    .fragment_shader_info = { .source = ShaderFile{ "shaders/simple_shader.frag" }, .defines = defines, .specialization = { { .id = 0, .value = MAX_LIGHTS } } },
+                    .color_attachments = { { .format = ImageFormat::B8G8R8A8_SRGB, .blend = {} } },
+                    .depth_test = {
+                        .enable_depth_test = true,
+                        .enable_depth_write = true,
+                    },
+                    .vk_render_pass = renderPass,
+                    .pipeline_layout_info = { .push_constant_size = sizeof(SimplePushConstantData), .vk_descriptor_set_layouts = setLayouts },
+                    .vertex_input = { .binding = Model::getBindingDescriptions(format), .attribute = Model::getAttributeDescriptions(format) } };
+            }
+
+            RasterPipeline &SimpleRenderSystem::getPipeline(VertexFormat format, uint32_t materialFeatures) {
+                PendingPipeline *&pending = pipelines[static_cast<u32>(format) * MATERIAL_VARIANT_COUNT + materialFeatures];
+                if (pending == nullptr) {
+                    pending = &device.pipeline_library().acquire(pipelineInfo(format, materialFeatures));
+                }
+                if (materialFeatures != 0 && !pending->is_ready()) {
+                    return getPipeline(format, 0);
+                }
+                return pending->get();
             }
 
             SimpleRenderSystem::~SimpleRenderSystem() {}
 
+            uint32_t SimpleRenderSystem::selectLod(GameObject &obj, const glm::mat4 &modelMatrix, const Camera &camera) {
+                const Model &model = *obj.model;
+                if (model.getLodCount() <= 1) {
+                    return 0;
+                }
+
+                glm::vec3 scale = glm::abs(obj.transform.scale);
+                float maxScale = std::max(scale.x, std::max(scale.y, scale.z));
+                glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(model.getBoundsCenter(), 1.f));
+                float distance = glm::length(center - camera.getPosition()) - model.getBoundsRadius() * maxScale;
+                if (distance <= 0.0f) {
+                    obj.lodLevel = 0;
+                    return 0;
+                }
+
+                // world space length at the closest point of the bounds -> fraction of the viewport height
+                float projection = std::abs(camera.getProjection()[1][1]) * 0.5f / distance;
+                auto screenError = [&](uint32_t lod) { return model.getLodError(lod) * maxScale * projection; };
+
+                uint32_t lod = std::min(obj.lodLevel, model.getLodCount() - 1);
+                while (lod + 1 < model.getLodCount() && screenError(lod + 1) <= LOD_ERROR_THRESHOLD * (1.0f - LOD_HYSTERESIS)) {
+                    lod++;
+                }
+                while (lod > 0 && screenError(lod) > LOD_ERROR_THRESHOLD * (1.0f + LOD_HYSTERESIS)) {
+                    lod--;
+                }
+                obj.lodLevel = lod;
+                return lod;
+            }
+
             void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
-                pipeline->bind(frameInfo.commandBuffer);
+                glm::mat4 viewProjection = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+                cullingStats = {};
+
+                // every draw of the frame shares these, models then bind no descriptor sets at all
+                if (bindless) {
+                    VkDescriptorSet sets[] = { frameInfo.globalDescriptorSet, device.bindless_materials().descriptor_set() };
+                    vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, sets, 0, nullptr);
+                }
 
                 for (auto &kv : frameInfo.gameObjects) {
                     auto &obj = kv.second;
-                    if (obj.model == nullptr)
+                    // placeholders of models still streaming in have nothing to draw
+                    if (obj.model == nullptr || obj.model->isEmpty())
+                        continue;
+
+                    glm::mat4 modelMatrix = obj.transform.mat4();
+                    glm::mat4 inverseModel = glm::inverse(modelMatrix);
+                    ModelCulling objectCulling = ModelCulling::fromMatrices(viewProjection * modelMatrix, inverseModel, frameInfo.camera.getPosition());
+                    cullingStats.objects++;
+                    if (!objectCulling.isSphereVisible(obj.model->getBoundsCenter(), obj.model->getBoundsRadius())) {
                         continue;
-                    SimplePushConstantData push{};
-                    push.modelMatrix = obj.transform.mat4();
-                    push.normalMatrix = obj.transform.normalMatrix();
+                    }
+                    cullingStats.visibleObjects++;
+
+                    uint32_t lod = selectLod(obj, modelMatrix, frameInfo.camera);
+
+                    // the model binds the variant each material needs, variants it has no material for are never built
+                    RasterPipeline &pipeline = getPipeline(obj.model->getVertexFormat());
+                    std::array<VkPipeline, MATERIAL_VARIANT_COUNT> materialPipelines{};
+                    for (uint32_t features = 0; features < MATERIAL_VARIANT_COUNT; features++) {
+                        materialPipelines[features] = obj.model->getMaterialVariants() & (1u << features) ? getPipeline(obj.model->getVertexFormat(), features).pipeline() : pipeline.pipeline();
+                    }
 
-                    vkCmdPushConstants(frameInfo.commandBuffer, pipeline->pipeline_layout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
                     obj.model->bind(frameInfo.commandBuffer);
-                    obj.model->draw(frameInfo.commandBuffer, frameInfo.globalDescriptorSet, pipeline->pipeline_layout());
+                    glm::mat3 normalMatrix = obj.transform.normalMatrix();
+                    bool pushedObject = false;
+                    for (auto &instance : obj.model->getInstances()) {
+                        // baked instances draw with the object's matrices, only real instances pay for their own
+                        ModelCulling culling = objectCulling;
+                        SimplePushConstantData push{};
+                        if (instance.isIdentity) {
+                            if (!pushedObject) {
+                                push.modelMatrix = modelMatrix * obj.model->getDequantization();
+                                push.normalMatrix = normalMatrix;
+                                vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+                                pushedObject = true;
+                            }
+                        } else {
+                            glm::mat4 instanceMatrix = modelMatrix * instance.transform;
+                            culling = ModelCulling::fromMatrices(viewProjection * instanceMatrix, glm::inverse(instance.transform) * inverseModel, frameInfo.camera.getPosition());
+                            push.modelMatrix = instanceMatrix * obj.model->getDequantization();
+                            push.normalMatrix = normalMatrix * instance.normalMatrix;
+                            vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+                            pushedObject = false;
+                        }
+                        if (bindless) {
+                            obj.model->drawBindless(frameInfo.commandBuffer, instance, lod, &culling, materialPipelines.data());
+                        } else {
+                            obj.model->draw(frameInfo.commandBuffer, frameInfo.globalDescriptorSet, pipelineLayout, instance, lod, &culling, materialPipelines.data());
+                        }
+
+                        cullingStats.meshlets += culling.meshletCount;
+                        cullingStats.visibleMeshlets += culling.visibleMeshletCount;
+                        cullingStats.draws += culling.drawCount;
+                    }
                 }
             }
         }
@@ -3,8 +3,9 @@
 #include "../graphics/camera.hpp"
 #include "../graphics/device.hpp"
 #include "../graphics/frame_info.hpp"
-#include "../graphics/pipeline.hpp"
+#include "../graphics/pipeline_library.hpp"
 
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -13,7 +14,16 @@ namespace VGED {
         inline namespace System {
             class SimpleRenderSystem {
             public:
-                SimpleRenderSystem(Device &_device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout> setLayouts);
+                struct CullingStats {
+                    uint32_t objects = 0;
+                    uint32_t visibleObjects = 0;
+                    uint32_t meshlets = 0;
+                    uint32_t visibleMeshlets = 0;
+                    uint32_t draws = 0;
+                };
+
+                // bindless replaces the material set, setLayouts[1], with the device's BindlessMaterials set
+                SimpleRenderSystem(Device &_device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout> setLayouts, bool bindless = false);
                 ~SimpleRenderSystem();
 
                 SimpleRenderSystem(const SimpleRenderSystem &) = delete;
@@ -21,10 +31,25 @@ namespace VGED {
 
                 void renderGameObjects(FrameInfo &frameInfo);
 
+                // counters of the last renderGameObjects call
+                const CullingStats &getCullingStats() const { return cullingStats; }
+
             private:
+                RasterPipelineInfo pipelineInfo(VertexFormat format, uint32_t materialFeatures) const;
+                // every vertex format's base pipeline is built in the background, waits for it the first time a model needs it.
+                // Material variants are only started once a model needs them and draw as the base pipeline until they are built.
+                RasterPipeline &getPipeline(VertexFormat format, uint32_t materialFeatures = 0);
+                uint32_t selectLod(GameObject &obj, const glm::mat4 &modelMatrix, const Camera &camera);
+
                 Device &device;
+                VkRenderPass renderPass;
+                std::vector<VkDescriptorSetLayout> setLayouts;
+                bool bindless;
+                VkPipelineLayout pipelineLayout; // shared by every variant through the PipelineLibrary
 
-                std::unique_ptr<RasterPipeline> pipeline;
+                // [format * MATERIAL_VARIANT_COUNT + features], owned by the device's PipelineLibrary
+                std::array<PendingPipeline *, 3 * MATERIAL_VARIANT_COUNT> pipelines{};
+                CullingStats cullingStats;
             };
         }
     }
@@ -1,9 +1,27 @@
 #version 450
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+// Blinn-Phong point lights. Materials without maps shade exactly as before the variants existed, the
+// feature defines change the look of materials that have them:
+// HAS_NORMAL_MAP              tangent space normal from a UNORM two channel map, rebuilt z
+// HAS_METALLIC_ROUGHNESS_MAP  glTF .b metallic / .g roughness from a UNORM map, roughness sets the
+//                             shininess, metals lose diffuse and tint the specular with the albedo
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
 layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 3) in vec2 fragUV;
+#ifdef HAS_NORMAL_MAP
+layout (location = 4) in vec4 fragTangentWorld; // w is the bitangent sign
+#endif
+#ifdef BINDLESS
+layout (location = 5) flat in uint fragMaterial;
+#endif
+
+// specialized to the lights the renderer actually fills, the loop bound is then known when the pipeline is built
+layout (constant_id = 0) const int MAX_LIGHTS = 10;
 
 layout (location = 0) out vec4 outColor;
 
@@ -21,9 +39,28 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   int numLights;
 } ubo;
 
+#ifdef BINDLESS
+// BindlessMaterials, every texture and material in one set bound once per frame
+struct Material {
+  uint albedoTexture;
+  uint normalTexture;
+  uint metallicRoughnessTexture;
+  uint features;
+};
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+layout(set = 1, binding = 1) readonly buffer Materials {
+  Material materials[];
+};
+
+#define albedo textures[nonuniformEXT(materials[fragMaterial].albedoTexture)]
+#define normal textures[nonuniformEXT(materials[fragMaterial].normalTexture)]
+#define metallicRoughness textures[nonuniformEXT(materials[fragMaterial].metallicRoughnessTexture)]
+#else
 layout(set = 1, binding = 0) uniform sampler2D albedo;
 layout(set = 1, binding = 1) uniform sampler2D normal;
 layout(set = 1, binding = 2) uniform sampler2D metallicRoughness;
+#endif
 
 layout(push_constant) uniform Push {
   mat4 modelMatrix;
@@ -34,11 +71,31 @@ void main() {
   vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
   vec3 specularLight = vec3(0.0);
   vec3 surfaceNormal = normalize(fragNormalWorld);
+#ifdef HAS_NORMAL_MAP
+  // two channel normal maps, z is rebuilt from xy
+  vec3 tangentNormal;
+  tangentNormal.xy = texture(normal, fragUV).xy * 2.0 - 1.0;
+  tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+  vec3 tangent = fragTangentWorld.xyz - surfaceNormal * dot(surfaceNormal, fragTangentWorld.xyz);
+  if (dot(tangent, tangent) > 1e-8) { // meshes without tangents keep the interpolated normal
+    tangent = normalize(tangent);
+    vec3 bitangent = cross(surfaceNormal, tangent) * fragTangentWorld.w;
+    surfaceNormal = normalize(mat3(tangent, bitangent, surfaceNormal) * tangentNormal);
+  }
+#endif
+
+  float shininess = 512.0; // higher values -> sharper highlight
+#ifdef HAS_METALLIC_ROUGHNESS_MAP
+  vec2 metallicRoughnessSample = texture(metallicRoughness, fragUV).bg; // glTF: metallic in blue, roughness in green
+  float metallic = metallicRoughnessSample.x;
+  float roughness = metallicRoughnessSample.y;
+  shininess = exp2(9.0 * (1.0 - roughness)); // 512 when smooth, 1 when fully rough
+#endif
 
   vec3 cameraPosWorld = ubo.invView[3].xyz;
   vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
 
-  for (int i = 0; i < ubo.numLights; i++) {
+  for (int i = 0; i < min(ubo.numLights, MAX_LIGHTS); i++) {
     PointLight light = ubo.pointLights[i];
     vec3 directionToLight = light.position.xyz - fragPosWorld;
     float attenuation = 1.0 / dot(directionToLight, directionToLight); // distance squared
@@ -53,11 +110,18 @@ void main() {
     vec3 halfAngle = normalize(directionToLight + viewDirection);
     float blinnTerm = dot(surfaceNormal, halfAngle);
     blinnTerm = clamp(blinnTerm, 0, 1);
-    blinnTerm = pow(blinnTerm, 512.0); // higher values -> sharper highlight
+    blinnTerm = pow(blinnTerm, shininess);
     specularLight += intensity * blinnTerm;
   }
 
   vec3 imageColor = texture(albedo, fragUV).rgb;
-  
-  outColor = vec4((diffuseLight * imageColor + specularLight * imageColor), 1.0);
+  vec3 diffuseColor = imageColor;
+  vec3 specularColor = imageColor;
+#ifdef HAS_METALLIC_ROUGHNESS_MAP
+  // metals have no diffuse and tint their highlights, dielectrics reflect a few percent untinted
+  diffuseColor = imageColor * (1.0 - metallic);
+  specularColor = mix(vec3(0.04), imageColor, metallic);
+#endif
+
+  outColor = vec4((diffuseLight * diffuseColor + specularLight * specularColor), 1.0);
 }
@@ -10,6 +10,12 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragUV;
+#ifdef HAS_NORMAL_MAP
+layout(location = 4) out vec4 fragTangentWorld; // w is the bitangent sign
+#endif
+#ifdef BINDLESS
+layout(location = 5) flat out uint fragMaterial; // the draw's firstInstance
+#endif
 
 struct PointLight {
   vec4 position; // ignore w
@@ -37,4 +43,10 @@ void main() {
   fragPosWorld = positionWorld.xyz;
   fragColor = color;
   fragUV = uv;
+#ifdef BINDLESS
+  fragMaterial = uint(gl_InstanceIndex);
+#endif
+#ifdef HAS_NORMAL_MAP
+  fragTangentWorld = vec4(mat3(push.modelMatrix) * tangent.xyz, tangent.w);
+#endif
 }
@@ -0,0 +1,64 @@
+#version 450
+
+// Model::CompactVertex and Model::QuantizedVertex, quantized positions are expanded by push.modelMatrix
+// directions go through push.normalMatrix, it holds no dequantization
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 normal; // octahedral
+layout(location = 3) in ivec2 tangent; // octahedral, lowest bit of y is the bitangent sign
+layout(location = 4) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUV;
+#ifdef HAS_NORMAL_MAP
+layout(location = 4) out vec4 fragTangentWorld; // w is the bitangent sign
+#endif
+#ifdef BINDLESS
+layout(location = 5) flat out uint fragMaterial; // the draw's firstInstance
+#endif
+
+struct PointLight {
+  vec4 position; // ignore w
+  vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+layout(push_constant) uniform Push {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+} push;
+
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+void main() {
+  vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+  fragNormalWorld = normalize(mat3(push.normalMatrix) * octDecode(normal));
+  fragPosWorld = positionWorld.xyz;
+  fragColor = vec3(1.0);
+  fragUV = uv;
+#ifdef BINDLESS
+  fragMaterial = uint(gl_InstanceIndex);
+#endif
+#ifdef HAS_NORMAL_MAP
+  // modelMatrix carries the non-uniform dequantization scale, which would skew the tangent off the normal
+  vec3 tangentWorld = mat3(push.normalMatrix) * octDecode(vec2(tangent) / 32767.0);
+  tangentWorld -= fragNormalWorld * dot(fragNormalWorld, tangentWorld);
+  fragTangentWorld = vec4(tangentWorld, (tangent.y & 1) != 0 ? -1.0 : 1.0);
+#endif
+}
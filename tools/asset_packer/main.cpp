@@ -0,0 +1,108 @@
+#include "vged.hpp"
+
+#include "core/pack_file.hpp"
+#include "core/virtual_file_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace VGED;
+using namespace VGED::Engine;
+
+// Packs loose assets into a single LZ4 compressed .vpak the engine mounts through the VirtualFileSystem.
+// usage: asset_packer <output.vpak> <files or directories...> [--order load_order.txt] [--store]
+//   paths are stored relative to the working directory, run it from where the engine runs
+//   --order  lay files out in the order the editor wrote to cache/load_order.txt, the rest follow sorted
+//   --store  don't compress anything
+int main(int argc, char **argv) {
+    Log::init();
+
+    std::filesystem::path output;
+    std::filesystem::path order_path;
+    std::vector<std::filesystem::path> inputs;
+    bool compress = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--order" && i + 1 < argc) {
+            order_path = argv[++i];
+        } else if (arg == "--store") {
+            compress = false;
+        } else if (output.empty()) {
+            output = arg;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (output.empty() || inputs.empty()) {
+        VGED_ENGINE_ERROR("usage: asset_packer <output{}> <files or directories...> [--order load_order.txt] [--store]", PackFile::EXTENSION);
+        return 1;
+    }
+
+    try {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<std::string> files;
+        for (auto &input : inputs) {
+            if (std::filesystem::is_directory(input)) {
+                for (auto &entry : std::filesystem::recursive_directory_iterator(input)) {
+                    if (entry.is_regular_file()) {
+                        files.push_back(PackFile::normalize(entry.path().string()));
+                    }
+                }
+            } else {
+                files.push_back(PackFile::normalize(input.string()));
+            }
+        }
+        std::sort(files.begin(), files.end());
+        files.erase(std::unique(files.begin(), files.end()), files.end());
+
+        // files read at startup first, in the order they were read, everything else after them
+        std::unordered_map<std::string, usize> rank;
+        if (!order_path.empty()) {
+            std::ifstream order(order_path);
+            if (!order) {
+                throw std::runtime_error("failed to open load order: " + order_path.string());
+            }
+            std::string line;
+            while (std::getline(order, line)) {
+                if (!line.empty()) {
+                    rank.emplace(PackFile::normalize(line), rank.size());
+                }
+            }
+        }
+        std::stable_sort(files.begin(), files.end(), [&](const std::string &a, const std::string &b) {
+            auto rank_a = rank.find(a);
+            auto rank_b = rank.find(b);
+            usize order_a = rank_a != rank.end() ? rank_a->second : rank.size();
+            usize order_b = rank_b != rank.end() ? rank_b->second : rank.size();
+            return order_a < order_b;
+        });
+
+        std::vector<PackInput> pack(files.size());
+        u64 total = 0;
+        for (usize i = 0; i < files.size(); i++) {
+            pack[i].path = files[i];
+            FileView file = FileView::map(files[i]);
+            pack[i].data.assign(file.data(), file.data() + file.size());
+            total += file.size();
+        }
+        PackFile::write(pack, output.string(), compress);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        u64 packed = std::filesystem::file_size(output);
+        usize ordered = static_cast<usize>(std::count_if(files.begin(), files.end(), [&](const std::string &file) { return rank.contains(file); }));
+        VGED_ENGINE_INFO("{} files ({} in load order) -> {}", files.size(), ordered, output.generic_string());
+        VGED_ENGINE_INFO("{} KiB -> {} KiB in {:.2f} ms", total / 1024, packed / 1024, std::chrono::duration<f64, std::milli>(end - start).count());
+    } catch (const std::exception &e) {
+        VGED_ENGINE_ERROR("failed to pack {}: {}", output.generic_string(), e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "vged.hpp"
+
+#include "graphics/descriptors.hpp"
+#include "graphics/device.hpp"
+#include "graphics/model.hpp"
+#include "graphics/upload_manager.hpp"
+#include "core/thread_pool.hpp"
+#include "core/window.hpp"
+
+#include <chrono>
+#include <string>
+
+using namespace VGED;
+using namespace VGED::Engine;
+
+// Reports how long loading a model takes with 1..N decode threads.
+// usage: load_benchmark [model path] [max threads] [runs per thread count]
+int main(int argc, char **argv) {
+    Log::init();
+
+    std::string model_path = argc > 1 ? argv[1] : "models/Sponza/Sponza.gltf";
+    usize max_threads = argc > 2 ? std::stoul(argv[2]) : ThreadPool::default_thread_count();
+    usize runs = argc > 3 ? std::stoul(argv[3]) : 3;
+
+    Window window{ 640, 360, "VGED Load Benchmark" };
+    Device device{ window };
+
+    auto material_set_layout = DescriptorSetLayout::Builder(device)
+                                   .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                                   .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                                   .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                                   .build();
+
+    auto load = [&](ThreadPool &pool) {
+        DescriptorAllocator descriptor_allocator{ device, { { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3.0f } } };
+        auto start = std::chrono::high_resolution_clock::now();
+        Model model{ device, model_path, *material_set_layout, descriptor_allocator, ModelInfo{ .thread_pool = &pool } };
+        // uploads are submitted without waiting, include them in the measurement
+        device.upload_manager().wait_idle();
+        // stopped before the model goes out of scope, tearing down its GPU resources isn't part of a load
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<f64, std::milli>(end - start).count();
+    };
+
+    // warm the OS file cache so the first measured thread count isn't penalized
+    {
+        ThreadPool pool{ max_threads };
+        load(pool);
+    }
+
+    VGED_ENGINE_INFO("{} load time over {} runs", model_path, runs);
+    f64 single_thread_ms = 0.0;
+    for (usize threads = 1; threads <= max_threads; ++threads) {
+        ThreadPool pool{ threads };
+        f64 best_ms = 0.0;
+        for (usize run = 0; run < runs; ++run) {
+            f64 ms = load(pool);
+            best_ms = run == 0 ? ms : std::min(best_ms, ms);
+        }
+        if (threads == 1) {
+            single_thread_ms = best_ms;
+        }
+        VGED_ENGINE_INFO("threads: {:>3}  best: {:>9.2f} ms  speedup: {:.2f}x", threads, best_ms, single_thread_ms / best_ms);
+    }
+
+    vkDeviceWaitIdle(device.device());
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "vged.hpp"
+
+#include "graphics/cooked_mesh.hpp"
+#include "graphics/cooked_texture.hpp"
+#include "graphics/mesh_baker.hpp"
+#include "graphics/mesh_data.hpp"
+#include "graphics/mesh_optimizer.hpp"
+#include "graphics/mesh_simplifier.hpp"
+#include "graphics/meshlet_builder.hpp"
+#include "graphics/texture.hpp"
+#include "graphics/texture_compressor.hpp"
+
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace VGED;
+using namespace VGED::Engine;
+
+// Cooks every image of the mesh into a .vtex next to the source image and points the uri at it.
+// Encoding follows how materials use the image: BC5 normal maps, BC7 UNORM metallic-roughness, BC7 sRGB color.
+static void cook_textures(MeshData &mesh, const std::filesystem::path &input_dir) {
+    std::vector<TextureCookInfo> infos(mesh.image_uris.size());
+    for (auto &material : mesh.materials) {
+        if (material.normal_image >= 0) {
+            infos[material.normal_image] = { .encoding = TextureEncoding::BC5, .srgb = false, .normal_map = true };
+        }
+        if (material.metallic_roughness_image >= 0) {
+            infos[material.metallic_roughness_image] = { .encoding = TextureEncoding::BC7, .srgb = false };
+        }
+    }
+
+    for (usize i = 0; i < mesh.image_uris.size(); i++) {
+        auto source = input_dir / mesh.image_uris[i];
+        if (source.extension() == CookedTexture::EXTENSION) {
+            continue;
+        }
+        auto cooked_path = std::filesystem::path{ source }.replace_extension(CookedTexture::EXTENSION);
+
+        TextureData image = TextureData::load(source.string());
+        CookedTexture::write(cook_texture(image.pixels.get(), static_cast<u32>(image.width), static_cast<u32>(image.height), infos[i]), cooked_path.string());
+        mesh.image_uris[i] = std::filesystem::path{ mesh.image_uris[i] }.replace_extension(CookedTexture::EXTENSION).generic_string();
+        VGED_ENGINE_INFO("{} -> {}", source.generic_string(), cooked_path.generic_string());
+    }
+}
+
+// Writes images embedded in a .glb next to the output, a .vmesh only references images by uri.
+static void extract_embedded_images(MeshData &mesh, const std::filesystem::path &input_dir, const std::filesystem::path &output) {
+    for (usize i = 0; i < mesh.embedded_images.size(); i++) {
+        auto &bytes = mesh.embedded_images[i];
+        if (bytes.empty()) {
+            continue;
+        }
+        bool png = bytes.size() >= 4 && bytes[0] == 0x89 && bytes[1] == 'P' && bytes[2] == 'N' && bytes[3] == 'G';
+        auto image_path = std::filesystem::absolute(output).parent_path() / (output.stem().string() + "_image" + std::to_string(i) + (png ? ".png" : ".jpg"));
+
+        std::ofstream out{ image_path, std::ios::binary };
+        out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!out) {
+            throw std::runtime_error("failed to write " + image_path.generic_string());
+        }
+        mesh.image_uris[i] = std::filesystem::relative(image_path, input_dir).generic_string();
+        bytes.clear();
+        VGED_ENGINE_INFO("embedded image {} -> {}", i, image_path.generic_string());
+    }
+}
+
+// Converts a .gltf or .glb into a .vmesh that Model can memory map without parsing.
+// usage: model_cooker <input.gltf | input.glb> [output.vmesh] [--textures] [--bake | --bake-shared]
+//   --textures     also cook the referenced images into block compressed .vtex files
+//   --bake         bake node transforms into meshes placed once, shared meshes stay instanced
+//   --bake-shared  bake every node transform, shared meshes are duplicated per node
+int main(int argc, char **argv) {
+    Log::init();
+
+    std::vector<std::string> paths;
+    bool textures = false;
+    bool bake = false;
+    TransformBakeInfo bake_info{};
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--textures") {
+            textures = true;
+        } else if (arg == "--bake" || arg == "--bake-shared") {
+            bake = true;
+            bake_info.bake_shared = arg == "--bake-shared";
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty()) {
+        VGED_ENGINE_ERROR("usage: model_cooker <input.gltf | input.glb> [output{}] [--textures] [--bake | --bake-shared]", CookedMesh::EXTENSION);
+        return 1;
+    }
+
+    std::filesystem::path input = paths[0];
+    std::filesystem::path output = paths.size() > 1 ? std::filesystem::path{ paths[1] } : std::filesystem::path{ input }.replace_extension(CookedMesh::EXTENSION);
+
+    try {
+        auto start = std::chrono::high_resolution_clock::now();
+        MeshData mesh = MeshData::import_gltf(input.string());
+        if (bake) {
+            TransformBakeStats baked = bake_transforms(mesh, bake_info);
+            VGED_ENGINE_INFO("instances: {} -> {}  baked: {}  duplicated vertices: {}", baked.instances_before, baked.instances_after, baked.baked_instances, baked.duplicated_vertices);
+        }
+
+        VertexCacheStats before = analyze_vertex_cache(mesh);
+        usize imported_vertices = mesh.vertices.size();
+        optimize_mesh(mesh);
+        VertexCacheStats after = analyze_vertex_cache(mesh);
+        usize full_detail_indices = mesh.indices.size();
+        generate_lods(mesh);
+        build_meshlets(mesh);
+
+        // image uris are resolved relative to the cooked file at load time
+        auto input_dir = std::filesystem::absolute(input).parent_path();
+        auto output_dir = std::filesystem::absolute(output).parent_path();
+        extract_embedded_images(mesh, input_dir, output);
+        if (textures) {
+            cook_textures(mesh, input_dir);
+        }
+        if (input_dir != output_dir) {
+            for (auto &uri : mesh.image_uris) {
+                uri = std::filesystem::relative(input_dir / uri, output_dir).generic_string();
+            }
+        }
+
+        CookedMesh::write(mesh, output.string());
+        auto end = std::chrono::high_resolution_clock::now();
+
+        VGED_ENGINE_INFO("{} -> {}", input.generic_string(), output.generic_string());
+        VGED_ENGINE_INFO("vertices: {} -> {}  ACMR: {:.3f} -> {:.3f}  ATVR: {:.3f} -> {:.3f}", imported_vertices, mesh.vertices.size(), before.acmr, after.acmr, before.atvr, after.atvr);
+        VGED_ENGINE_INFO("lod indices: {} on top of {} full detail", mesh.indices.size() - full_detail_indices, full_detail_indices);
+        VGED_ENGINE_INFO("vertices: {}  indices: {}  primitives: {}  instances: {}  meshlets: {}  materials: {}  images: {}", mesh.vertices.size(), mesh.indices.size(),
+                         mesh.primitives.size(), mesh.instances.size(), mesh.meshlets.size(), mesh.materials.size(), mesh.image_uris.size());
+        VGED_ENGINE_INFO("{} bytes in {:.2f} ms", std::filesystem::file_size(output), std::chrono::duration<f64, std::milli>(end - start).count());
+    } catch (const std::exception &e) {
+        VGED_ENGINE_ERROR("failed to cook {}: {}", input.generic_string(), e.what());
+        return 1;
+    }
+    return 0;
+}
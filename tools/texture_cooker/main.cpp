@@ -0,0 +1,86 @@
+#include "vged.hpp"
+
+#include "graphics/cooked_texture.hpp"
+#include "graphics/texture.hpp"
+#include "graphics/texture_compressor.hpp"
+
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+using namespace VGED;
+using namespace VGED::Engine;
+
+// Converts an image into a .vtex holding a block compressed, precomputed mip chain.
+// usage: texture_cooker <input image> [output.vtex] [--bc1 | --bc4 | --bc5 | --bc7 | --rgba8] [--linear] [--normal]
+//   --linear  data is not color, mips are filtered as is and the format is UNORM
+//   --normal  tangent space normal map, mips are renormalized, defaults to BC5
+int main(int argc, char **argv) {
+    Log::init();
+
+    std::filesystem::path input;
+    std::filesystem::path output;
+    TextureCookInfo info{};
+    bool encoding_given = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bc1" || arg == "--bc4" || arg == "--bc5" || arg == "--bc7" || arg == "--rgba8") {
+            info.encoding = arg == "--bc1" ? TextureEncoding::BC1
+                          : arg == "--bc4" ? TextureEncoding::BC4
+                          : arg == "--bc5" ? TextureEncoding::BC5
+                          : arg == "--bc7" ? TextureEncoding::BC7
+                                           : TextureEncoding::RGBA8;
+            encoding_given = true;
+        } else if (arg == "--linear") {
+            info.srgb = false;
+        } else if (arg == "--normal") {
+            info.normal_map = true;
+            info.srgb = false;
+        } else if (input.empty()) {
+            input = arg;
+        } else {
+            output = arg;
+        }
+    }
+
+    if (input.empty()) {
+        VGED_ENGINE_ERROR("usage: texture_cooker <input image> [output{}] [--bc1 | --bc4 | --bc5 | --bc7 | --rgba8] [--linear] [--normal]", CookedTexture::EXTENSION);
+        return 1;
+    }
+    if (output.empty()) {
+        output = std::filesystem::path{ input }.replace_extension(CookedTexture::EXTENSION);
+    }
+    if (info.normal_map && !encoding_given) {
+        info.encoding = TextureEncoding::BC5;
+    }
+
+    try {
+        auto start = std::chrono::high_resolution_clock::now();
+        TextureData image = TextureData::load(input.string());
+        if (image.cooked) {
+            throw std::runtime_error("input is already cooked");
+        }
+        CookedTextureData cooked = cook_texture(image.pixels.get(), static_cast<u32>(image.width), static_cast<u32>(image.height), info);
+        CookedTexture::write(cooked, output.string());
+        auto end = std::chrono::high_resolution_clock::now();
+
+        // what the runtime used to allocate: RGBA8 plus a blitted mip chain
+        u64 uncompressed = 0;
+        u64 compressed = 0;
+        for (auto &level : cooked.levels) {
+            uncompressed += static_cast<u64>(level.width) * level.height * 4;
+            compressed += level.data.size();
+        }
+
+        VGED_ENGINE_INFO("{} -> {}", input.generic_string(), output.generic_string());
+        VGED_ENGINE_INFO("{}x{}  mips: {}  format: {}", cooked.width, cooked.height, cooked.levels.size(), static_cast<u32>(cooked.format));
+        VGED_ENGINE_INFO("{} KiB -> {} KiB ({:.1f}x smaller) in {:.2f} ms", uncompressed / 1024, compressed / 1024, static_cast<f64>(uncompressed) / static_cast<f64>(compressed),
+                         std::chrono::duration<f64, std::milli>(end - start).count());
+    } catch (const std::exception &e) {
+        VGED_ENGINE_ERROR("failed to cook {}: {}", input.generic_string(), e.what());
+        return 1;
+    }
+    return 0;
+}